@@ -195,6 +195,7 @@ public:
   float getProgress() const;
   int done() const;
   Scalar getValue( const Sample& x ) const;
+  int supportsThreadedProjection() const { return 1; }
 
 protected:
 
@@ -38,14 +38,7 @@ using std::string;
 #include <openmodeller/Exceptions.hh>
 
 #include <math.h> // for function ceil()
-
-#ifdef WIN32
-#include <windows.h>
-#define SLEEP(secs) Sleep(secs * 1000)
-#else
-#include <unistd.h>
-#define SLEEP(secs) sleep(secs);
-#endif
+#include <algorithm>
 
 /****************************************************************/
 static void printListOfRuns(string msg, AlgorithmRun ** runs, int numOfRuns)
@@ -75,12 +68,14 @@ AbstractBestSubsets::AbstractBestSubsets( AlgMetadata const * metadata_bs) :
   _softOmissionThreshold = false;
   _currentModelsUnderOmissionThreshold = 0;
 
+  _queue = NULL;
+  _samples = NULL;
+
   _finishedRun = NULL;
-  _activeRun = NULL;
   _bestRun = NULL;
 
+  _numSubmittedRuns = 0;
   _numFinishedRuns = 0;
-  _numActiveRuns = 0;
   _done = false;
 
   _maxProgress = 0.0;
@@ -92,6 +87,13 @@ AbstractBestSubsets::~AbstractBestSubsets()
 {
   int i;
 
+  // waits for the runs that are still executing
+  if (_queue)
+  { delete _queue; }
+
+  if (_samples)
+  { delete _samples; }
+
   if (_finishedRun)
   {
     for (i = 0; i < _numFinishedRuns; i++)
@@ -99,9 +101,6 @@ AbstractBestSubsets::~AbstractBestSubsets()
     delete[] _finishedRun;
   }
 
-  if (_activeRun)
-  { delete[] _activeRun; }
-
   // bestRun just point to objects referenced by _finishedRun object
   if (_bestRun)
   { delete[] _bestRun; }
@@ -274,13 +273,6 @@ int AbstractBestSubsets::initialize()
   {
     _maxThreads = 1;
   }
-  else if ( _maxThreads > 1 )
-  {
-    // When maxThreads is greater than 1, if the machine has only one processor om
-    // can crash. If the machine has more than one processor GDAL can output lots
-    // of IO errors (current GDAL version does not seem to be thread safe).
-    Log::instance()->warn("Multithreading is still experimental. When max threads is greater than 1, depending on software and hardware configuration this application may crash or you may see lots of raster IO warnings. In these cases, we recommend you to set this parameter to 1.\n");
-  }
 
   if (_trainProp <= 1.0)
   {
@@ -299,8 +291,32 @@ int AbstractBestSubsets::initialize()
     _modelsUnderOmission = _totalRuns;
   }
 
+  // Runs are executed by worker threads, which must not read the
+  // environmental layers, so the points used to calculate errors
+  // are sampled here and shared by all runs.
+  _samples = new SharedSamples(_samp, _commissionSampleSize);
+
+  if (!_samples->numBackground())
+  {
+    Log::instance()->error("No points available to calculate commission.\n");
+    return 0;
+  }
+
   _finishedRun = new AlgorithmRun*[_totalRuns];
-  _activeRun = new AlgorithmRun*[_maxThreads];
+
+  // Runs of other algorithms are trained one at a time, since they may
+  // read the environmental layers while iterating.
+  AlgorithmPtr alg = AlgorithmFactory::newAlgorithm( _subAlgorithm );
+
+  bool concurrent = alg->supportsConcurrentTraining() != 0;
+
+  if ( !concurrent && _maxThreads > 1 )
+  {
+    Log::instance()->warn("Algorithm %s does not support concurrent training. Runs will be executed one at a time.\n", _subAlgorithm.c_str());
+    _maxThreads = 1;
+  }
+
+  _queue = new RunQueue(_maxThreads, concurrent);
 
   return 1;
 }
@@ -310,106 +326,85 @@ int AbstractBestSubsets::initialize()
 
 int AbstractBestSubsets::iterate()
 {
-  static int iterations = 0;
-  static int runId = 0;
-  int active;
-  AlgorithmRun * algRun;
-
-  ++iterations;
-
   if (_done)
   { return 1; }
 
-  // check if it should start new runs
-  if ((_numFinishedRuns + _numActiveRuns < _totalRuns) && 
-      !earlyTerminationConditionMet())
-  {
-    // it needs to start more runs
-    // wait for a slot for a new thread
-    if ((active = numActiveThreads()) >= _maxThreads)
-    {
-      //Log::instance()->info("%5d] Waiting for a slot to run next thread (%d out of %d)\n", iterations, active, _maxThreads);
-      SLEEP(2); 
-    }
+  // keep the queue full while more runs are needed
+  while (!_queue->full() && _numSubmittedRuns < _totalRuns &&
+         !earlyTerminationConditionMet())
+  { submitRun(); }
 
-    else
-    {
-      //Log::instance()->debug("%5d] There is an empty slot to run next thread (%d out of %d) - %d\n", iterations, active, _maxThreads, runId);
-
-      // start new Algorithm
-      SamplerPtr train, test;
-      splitSampler(_samp, &train, &test, _trainProp);
-
-      //printf("Presences: Orig=%d, train=%d, test=%d\n", _samp->numPresence(), train->numPresence(), test->numPresence());
-      //printf("Absences:  Orig=%d, train=%d, test=%d\n", _samp->numAbsence(), train->numAbsence(), test->numAbsence());
-
-      AlgorithmPtr algo = AlgorithmFactory::newAlgorithm( _subAlgorithm );
-      algo->setParameters( _param );
-      algo->setSampler(train);
-      algo->initialize();
-      algRun = new AlgorithmRun(algo);
-      algRun->initialize(runId++,
-          _commissionSampleSize, train, test ); 
-      _activeRun[_numActiveRuns++] = algRun;
-      algRun->run();
-    }
-  }
+  // wait for the next run to finish
+  AlgorithmRun * run = static_cast<AlgorithmRun *>( _queue->next() );
 
+  if (run)
+  {
+    finishRun(run);
+  }
   else
   {
-    // no more runs are needed
-    // check if all active threads have finished
-    active = numActiveThreads();
-    if (active)
-    {
-      // there are still threads running
-      //  Log::instance()->info("%5d] Waiting for %d active thread(s) to finish.\n", iterations, active);
-      SLEEP(2); 
-    }
-    else
-    {
-      // all running threads terminated
-      // calculate best subset and exit
-      //Log::instance()->info("%5d] Calculating best and terminating algorithm.\n", iterations);
-      calculateBestSubset();
-      _done = true;
-    }
+    // all runs terminated
+    // calculate best subset and exit
+    calculateBestSubset();
+    _done = true;
   }
 
   return 1;
 }
 
 /****************************************************************/
-int AbstractBestSubsets::numActiveThreads()
+void AbstractBestSubsets::submitRun()
 {
-  int i;
-  AlgorithmRun * run;
+  // start new Algorithm
+  // (everything that samples the environment is done here, in the 
+  // calling thread)
+  SamplerPtr train;
+  std::vector<int> test;
+  _samples->split(_trainProp, &train, &test);
+
+  AlgorithmPtr algo = AlgorithmFactory::newAlgorithm( _subAlgorithm );
+  algo->setParameters( _param );
+  algo->setSampler(train);
+
+  // an algorithm that could not be initialized must not be queued
+  if (!algo->initialize())
+  {
+    Log::instance()->error( "Algorithm could not be initialized.\n" );
+    throw AlgorithmException( "Algorithm could not be initialized.\n" );
+  }
 
-  for (i = 0; i < _numActiveRuns; i++)
+  AlgorithmRun * algRun = new AlgorithmRun(algo);
+  algRun->initialize(_numSubmittedRuns++, _samples, train, test);
+
+  _queue->submit(algRun);
+}
+
+/****************************************************************/
+void AbstractBestSubsets::finishRun( AlgorithmRun * run )
+{
+  if (run->cancelled() || run->failed())
   {
-    run = _activeRun[i];
+    delete run;
+    return;
+  }
 
-    if (!run->running())
-    {
-      //Log::instance()->info("Thread %d has just finished.\n", run->getId());
-
-      // run finished its work
-      // move it to finished runs
-      // and remove it from list of active runs
-      _finishedRun[_numFinishedRuns++] = run;
-      _activeRun[i] = _activeRun[--_numActiveRuns];
-      _activeRun[_numActiveRuns] = NULL;
-
-      // update count of models under omission threshold
-      if (!_softOmissionThreshold)
-      {
-        if (run->getOmission() <= _omissionThreshold)
-        { _currentModelsUnderOmissionThreshold++; }
-      }
-    }
+  _finishedRun[_numFinishedRuns++] = run;
+
+  // update count of models under omission threshold
+  if (!_softOmissionThreshold)
+  {
+    if (run->getOmission() <= _omissionThreshold)
+    { _currentModelsUnderOmissionThreshold++; }
   }
 
-  return _numActiveRuns;
+  // runs waiting in the queue are no longer needed
+  if (earlyTerminationConditionMet())
+  {
+    int cancelled = _queue->cancelPending();
+
+    if (cancelled)
+    { Log::instance()->debug("Cancelled %d queued runs.\n", cancelled); }
+  }
 }
 
 /****************************************************************/
@@ -426,6 +421,13 @@ int AbstractBestSubsets::calculateBestSubset()
 
   Log::instance()->info("Calculating best subset of models.\n");
 
+  // failed runs are discarded
+  if (_numFinishedRuns < _modelsUnderOmission)
+  {
+    Log::instance()->warn("Only %d runs finished. ModelsUnderOmission will be reduced to (%d)\n", _numFinishedRuns, _numFinishedRuns);
+    _modelsUnderOmission = _numFinishedRuns;
+  }
+
   // make a copy of finished runs to play with
   AlgorithmRun ** runList = new AlgorithmRun*[_numFinishedRuns];
   for (i = 0; i < _numFinishedRuns; i++)
@@ -436,12 +438,12 @@ int AbstractBestSubsets::calculateBestSubset()
   // get list of models that pass omission test
   // sort runs by omission
   // first <_modelsUnderOmission> runs are the selected ones
-  sortRuns(runList, _numFinishedRuns, 0);
+  sortRuns(runList, _numFinishedRuns, _modelsUnderOmission, 0);
 
   printListOfRuns("Finished Runs by Omission:", runList, _numFinishedRuns);
 
   // get list of models that pass commission test
-  sortRuns(runList, _modelsUnderOmission, 1);
+  sortRuns(runList, _modelsUnderOmission, _modelsUnderOmission, 1);
 
   printListOfRuns("Best Omission Runs by Commission:", runList, _numFinishedRuns);
 
@@ -461,37 +463,47 @@ int AbstractBestSubsets::calculateBestSubset()
 
   delete[] runList;
 
-  Log::instance()->info("Selected best %d models out of %d.\n", _numBestRuns, _totalRuns);
+  Log::instance()->info("Selected best %d models out of %d.\n", _numBestRuns, _numFinishedRuns);
 
   return 1;
 }
 
 /****************************************************************/
-void AbstractBestSubsets::sortRuns(AlgorithmRun ** runList, 
-    int nelements, int errorType)
+// Orders runs by one of the error components. Ties are broken by id,
+// so that the selected runs do not depend on the order in which they
+// finished.
+class RunErrorLess
 {
-  int i, j;
-  AlgorithmRun * runJ0, * runJ1;
+public:
+  RunErrorLess(int errorType) : _errorType(errorType) {}
 
-  //Log::instance()->info("Sorting list %x of %d elements by index %d.\n", runList, nelements, errorType);
+  bool operator()(const AlgorithmRun * run0, const AlgorithmRun * run1) const
+  {
+    double error0 = run0->getError(_errorType);
+    double error1 = run1->getError(_errorType);
 
-  // bubble sort
-  // TODO: change to quicksort if this becomes a bottleneck
-  for (i = 0; i < nelements - 1; i++)
-  { 
-    for (j = 0; j < nelements - i - 1; j++)
-    {
-      runJ0 = runList[j];
-      runJ1 = runList[j + 1];
-
-      if (runJ0->getError(errorType) > runJ1->getError(errorType))
-      {
-        // exchange elements j and j + 1
-        runList[j] = runJ1;
-        runList[j + 1] = runJ0;
-      }
-    }
+    if (error0 != error1)
+    { return error0 < error1; }
+
+    return run0->getId() < run1->getId();
   }
+
+private:
+  int _errorType;
+};
+
+/****************************************************************/
+void AbstractBestSubsets::sortRuns(AlgorithmRun ** runList, 
+    int nelements, int nsorted, int errorType)
+{
+  //Log::instance()->info("Sorting list %x of %d elements by index %d.\n", runList, nelements, errorType);
+
+  // only the first <nsorted> runs need to be in order
+  if (nsorted > nelements)
+  { nsorted = nelements; }
+
+  std::partial_sort(runList, runList + nsorted, runList + nelements,
+                    RunErrorLess(errorType));
 }
 
 /****************************************************************/
@@ -515,12 +527,8 @@ float AbstractBestSubsets::getProgress() const
     float progByTotalRuns = 0.0;
     float progByHardOmission = 0.0;
 
-    float avgProgressActiveRuns = 0.0;
-    for (int i = 0; i < _numActiveRuns; i++)
-    { avgProgressActiveRuns += _activeRun[i]->getProgress(); }
-    avgProgressActiveRuns /= _numActiveRuns;
-
-    progByTotalRuns = (_numFinishedRuns + avgProgressActiveRuns) / (float) _totalRuns;
+    if (_queue)
+    { progByTotalRuns = _queue->getProgress() / (float) _totalRuns; }
 
     if (!_softOmissionThreshold)
     {
@@ -46,7 +46,7 @@
   * procedure defined by Anderson et al. 2003 and sum them to obtain
   * a probability map for the species distribution.
   * 
-  * Current implementation uses multi-threading to run multiple 
+  * Current implementation uses a RunQueue to run multiple 
   * Garp runs in parallel. Takes advantage of multi-processor 
   * servers and workstations.
   */
@@ -115,10 +115,11 @@ protected:
   mutable std::string _subAlgorithm; //< mutable so it can be assigned in needNormalization if necessary
 
 private:
-  int numActiveThreads();
+  void submitRun();
+  void finishRun( AlgorithmRun * run );
   int earlyTerminationConditionMet();
   int calculateBestSubset();
-  void sortRuns(AlgorithmRun ** runList, int nelements, int errorType);
+  void sortRuns(AlgorithmRun ** runList, int nelements, int nsorted, int errorType);
 
   //
   // best subsets parameters
@@ -137,12 +138,14 @@ private:
   //
   // Internal data structures for Best Subsets
   //
+  RunQueue * _queue;
+  SharedSamples * _samples;
+
   AlgorithmRun ** _finishedRun;
-  AlgorithmRun ** _activeRun;
   AlgorithmRun ** _bestRun;
 
+  int _numSubmittedRuns;
   int _numFinishedRuns;
-  int _numActiveRuns;
   int _numBestRuns;
 
   int _done;
@@ -28,24 +28,8 @@
  */
 
 #include "AlgorithmRun.hh"
-#include "threads.hh"
-
-/****************************************************************/
-/************************ GARP Run Thread ***********************/
-
-// TODO: modify strategy to reuse threads instead of creating a 
-//       new one for every garp run
-
-THREAD_PROC_RETURN_TYPE AlgorithmRunThreadProc(void * threadData)
-{
-  AlgorithmRun * algRun = (AlgorithmRun *) threadData;
-
-  algRun->createModel();
-
-  algRun->stop();
-  THREAD_PROC_RETURN_STATEMENT;
-}
 
+#include <openmodeller/Exceptions.hh>
 
 /****************************************************************/
 /************************* GARP Run *****************************/
@@ -53,12 +37,11 @@ THREAD_PROC_RETURN_TYPE AlgorithmRunThreadProc(void * threadData)
 AlgorithmRun::AlgorithmRun(const AlgorithmPtr& algo) :
   _alg( algo ),
   _id(-1),
-  _running( false ),
   _omission( -1.0 ),
   _commission( -1.0 ),
-  _commission_samples( 0 ),
-  _train_sampler(),
-  _test_sampler()
+  _samples( NULL ),
+  _test(),
+  _train_sampler()
 {
 
 }
@@ -70,43 +53,38 @@ AlgorithmRun::~AlgorithmRun()
 }
 
 /****************************************************************/
-int AlgorithmRun::initialize(int id, int comm_samples,
+int AlgorithmRun::initialize(int id, const SharedSamples * samples,
 			     const SamplerPtr& train_sampler, 
-			     const SamplerPtr& test_sampler ) 
+			     const std::vector<int>& test ) 
 {
   _id = id;
-  _commission_samples = comm_samples;
+  _samples = samples;
+  _test = test;
 
   _train_sampler = train_sampler;
-  _test_sampler = test_sampler;
 
   return 1;
 }
 
 /****************************************************************/
-void AlgorithmRun::run()
-{
-  _running = true;
-  THREAD_START(AlgorithmRunThreadProc, this); 
-}
-
-void AlgorithmRun::stop()
-{
-  _running = false;
-  THREAD_END();
-}
-
-
-/****************************************************************/
-bool AlgorithmRun::running() const
+void AlgorithmRun::execute()
 {
-  return _running;
+  createModel();
 }
 
 /****************************************************************/
 void AlgorithmRun::createModel()
 {
-  _alg->createModel( _train_sampler );
+  // The algorithm was already initialized with the train sampler, so
+  // only iterate here (AlgorithmImpl::createModel would initialize it
+  // again, drawing pseudo absences from the environment).
+  int resultFlag = 1;
+
+  while ( resultFlag && ! _alg->done() )
+  { resultFlag = _alg->iterate(); }
+
+  if ( ! _alg->done() || ! _alg->finalize() )
+  { throw AlgorithmException( "Algorithm could not produce a model.\n" ); }
 
 #if 1
   calculateCommission();
@@ -129,34 +107,9 @@ float AlgorithmRun::getProgress() const
 /****************************************************************/
 int AlgorithmRun::calculateCommission()           
 {
-  int i;
-  double sum = 0.0;
-
-  // TODO: check how to use absences in computing commission
-
-  // get random points from the background to estimate 
-  // area predicted present
-  bool hasAbsences = (_train_sampler->numAbsence() != 0);
-  for (i = 0; i < _commission_samples; i++) {
-
-    Scalar value;
-    if (hasAbsences) {
-
-      ConstOccurrencePtr occ = _train_sampler->getAbsence();
-      value = _alg->getValue(occ->environment());
-    }
-    else {
-
-      OccurrencePtr occ = _train_sampler->getPseudoAbsence();
-      value = _alg->getValue(occ->environment());
-    }
-
-    // discard novalue (-1); zero is irrelevant to the sum
-    if (value > 0)
-      sum += value;
-  }
-
-  _commission = sum / (double) _commission_samples;
+  // use the background points (sampled before the run started)
+  // to estimate area predicted present
+  _commission = _samples->getCommission( *_alg );
 
   return 1;
 }
@@ -166,26 +119,8 @@ int AlgorithmRun::calculateOmission()
 {
   // TODO: check how to use absences in computing omission
 
-  // test which kind of test (intrinsic or extrinsic) should be performed
-  SamplerPtr sampler;
-
-  if (!_test_sampler)
-    { sampler = _train_sampler; }
-  else
-    { sampler = _test_sampler; }
-
-  int nomitted = 0;
-  OccurrencesPtr presences = sampler->getPresences();
-  OccurrencesImpl::const_iterator it  = presences->begin();
-  OccurrencesImpl::const_iterator end = presences->end();
-
-  while (it != end)
-    {
-      nomitted = !_alg->getValue((*it)->environment()); 
-      ++it;
-    }
-
-  _omission = (double) nomitted / (double) presences->numOccurrences();
+  // extrinsic test, or intrinsic when there are no test points
+  _omission = _samples->getOmission( *_alg, _test );
 
   return 1;
 }
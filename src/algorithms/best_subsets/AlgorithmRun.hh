@@ -33,6 +33,11 @@
 
 #include <openmodeller/om.hh>
 
+#include "RunQueue.hh"
+#include "SharedSamples.hh"
+
+#include <vector>
+
 class AlgorithmImpl;
 class AlgParameter;
 
@@ -41,25 +46,24 @@ class AlgParameter;
 
 /**
   * Wraps up a single Algorithm run and its results (calculated error
-  * components). Also handles multi-threading aspects of
-  * computation.
+  * components). Runs are executed by the worker threads of a
+  * RunQueue, so the algorithm must be initialized before the run is
+  * submitted (initialization is what samples the environment).
   */
-class AlgorithmRun
+class AlgorithmRun : public QueuedRun
 {
 public:
   AlgorithmRun( const AlgorithmPtr& algo );
   ~AlgorithmRun();
 
-  int initialize(int id, int comm_samples,
+  int initialize(int id, const SharedSamples * samples,
 		 const SamplerPtr& train_sampler, 
-		 const SamplerPtr& test_sampler );
-  void run();
-  void stop();
+		 const std::vector<int>& test );
 
+  void execute();
 
   void createModel();
 
-  bool running() const;
   int getId() const { return _id; }
   float getProgress() const;
   double getOmission() const;
@@ -77,12 +81,11 @@ private:
   AlgorithmPtr _alg;      /// Algorithm used in this run
 
   int _id;                   /// Identified for this particular garp run
-  bool _running;             /// Indicates whether the thread is running
   double _omission;          /// Omission error for this run
   double _commission;        /// Commission error, approximated by area predicted present
-  int _commission_samples;   /// Number of points used to calculate commission
+  const SharedSamples * _samples; /// Points used to calculate errors
+  std::vector<int> _test;    /// Test presences (rows of the presence matrix)
   SamplerPtr _train_sampler;
-  SamplerPtr _test_sampler;
 
   AlgorithmRun( const AlgorithmRun& );
   AlgorithmRun& operator=(const AlgorithmRun& );
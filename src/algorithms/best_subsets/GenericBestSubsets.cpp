@@ -174,7 +174,7 @@ AlgParamMetadata parameters_bs[NUM_PARAM] =
     "Maximum number of threads of executions to run simultaneously.",
 
     // Description.
-    "",
+    "Maximum number of threads of executions to run simultaneously. Only algorithms that do not read the environmental layers during training (such as GARP) can be executed simultaneously. Other algorithms are executed one at a time.",
 
     1,        // Not zero if the parameter has lower limit.
     1,        // Parameter's lower limit.
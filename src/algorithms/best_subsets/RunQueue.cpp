@@ -0,0 +1,152 @@
+/**
+ * Definition of RunQueue class
+ *
+ * @file   RunQueue.cpp
+ * $Id$
+ *
+ * LICENSE INFORMATION
+ *
+ * Copyright(c) 2026 by CRIA -
+ * Centro de Referencia em Informacao Ambiental
+ *
+ * http://www.cria.org.br
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details:
+ *
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "RunQueue.hh"
+
+#include <openmodeller/Log.hh>
+
+#include <exception>
+
+/****************************************************************/
+/************************** Queued Run **************************/
+
+QueuedRun::QueuedRun() :
+  _queue( NULL ),
+  _failed( false ),
+  _started( false ),
+  _finished( false )
+{
+
+}
+
+/****************************************************************/
+QueuedRun::~QueuedRun()
+{
+
+}
+
+/****************************************************************/
+void QueuedRun::run( int worker )
+{
+  {
+    ScopedLock lock( _queue->_mutex );
+    _started = true;
+  }
+
+  try {
+
+    execute();
+  }
+  catch ( std::exception& e ) {
+
+    Log::instance()->error( "Best subsets run failed in worker %d: %s\n", worker, e.what() );
+    _failed = true;
+  }
+  catch ( ... ) {
+
+    Log::instance()->error( "Best subsets run failed in worker %d\n", worker );
+    _failed = true;
+  }
+
+  ScopedLock lock( _queue->_mutex );
+  _finished = true;
+  ++_queue->_numFinished;
+}
+
+
+/****************************************************************/
+/*************************** Run Queue **************************/
+
+RunQueue::RunQueue( int numThreads, bool overlap ) :
+  _overlap( overlap ),
+  _pool( overlap ? numThreads : 1 ),
+  _runs(),
+  _mutex(),
+  _numFinished( 0 )
+{
+
+}
+
+/****************************************************************/
+RunQueue::~RunQueue()
+{
+  _pool.cancelPending();
+  _pool.waitAll();
+
+  for ( unsigned int i = 0; i < _runs.size(); i++ )
+  { delete _runs[i]; }
+}
+
+/****************************************************************/
+void RunQueue::submit( QueuedRun * run )
+{
+  run->_queue = this;
+  run->_failed = false;
+  run->_started = false;
+  run->_finished = false;
+
+  _runs.push_back( run );
+  _pool.submit( run );
+}
+
+/****************************************************************/
+QueuedRun * RunQueue::next()
+{
+  int i = _pool.waitForAny( _runs );
+
+  if ( i < 0 )
+  { return NULL; }
+
+  QueuedRun * run = static_cast<QueuedRun *>( _runs[i] );
+  _runs.erase( _runs.begin() + i );
+
+  return run;
+}
+
+/****************************************************************/
+int RunQueue::cancelPending()
+{
+  return _pool.cancelPending();
+}
+
+/****************************************************************/
+float RunQueue::getProgress() const
+{
+  ScopedLock lock( _mutex );
+
+  float progress = (float) _numFinished;
+
+  for ( unsigned int i = 0; i < _runs.size(); i++ )
+  {
+    QueuedRun * run = static_cast<QueuedRun *>( _runs[i] );
+
+    if ( run->_started && ! run->_finished )
+    { progress += run->getProgress(); }
+  }
+
+  return progress;
+}
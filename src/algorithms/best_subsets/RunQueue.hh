@@ -0,0 +1,144 @@
+/**
+ * Declaration of RunQueue class
+ *
+ * @file   RunQueue.hh
+ * $Id$
+ *
+ * LICENSE INFORMATION
+ *
+ * Copyright(c) 2026 by CRIA -
+ * Centro de Referencia em Informacao Ambiental
+ *
+ * http://www.cria.org.br
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details:
+ *
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#ifndef _RUN_QUEUE_HH_
+#define _RUN_QUEUE_HH_
+
+#include <openmodeller/ThreadPool.hh>
+
+#include <vector>
+
+class RunQueue;
+
+/****************************************************************/
+/************************** Queued Run **************************/
+
+/**
+  * A single run of the sub algorithm of a best subsets procedure,
+  * executed by a worker thread of a RunQueue. Everything that needs
+  * the environmental layers (which are not thread safe) must be done
+  * before the run is submitted.
+  */
+class QueuedRun : public ThreadPoolTask
+{
+public:
+  QueuedRun();
+  virtual ~QueuedRun();
+
+  /** Build the model and calculate its errors. */
+  virtual void execute() = 0;
+
+  /** Progress of the run, between 0 and 1. */
+  virtual float getProgress() const = 0;
+
+  /** Indicates if execute threw an exception (already logged). */
+  bool failed() const { return _failed; }
+
+  void run( int worker );
+
+private:
+  friend class RunQueue;
+
+  RunQueue * _queue;
+  bool _failed;
+  bool _started;             /// Protected by the mutex of the queue
+  bool _finished;            /// Protected by the mutex of the queue
+};
+
+
+/****************************************************************/
+/*************************** Run Queue **************************/
+
+/**
+  * Work queue shared by the best subsets algorithms. Runs are executed
+  * in submission order by a fixed pool of worker threads, and the
+  * caller blocks on a condition variable until one of them finishes
+  * instead of polling. Runs are owned by the caller, except while they
+  * are in the queue (between submit and next).
+  */
+class RunQueue
+{
+public:
+  /** Constructor.
+   * @param numThreads Number of worker threads.
+   * @param overlap Indicates if runs can be submitted while others are
+   *  executed. Otherwise a single worker is used and only one run is
+   *  in the queue at a time, so the caller never prepares a run while
+   *  another one is executed (see AlgorithmImpl::supportsConcurrentTraining).
+   */
+  RunQueue( int numThreads, bool overlap = true );
+
+  /** Destructor. Cancels queued runs, waits for running ones and
+   *  deletes all runs that were not returned by next. */
+  ~RunQueue();
+
+  /** Number of runs submitted and not returned by next yet. */
+  int size() const { return (int)_runs.size(); }
+
+  /** Indicates if there are enough runs in the queue to keep all
+   *  workers busy until the next one is returned. */
+  bool full() const { return size() >= ( _overlap ? 2 * _pool.numThreads() : 1 ); }
+
+  /** Queue a run to be executed by the next available worker. */
+  void submit( QueuedRun * run );
+
+  /** Block until one of the runs in the queue is finished or cancelled
+   *  and remove it from the queue (see ThreadPoolTask::cancelled).
+   * @return The run, or NULL if the queue is empty.
+   */
+  QueuedRun * next();
+
+  /** Cancel all runs that were not started yet. They are still
+   *  returned by next, flagged as cancelled.
+   * @return Number of cancelled runs.
+   */
+  int cancelPending();
+
+  /** Number of runs finished so far plus the progress of the ones
+   *  being executed. */
+  float getProgress() const;
+
+private:
+  friend class QueuedRun;
+
+  bool _overlap;
+
+  ThreadPool _pool;
+
+  std::vector<ThreadPoolTask *> _runs;
+
+  mutable Mutex _mutex;
+
+  int _numFinished;          /// Protected by _mutex
+
+  RunQueue( const RunQueue& );
+  RunQueue& operator=( const RunQueue& );
+};
+
+
+#endif
@@ -0,0 +1,220 @@
+/**
+ * Definition of SharedSamples class
+ *
+ * @file   SharedSamples.cpp
+ * $Id$
+ *
+ * LICENSE INFORMATION
+ *
+ * Copyright(c) 2026 by CRIA -
+ * Centro de Referencia em Informacao Ambiental
+ *
+ * http://www.cria.org.br
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details:
+ *
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifdef WIN32
+// avoid warnings caused by problems in VC headers
+#define _SCL_SECURE_NO_DEPRECATE
+#endif
+
+#include "SharedSamples.hh"
+
+#include <openmodeller/Exceptions.hh>
+
+#include <algorithm>
+
+/****************************************************************/
+// Copy the environment of the points to a row major matrix.
+static void copyEnvironment( const OccurrencesPtr& occs, int dim,
+                             std::vector<Scalar>& matrix )
+{
+  matrix.reserve( matrix.size() + occs->numOccurrences() * dim );
+
+  OccurrencesImpl::const_iterator it  = occs->begin();
+  OccurrencesImpl::const_iterator end = occs->end();
+
+  while (it != end)
+    {
+      const Sample& sample = (*it)->environment();
+      matrix.insert( matrix.end(), sample.begin(), sample.end() );
+      ++it;
+    }
+}
+
+/****************************************************************/
+// Same procedure used by splitOccurrences, but points are shared
+// instead of copied.
+static void splitPoints( const OccurrencesPtr& occs, double propTrain,
+                         OccurrencesPtr& train, std::vector<int> * test )
+{
+  int i;
+  int n = occs->numOccurrences();
+  int k = (int) (n * propTrain);
+  std::vector<int> goToTrainSet(n);
+
+  // first k are set to go to train set
+  for (i = 0; i < k; i++)
+  { goToTrainSet[i] = 1; }
+
+  // all others are set to go to test set
+  for ( ; i < n; i++)
+  { goToTrainSet[i] = 0; }
+
+  // shuffle elements well
+  initRandom();
+
+  std::random_shuffle( goToTrainSet.begin(), goToTrainSet.end() );
+
+  train = new OccurrencesImpl( occs->label(), occs->coordSystem() );
+  train->reserve( k );
+
+  OccurrencesImpl::const_iterator it = occs->begin();
+
+  for (i = 0; i < n; ++i, ++it)
+    {
+      if (goToTrainSet[i])
+        { train->insert( *it ); }
+      else if (test)
+        { test->push_back( i ); }
+    }
+}
+
+
+/****************************************************************/
+/************************ Shared Samples ************************/
+
+SharedSamples::SharedSamples( const SamplerPtr& samp, int backgroundSize ) :
+  _samp( samp ),
+  _dim( samp->numIndependent() ),
+  _numCategorical( 0 ),
+  _numPresences( samp->numPresence() ),
+  _numBackground( 0 ),
+  _presences(),
+  _background()
+{
+  EnvironmentPtr env = samp->getEnvironment();
+
+  // categorical layers come first in each point
+  if (env)
+  { _numCategorical = (int) env->numCategoricalLayers(); }
+
+  if (_numPresences)
+  { copyEnvironment( samp->getPresences(), _dim, _presences ); }
+
+  if (samp->numAbsence())
+  {
+    _numBackground = samp->numAbsence();
+    copyEnvironment( samp->getAbsences(), _dim, _background );
+  }
+  else if (backgroundSize > 0)
+  {
+    _numBackground = backgroundSize;
+    _background.reserve( backgroundSize * _dim );
+
+    for (int i = 0; i < backgroundSize; i++)
+    {
+      OccurrencePtr occ = samp->getPseudoAbsence();
+      const Sample& sample = occ->environment();
+      _background.insert( _background.end(), sample.begin(), sample.end() );
+    }
+  }
+}
+
+/****************************************************************/
+void SharedSamples::split( double propTrain, SamplerPtr * train,
+                           std::vector<int> * test ) const
+{
+  OccurrencesPtr train_presence;
+  OccurrencesPtr train_absence;
+
+  test->clear();
+
+  OccurrencesPtr presence = _samp->getPresences();
+
+  if (presence)
+  { splitPoints( presence, propTrain, train_presence, test ); }
+
+  OccurrencesPtr absence = _samp->getAbsences();
+
+  if (absence)
+  { splitPoints( absence, propTrain, train_absence, NULL ); }
+
+  *train = new SamplerImpl( _samp->getEnvironment(),
+                            train_presence, train_absence,
+                            _samp->isNormalized() );
+}
+
+/****************************************************************/
+double SharedSamples::getOmission( const AlgorithmImpl& alg,
+                                   const std::vector<int>& rows ) const
+{
+  int n = rows.empty() ? _numPresences : (int) rows.size();
+
+  if (!n)
+  { throw AlgorithmException( "No presence points available to calculate omission.\n" ); }
+
+  std::vector<Scalar> values(n);
+
+  if (rows.empty())
+  {
+    alg.getValues( &_presences[0], n, _dim, _numCategorical, &values[0] );
+  }
+  else
+  {
+    std::vector<Scalar> samples(n * _dim);
+
+    for (int i = 0; i < n; i++)
+    {
+      std::copy( _presences.begin() + rows[i] * _dim,
+                 _presences.begin() + (rows[i] + 1) * _dim,
+                 samples.begin() + i * _dim );
+    }
+
+    alg.getValues( &samples[0], n, _dim, _numCategorical, &values[0] );
+  }
+
+  int nomitted = 0;
+
+  for (int i = 0; i < n; i++)
+  {
+    if (!values[i])
+    { nomitted++; }
+  }
+
+  return (double) nomitted / (double) n;
+}
+
+/****************************************************************/
+double SharedSamples::getCommission( const AlgorithmImpl& alg ) const
+{
+  if (!_numBackground)
+  { throw AlgorithmException( "No points available to calculate commission.\n" ); }
+
+  std::vector<Scalar> values(_numBackground);
+
+  alg.getValues( &_background[0], _numBackground, _dim, _numCategorical, &values[0] );
+
+  double sum = 0.0;
+
+  for (int i = 0; i < _numBackground; i++)
+  {
+    // discard novalue (-1); zero is irrelevant to the sum
+    if (values[i] > 0)
+    { sum += values[i]; }
+  }
+
+  return sum / (double) _numBackground;
+}
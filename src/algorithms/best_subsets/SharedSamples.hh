@@ -0,0 +1,99 @@
+/**
+ * Declaration of SharedSamples class
+ *
+ * @file   SharedSamples.hh
+ * $Id$
+ *
+ * LICENSE INFORMATION
+ *
+ * Copyright(c) 2026 by CRIA -
+ * Centro de Referencia em Informacao Ambiental
+ *
+ * http://www.cria.org.br
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details:
+ *
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#ifndef _SHARED_SAMPLES_HH_
+#define _SHARED_SAMPLES_HH_
+
+#include <openmodeller/om.hh>
+
+#include <vector>
+
+/****************************************************************/
+/************************ Shared Samples ************************/
+
+/**
+  * Points used to split and score all runs of a best subsets
+  * procedure. The environmental values of the presences and of the
+  * background (used to estimate commission) are copied once into
+  * row major matrices, which are read only and can be used by all
+  * runs at the same time, from any thread. Runs are scored with
+  * AlgorithmImpl::getValues on these matrices.
+  */
+class SharedSamples
+{
+public:
+  /** Constructor. Samples the environment, so it must be called
+   *  before any run is submitted.
+   * @param samp Sampler of the best subsets algorithm.
+   * @param backgroundSize Number of pseudo absences used as background
+   *  when the sampler has no absences (otherwise all absences are used).
+   */
+  SharedSamples( const SamplerPtr& samp, int backgroundSize );
+
+  int dimension() const { return _dim; }
+  int numPresences() const { return _numPresences; }
+  int numBackground() const { return _numBackground; }
+
+  /** Randomly split points like splitSampler, without copying them.
+   * @param propTrain Proportion of points used to train.
+   * @param train Returns a sampler sharing the training points with
+   *  the original sampler.
+   * @param test Returns the test presences (rows of the presence matrix).
+   */
+  void split( double propTrain, SamplerPtr * train, std::vector<int> * test ) const;
+
+  /** Proportion of presences predicted absent by a model.
+   * @param rows Presences to be tested. All presences are tested when
+   *  empty (intrinsic test).
+   */
+  double getOmission( const AlgorithmImpl& alg, const std::vector<int>& rows ) const;
+
+  /** Average prediction of a model over the background, which
+   *  approximates the area predicted present. */
+  double getCommission( const AlgorithmImpl& alg ) const;
+
+private:
+  SamplerPtr _samp;
+
+  int _dim;
+  int _numCategorical;
+  int _numPresences;
+  int _numBackground;
+
+  /// Environmental values of presence i are stored at i * dim
+  std::vector<Scalar> _presences;
+
+  /// Environmental values of background point i are stored at i * dim
+  std::vector<Scalar> _background;
+
+  SharedSamples( const SharedSamples& );
+  SharedSamples& operator=( const SharedSamples& );
+};
+
+
+#endif
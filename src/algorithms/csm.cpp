@@ -25,8 +25,16 @@
 //for gsl_cdf_chisq_Q
 #include <gsl/gsl_cdf.h>
 
+#include <gsl/gsl_blas.h>
+
 #include <math.h>
 
+// Maximum number of layers handled by getValue without allocating memory.
+#define CSM_STACK_LAYERS 64
+
+// Number of points projected with each matrix product by getValues.
+#define CSM_BLOCK_SIZE 256
+
 #ifdef MSVC
 #include <float.h>
 #define isnan _isnan
@@ -254,6 +262,7 @@ int Csm::center()
   */
 int Csm::iterate()
 {
+  _compile();
   _done=1;
   return 1;
 }
@@ -282,115 +291,145 @@ int Csm::done() const
   * @param Scalar *x a pointer to a vector of openModeller Scalar type (currently double). The vector should contain values looked up on the environmental variable layers into which the mode is being projected. */
 Scalar Csm::getValue( const Sample& x ) const
 {
+  // scratch space for the centered and projected point
+  double myStackBuffer[2*CSM_STACK_LAYERS];
+  std::vector<double> myHeapBuffer;
+  double * myCentered = myStackBuffer;
 
-  float myFloat;
-  //bool myAllAreZeroFlag=true;
-  //first thing we do is convert the oM primitive env value array to a gsl matrix
-  //with only one row so we can do matrix multplication with it
-  gsl_matrix * tmp_gsl_matrix = gsl_matrix_alloc (1,_layer_count);
-  gsl_matrix * tmp_raw_gsl_matrix = gsl_matrix_alloc (1,_layer_count);
-  for (signed int i = 0;i<_layer_count;++i)
+  if (_layer_count > CSM_STACK_LAYERS)
   {
-    myFloat = static_cast<float>(x[i]);
-    gsl_matrix_set (tmp_raw_gsl_matrix,0,i,myFloat);
-
-    //if (myFloat!=0)
-    //{
-    //  myAllAreZeroFlag=false;
-    //}
-    //Log::instance()->debug( "myFloat = %f\n", myFloat );
-    //get the stddev and mean for this column
-    float myAverage = (float)gsl_vector_get (_gsl_avg_vector,i);
-    float myStdDev = (float)gsl_vector_get (_gsl_stddev_vector,i);
-    //subtract the mean from the value then divide by the standard deviation
-    if (myStdDev > 0)
+    myHeapBuffer.resize(2*_layer_count);
+    myCentered = &myHeapBuffer[0];
+  }
+
+  double * z = myCentered + _layer_count;
+
+  _centerPoint(x.begin(), myCentered);
+
+  _project(myCentered, 1, z);
+
+  return _probability(z);
+}
+
+/** Batch version of getValue. */
+void Csm::getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const
+{
+  if (numSamples <= 0)
+  {
+    return;
+  }
+
+  int myBlockSize = (numSamples < CSM_BLOCK_SIZE) ? numSamples : CSM_BLOCK_SIZE;
+
+  std::vector<double> myCentered(myBlockSize * _layer_count);
+  std::vector<double> z(myBlockSize * _retained_components_count);
+
+  for (int myFirst = 0; myFirst < numSamples; myFirst += myBlockSize)
+  {
+    int n = (numSamples - myFirst < myBlockSize) ? numSamples - myFirst : myBlockSize;
+
+    for (int i = 0; i < n; ++i)
     {
-      myFloat = (myFloat-myAverage)/myStdDev;
+      _centerPoint(samples + (myFirst+i)*dim, &myCentered[i*_layer_count]);
     }
-    else
+
+    // project the whole block with a single matrix product
+    _project(&myCentered[0], n, &z[0]);
+
+    for (int i = 0; i < n; ++i)
     {
-      myFloat=myFloat-myAverage;
+      values[myFirst+i] = _probability(&z[i*_retained_components_count]);
     }
-    //assign the result to our vector
-    gsl_matrix_set (tmp_gsl_matrix,0,i,myFloat);
-    //Log::instance()->debug( "myFloat = %f\n", myFloat );
   }
-  //Log::instance()->debug( " ----  end of scalar \n");
-  displayMatrix(tmp_raw_gsl_matrix,"Voxel passed to getValue",false);
-  displayMatrix(tmp_gsl_matrix,"Voxel passed to getValue -Mean / stddev");
-  displayVector(_gsl_avg_vector,"Averages");
-  displayVector(_gsl_stddev_vector,"Stddevs");
-  //if (myAllAreZeroFlag) {return 0;}
+}
+
+/** Copy the parts of the model needed for projection into plain arrays. */
+void Csm::_compile()
+{
+  int r = _retained_components_count;
 
+  _center.resize(_layer_count);
+  _scale.resize(_layer_count);
+  _projection.resize(_layer_count * r);
+  _sqrt_eigenvalues.resize(r);
 
-  gsl_matrix * z = product(tmp_gsl_matrix, _gsl_eigenvector_matrix);
-  displayMatrix(z,"z - Product of voxel passed to getValue -Mean / stddev");
+  for (int i = 0; i < _layer_count; ++i)
+  {
+    _center[i] = (float)gsl_vector_get (_gsl_avg_vector,i);
+    _scale[i] = (float)gsl_vector_get (_gsl_stddev_vector,i);
 
-  // z should match the dimensions of tmp_gsl_matrix so do some error checking
-  if (z->size1 != tmp_gsl_matrix->size1)
+    for (int j = 0; j < r; ++j)
+    {
+      _projection[i*r + j] = gsl_matrix_get (_gsl_eigenvector_matrix,i,j);
+    }
+  }
+
+  for (int j = 0; j < r; ++j)
   {
-    Log::instance()->warn( "Error during creation of product Z in CSM getValue - number of rows don't match\n" );
-    exit(0);
+    _sqrt_eigenvalues[j] = sqrt(gsl_vector_get(_gsl_eigenvalue_vector,j));
   }
+}
 
-  // number of cols in z should == number of components
-  if (z->size2 != tmp_gsl_matrix->size1)
+/** Center and standardise a point with the mean and stddev of the localities. */
+void Csm::_centerPoint( const Scalar * x, double * centered ) const
+{
+  for (int i = 0; i < _layer_count; ++i)
   {
-    //Log::instance()->warn( "Error during creation of product Z in CSM getValue - number of cols don't match number of components\n" );
-    //exit(0);
+    float myFloat = static_cast<float>(x[i]);
+    //subtract the mean from the value then divide by the standard deviation
+    if (_scale[i] > 0)
+    {
+      myFloat = (myFloat-_center[i])/_scale[i];
+    }
+    else
+    {
+      myFloat = myFloat-_center[i];
+    }
+    centered[i] = myFloat;
   }
+}
+
+/** Multiply centered points by the retained eigen vectors. */
+void Csm::_project( const double * centered, int n, double * z ) const
+{
+  gsl_matrix_const_view myCentered = gsl_matrix_const_view_array(centered, n, _layer_count);
+  gsl_matrix_const_view myProjection = gsl_matrix_const_view_array(&_projection[0], _layer_count, _retained_components_count);
+  gsl_matrix_view myZ = gsl_matrix_view_array(z, n, _retained_components_count);
 
-  //displayMatrix(z,"z ");
+  gsl_blas_dgemm(CblasNoTrans, CblasNoTrans,
+                 1.0, &myCentered.matrix, &myProjection.matrix,
+                 0.0, &myZ.matrix);
+}
+
+/** Probability of a projected point. */
+Scalar Csm::_probability( const double * z ) const
+{
   // now we standardise the values in z
   // we do this by dividing each element in z by the square root of its associated element in
-  // the eigenvalues vector
-
-  for (unsigned int i=0;i<z->size2;i++)
-  {
-    gsl_matrix_set(z,0,i,gsl_matrix_get (z,0,i)/sqrt(gsl_vector_get(_gsl_eigenvalue_vector,i)));
-  }
-  displayMatrix(z,"Standardised : Each value in z / sqrt of associated element in the eigenvalues vector");
-  // now we square each element and sum them
+  // the eigenvalues vector, then we square each element and sum them
   double mySumOfSquares=0;
-  for (unsigned int i=0;i<z->size2;i++)
+  for (int i=0;i<_retained_components_count;i++)
   {
-    double myValue=gsl_matrix_get (z,0,i);
+    double myValue=z[i]/_sqrt_eigenvalues[i];
     if (!isnan(myValue))
     {
-      mySumOfSquares+= pow(gsl_matrix_get (z,0,i), 2);
-      //Warning uncommenting the next line will spew a lot of stuff to stderr!!!!
-      //Log::instance()->debug( "myValue : %f Cumulative : %f\n", myValue , myFloat );
+      mySumOfSquares+= pow(myValue, 2);
     }
   }
   
   //now work out the probability of myFloat between 0 and 1
-  double myHalfComponentCountDouble=(z->size2)/2;
-  double myHalfSumOfSquaresDouble=mySumOfSquares/2;
-  //Log::instance()->debug( "Component count %f , Half sum of squares %f\n", myHalfComponentCountDouble, myHalfSumOfSquaresDouble );
-  //
-  //This way id deprecated in favour of the chi square test
-  //
-  //float myProbability=1-gsl_sf_gamma_inc_Q (myHalfSumOfSquaresDouble,myHalfComponentCountDouble);
-  //float myProbability=1-gsl_ran_chisq_pdf(mySumOfSquares,z->size2);
-  double myProbability=gsl_cdf_chisq_Q(mySumOfSquares,z->size2);
+  double myProbability=gsl_cdf_chisq_Q(mySumOfSquares,_retained_components_count);
   if (verboseDebuggingBool)
   {
     printf("\n-------------------------------\n");
-    printf("Component count : %u\n",static_cast<unsigned int>(z->size2));
-    printf("Component count / 2: %f\n",myHalfComponentCountDouble);
+    printf("Component count : %u\n",static_cast<unsigned int>(_retained_components_count));
+    printf("Component count / 2: %f\n",(double)(_retained_components_count/2));
     printf("Sum of squares : %f\n",mySumOfSquares);
-    printf("Sum of squares / 2: %f\n",myHalfSumOfSquaresDouble);
+    printf("Sum of squares / 2: %f\n",mySumOfSquares/2);
     printf("Probability: %f\n\n", myProbability);
     printf("-------------------------------\n");
-    
   }
 
-  //Log::instance()->debug( "Prob: %f \r", myProbability);
-  //now clear away the temporary vars
-  gsl_matrix_free (z);
-  //gsl_vector_free (component1_gsl_vector);
-  gsl_matrix_free (tmp_gsl_matrix);
-  gsl_matrix_free (tmp_raw_gsl_matrix);
   return myProbability;
 }
 
@@ -813,5 +852,7 @@ Csm::_setConfiguration( const ConstConfigurationPtr& config )
     for (int j=0; j < _retained_components_count; ++j, ++cnt)
       gsl_matrix_set( _gsl_eigenvector_matrix, i, j, stl_vector[cnt] );
 
+  _compile();
+
   _done = true;
 }
@@ -38,6 +38,8 @@
 #include <openmodeller/om.hh>
 #include <gsl/gsl_matrix.h>
 
+#include <vector>
+
 /**
 
 Herewith follows a detailed explanation of the Climate Space Model (CSM). 
@@ -314,6 +316,12 @@ class Csm : public AlgorithmImpl
          * (currently double). The vector should contain values looked up on 
          * the environmental variable layers into which the mode is being projected. */
         Scalar getValue( const Sample& x ) const;
+        int supportsThreadedProjection() const { return 1; }
+
+        /** Batch version of getValue. Points are projected in blocks with a
+         * single matrix product and no memory is allocated per point.
+         * @note This method is inherited from the Algorithm class */
+        void getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const;
 
         /** Returns a value that represents the convergence of the algorithm
          * expressed as a number between 0 and 1 where 0 represents model
@@ -367,6 +375,30 @@ class Csm : public AlgorithmImpl
          */  
         virtual int discardComponents()=0;
 
+        /** Copy the parts of the model needed for projection into plain
+         * row-major arrays (see _center, _projection). Must be called after
+         * discarding components or deserializing the model.
+         */
+        void _compile();
+
+        /** Center and standardise a point with the mean and stddev of the localities.
+         * @param x Environmental values of the point
+         * @param centered Array with _layer_count positions to receive the result
+         */
+        void _centerPoint( const Scalar * x, double * centered ) const;
+
+        /** Multiply n centered points (row-major) by the retained eigen vectors.
+         * @param centered Row-major matrix with n rows of _layer_count values
+         * @param n Number of points
+         * @param z Array with n*_retained_components_count positions to receive the result
+         */
+        void _project( const double * centered, int n, double * z ) const;
+
+        /** Probability of a projected point (chi square test).
+         * @param z Projected point with _retained_components_count values
+         */
+        Scalar _probability( const double * z ) const;
+
 
 
         /** This a utility function to display the content of a gsl vector.
@@ -452,6 +484,15 @@ class Csm : public AlgorithmImpl
         /** Whether verbose debugging is enabled */
         bool verboseDebuggingBool;
 
+        /** Mean of each layer at the localities (see _compile) */
+        std::vector<float> _center;
+        /** Stddev of each layer at the localities */
+        std::vector<float> _scale;
+        /** Retained eigen vectors (layers x retained components) */
+        std::vector<double> _projection;
+        /** Square root of the retained eigen values */
+        std::vector<double> _sqrt_eigenvalues;
+
 };
 
 #endif
@@ -329,6 +329,11 @@ Scalar GarpAlgorithm::getValue( const Sample& x ) const
 {
   return objBest.getValue(x);
 }
+
+void GarpAlgorithm::getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const
+{
+  objBest.getValues(samples, numSamples, dim, values);
+}
   
 // ==========================================================================
 void GarpAlgorithm::initializeProperties()
@@ -665,6 +670,9 @@ void GarpAlgorithm::generate(EnvCellSet * objTrainSet)
 
 		// discard rules which performance is worse than the specified significance
 		objBest.discardRules(8, Significance);
+
+		// final rules are applied by getValue in their packed form
+		objBest.compile();
     }
 	else
 	{
@@ -1416,6 +1424,8 @@ GarpAlgorithm::_setConfiguration( const ConstConfigurationPtr& config )
     delete [] perf;
   }
 
+  objBest.compile();
+
   return;
 
 }
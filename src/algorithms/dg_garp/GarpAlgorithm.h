@@ -50,6 +50,9 @@ public:
 	int done() const;
 	float getProgress() const;
 	Scalar getValue( const Sample& x ) const;
+	int supportsThreadedProjection() const { return 1; }
+	int supportsConcurrentTraining() const { return 1; }
+	void getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const;
 	int getConvergence( Scalar * const val ) const;
 	int getGeneration() { return Gen; }
 
@@ -29,6 +29,18 @@
 #include "EnvCellSet.h"
 #include "Utilities.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// kinds of packed rules (see RuleSet::compile)
+#define PACKED_RANGE    0  // all genes within bounds
+#define PACKED_NEGATED  1  // some gene out of bounds
+#define PACKED_VIRTUAL  2  // tested by Rule::applyToCell
+
+// number of pixels quantized at once by RuleSet::getValues
+#define PACKED_BLOCK_SIZE 256
+
 // ==========================================================================
 //  RuleSet implementation
 // ==========================================================================
@@ -43,6 +55,10 @@ RuleSet::RuleSet()
 
   // reset area counters
   iTotalArea = iPresenceArea = iAbsenceArea = iNonPredictedArea = 0;
+
+  _dim = 0;
+  _compiled = false;
+  _stride = 0;
 }
 
 // ==========================================================================
@@ -54,6 +70,8 @@ RuleSet::~RuleSet()
 // ==========================================================================
 void RuleSet::clear()
 {
+  _compiled = false;
+
   for (int i = 0; i < intRules; i++)
     if (objRules[i])
     {
@@ -71,6 +89,8 @@ void RuleSet::clear()
 // ==========================================================================
 void RuleSet::setActiveGenes(bool * bGeneIsActivePtr, int * iGeneIndexPtr, int iActiveGenesAux)
 {
+  _compiled = false;
+
   for (int i = 0; i < intRules; i++)
   {
     objRules[i]->bGeneIsActive = bGeneIsActivePtr;
@@ -160,11 +180,13 @@ int RuleSet::size()
 
 // ==========================================================================
 void RuleSet::set(int index, Rule * objRule)
-{ objRules[index] = objRule; }
+{ objRules[index] = objRule; _compiled = false; }
 
 // ==========================================================================
 void RuleSet::add(Rule * objRule)
 {
+  _compiled = false;
+
   if (objRule)
   {
     if (intRules < MAX_RULES - 1)
@@ -179,6 +201,8 @@ void RuleSet::add(Rule * objRule)
 // ==========================================================================
 void RuleSet::trim(int intMaxRules)
 {
+  _compiled = false;
+
   int intInitialRules = intRules;
   for (int i = intMaxRules; i < intInitialRules; i++)
   {
@@ -196,6 +220,8 @@ void RuleSet::discardRules(int iPerfIndex, double dValue)
 {
   int i, j;
 
+  _compiled = false;
+
   i = 0;
   while (i < intRules)
   {
@@ -264,6 +290,8 @@ void RuleSet::sort(int intPerfIndex)
 
   double dSum;
 
+  _compiled = false;
+
   dSum = 0.0;
   for (i = 0; i < this->intRules; i++)
     dSum += objRules[i]->dblPerformance[9];
@@ -408,9 +436,216 @@ double RuleSet::getOveralPerformance(int iPerfIndex, int iFirstRulesToBeIncluded
   return dResult;
 }
 
+// ==========================================================================
+void RuleSet::compile()
+{
+  int i, k, g, genes;
+
+  _compiled = false;
+  _lower.clear();
+  _upper.clear();
+  _kind.clear();
+  _ruleIndex.clear();
+
+  // first element of a cell is reserved for presence/absence value
+  genes = _dim - 1;
+
+  if ((genes < 0) || (genes >= MAX_ENV_LAYERS))
+    return;
+
+  // genes are compared 16 at a time
+  _stride = ((genes + 15) / 16) * 16;
+  if (_stride == 0)
+    _stride = 16;
+
+  for (i = 0; i < intRules; i++)
+  {
+    Rule * rule = objRules[i];
+
+    // same rules applyRulesToCell considers with no accuracy limit
+    if (!(rule->dblPerformance[5] >= 0.0))
+      continue;
+
+    char type = rule->type();
+    char kind = (type == '!') ? PACKED_NEGATED : PACKED_RANGE;
+
+    if ((type != 'd') && (type != '!') && (type != 'a'))
+      kind = PACKED_VIRTUAL;
+
+    // genes that are not tested accept any value
+    std::vector<BYTE> lower(_stride, 0);
+    std::vector<BYTE> upper(_stride, 255);
+
+    for (k = 1; (kind != PACKED_VIRTUAL) && (k < rule->iActiveGenes); k++)
+    {
+      g = rule->iGeneIndex ? rule->iGeneIndex[k] : -1;
+
+      if ((g < 1) || (g > genes) || (g * 2 + 1 >= rule->intLength))
+      {
+        // let the rule deal with it
+        kind = PACKED_VIRTUAL;
+        break;
+      }
+
+      BYTE a = rule->Gene[g * 2];
+      BYTE b = rule->Gene[g * 2 + 1];
+
+      if ((a == 0) && (b == 255))
+        continue;
+
+      if (type == 'a')
+      {
+        // atomic rules only compare the first value
+        lower[g - 1] = upper[g - 1] = a;
+      }
+      else
+      {
+        // GarpUtil::notBetween accepts bounds in any order
+        lower[g - 1] = (a < b) ? a : b;
+        upper[g - 1] = (a < b) ? b : a;
+      }
+    }
+
+    _lower.insert(_lower.end(), lower.begin(), lower.end());
+    _upper.insert(_upper.end(), upper.begin(), upper.end());
+    _kind.push_back(kind);
+    _ruleIndex.push_back(i);
+  }
+
+  _compiled = true;
+}
+
+// ==========================================================================
+void RuleSet::quantize(const Scalar * values, BYTE * bytes) const
+{
+  int i;
+
+  // first element of bytes is reserved for presence/absence value
+  bytes[0] = 0;
+
+  for (i = 1; i < _dim; i++)
+  {
+    // Guard against values outside the normalization range
+    // due to reprojection to a non-native range
+    Scalar value = values[i - 1];
+    if (value > 253.0) value = 253.0;
+    if (value < 1.0)   value = 1.0;
+
+    bytes[i] = (BYTE) value;
+  }
+
+  // padding, accepted by all packed rules
+  for (; i < _stride + 16; i++)
+    bytes[i] = 1;
+}
+
+// ==========================================================================
+// Checks if all genes are within bounds
+static inline bool genesWithin(const BYTE * genes, const BYTE * lower, 
+                               const BYTE * upper, int n)
+{
+#ifdef __SSE2__
+  for (int i = 0; i < n; i += 16)
+  {
+    __m128i v  = _mm_loadu_si128((const __m128i *) (genes + i));
+    __m128i lo = _mm_loadu_si128((const __m128i *) (lower + i));
+    __m128i hi = _mm_loadu_si128((const __m128i *) (upper + i));
+
+    // v >= lo if max(v, lo) == v, and v <= hi if min(v, hi) == v
+    __m128i ok = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, lo), v),
+                               _mm_cmpeq_epi8(_mm_min_epu8(v, hi), v));
+
+    if (_mm_movemask_epi8(ok) != 0xFFFF)
+      return false;
+  }
+#else
+  for (int i = 0; i < n; i++)
+    if ((genes[i] < lower[i]) || (genes[i] > upper[i]))
+      return false;
+#endif
+
+  return true;
+}
+
+// ==========================================================================
+int RuleSet::applyCompiledRules(BYTE * bytes) const
+{
+  EnvCell cell(_dim + 2, bytes);
+
+  int n = (int) _ruleIndex.size();
+
+  for (int r = 0; r < n; r++)
+  {
+    bool applies;
+
+    if (_kind[r] == PACKED_VIRTUAL)
+      applies = objRules[_ruleIndex[r]]->applyToCell(&cell);
+    else
+    {
+      applies = genesWithin(bytes + 1, &_lower[r * _stride], &_upper[r * _stride], _stride);
+
+      if (_kind[r] == PACKED_NEGATED)
+        applies = !applies;
+    }
+
+    // stop at the first rule that applies
+    if (applies)
+      return _ruleIndex[r];
+  }
+
+  return -1;
+}
+
+// ==========================================================================
+void RuleSet::getValues(const Scalar *samples, int numSamples, int dim, Scalar *values) const
+{
+  int first, p, n, ruleIndex;
+
+  if (!_compiled)
+  {
+    for (p = 0; p < numSamples; p++)
+      values[p] = getValue(Sample(dim, samples + p * dim));
+
+    return;
+  }
+
+  int cellSize = _stride + 16;
+  std::vector<BYTE> block(PACKED_BLOCK_SIZE * cellSize);
+
+  for (first = 0; first < numSamples; first += PACKED_BLOCK_SIZE)
+  {
+    n = (numSamples - first < PACKED_BLOCK_SIZE) ? numSamples - first : PACKED_BLOCK_SIZE;
+
+    // quantize the whole block before testing the rules
+    for (p = 0; p < n; p++)
+      quantize(samples + (first + p) * dim, &block[p * cellSize]);
+
+    for (p = 0; p < n; p++)
+    {
+      ruleIndex = applyCompiledRules(&block[p * cellSize]);
+
+      values[first + p] = (ruleIndex >= 0) ? (Scalar) (objRules[ruleIndex]->Gene[0]) : 0.0;
+    }
+  }
+}
+
 // ==========================================================================
 Scalar RuleSet::getValue(const Sample& sample) const
 {
+  if (_compiled)
+  {
+    BYTE bytes[MAX_ENV_LAYERS + 16];
+
+    quantize(sample.begin(), bytes);
+
+    int ruleIndex = applyCompiledRules(bytes);
+
+    if (ruleIndex >= 0)
+      return (Scalar) (objRules[ruleIndex]->Gene[0]);
+
+    return 0.0;
+  }
+
   // convert values to EnvCell
   BYTE bytes[256];
   EnvCell cell(_dim + 2, bytes);
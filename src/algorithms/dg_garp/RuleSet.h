@@ -25,6 +25,8 @@
 
 #include <openmodeller/om.hh>
 
+#include <vector>
+
 class EnvCell;
 class EnvCellSet;
 class Rule;
@@ -56,6 +58,17 @@ private:
 	void resetConfMatrix(EnvCellSet * objTestDataset);
 	void addConfMatrix(int iPredictedValue, int iActualValue);
 
+	// packed copy of the rules used to project the model (see compile)
+	bool _compiled;
+	int _stride;                 // bytes of each packed rule (multiple of 16)
+	std::vector<BYTE> _lower;    // lowest value accepted for each gene, by rule
+	std::vector<BYTE> _upper;    // highest value accepted for each gene, by rule
+	std::vector<char> _kind;     // how each packed rule is tested
+	std::vector<int> _ruleIndex; // position of each packed rule in objRules
+
+	void quantize(const Scalar * values, BYTE * bytes) const;
+	int applyCompiledRules(BYTE * bytes) const;
+
 public:
 	RuleSet();
 	virtual ~RuleSet();
@@ -93,7 +106,12 @@ public:
 	void set(int index, Rule * objRule);
 	Rule * get(int index);
 
+	// Prepares the rules to be applied by getValue and getValues. Must be
+	// called again whenever rules change.
+	void compile();
+
 	Scalar getValue(const Sample& sample) const;
+	void getValues(const Scalar *samples, int numSamples, int dim, Scalar *values) const;
 
 	void clear();
 	void sort(int intPerfIndex);
@@ -26,6 +26,14 @@
 
 #include "enfa.hh"
 
+#include <algorithm>
+
+// Maximum number of layers handled by getValue without allocating memory.
+#define ENFA_STACK_LAYERS 64
+
+// Number of points factored with each matrix product by getValues.
+#define ENFA_BLOCK_SIZE 256
+
 
 /****************************************************************/
 /********************** Algorithm's Metadata ********************/
@@ -573,100 +581,53 @@ int Enfa::done() const
   * @param Scalar *x a pointer to a vector of openModeller Scalar type (currently double). The vector should contain values looked up on the environmental variable layers into which the mode is being projected. */
 Scalar Enfa::getValue( const Sample& x ) const
 {
-    int ii, cellcount;
-    float myFloat;
-
-    //Log::instance()->info( "Enfa:getValue:entering getvalue\n" );
+    // scratch space for the centered and factored point
+    double stack_buffer[2*ENFA_STACK_LAYERS];
+    std::vector<double> heap_buffer;
+    double * centered = stack_buffer;
 
-    //first thing we do is convert the oM primitive env value array 
-    // to a gsl vector so we can use matrix multplication with it
-    gsl_vector * tmp_raw_gsl_vector = gsl_vector_alloc (_layer_count);
-    // center data using the avg and stdev
-    gsl_vector * tmp_centered_gsl_vector = gsl_vector_alloc(_layer_count);
-    double m1, m2, m3, m4;
-
-    for (ii=0;ii<_layer_count;++ii)
+    if (_layer_count > ENFA_STACK_LAYERS)
     {
-	myFloat = static_cast<float>(x[ii]);
-	gsl_vector_set (tmp_raw_gsl_vector,ii,myFloat);
-
-	m1=myFloat;
-	m2=gsl_vector_get(_gsl_avg_background_vector,ii);
-	m3=gsl_vector_get(_gsl_stddev_background_vector,ii);
-	m4=(m1-m2)/m3;
-	//Log::instance()->info( "getValue: m1: %6.2f, m2: %6.2f, m3: %6.2f, m4: %6.2f, \n", m1, m2, m3, m4 );
-	gsl_vector_set(tmp_centered_gsl_vector, ii, m4);
+	heap_buffer.resize(2*_layer_count);
+	centered = &heap_buffer[0];
     }
 
-    //if (_verboseDebug)
-    //{
-    //displayVector(tmp_raw_gsl_vector, "getvalue: tmp_raw_gsl_vector", true);
-    //displayVector(tmp_centered_gsl_vector, "getvalue: tmp_centered_gsl_vector", true);
-    //}
-
-    gsl_vector_free(tmp_raw_gsl_vector);
+    double * factors = centered + _layer_count;
 
-    //vector for factored data
-    gsl_matrix * tmp_centered_gsl_matrix = gsl_matrix_alloc(1,_layer_count);
-    for (ii=0;ii<_layer_count;++ii)
-      gsl_matrix_set(tmp_centered_gsl_matrix,0,ii,gsl_vector_get(tmp_centered_gsl_vector,ii));
+    _centerPoint(x.begin(), centered);
 
-    gsl_vector_free(tmp_centered_gsl_vector);
-
-    gsl_matrix * tmp_factored_gsl_matrix = gsl_matrix_alloc(1,_layer_count);
-    
-    // multiply centered data by score matrix to get factored data 
-    //gsl_blas_dgemv (CblasTrans, 1.0, _gsl_score_matrix, tmp_centered_gsl_vector, 0.0, tmp_factored_gsl_vector);
-    //gsl_blas_dgemv (CblasNoTrans, 1.0, _gsl_score_matrix, tmp_centered_gsl_vector, 0.0, tmp_factored_gsl_vector);
-
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans,
-		   1.0, tmp_centered_gsl_matrix, _gsl_score_matrix, 
-		   0.0, tmp_factored_gsl_matrix);
-
-    gsl_vector* tmp_factored_gsl_vector = gsl_vector_alloc(_layer_count);
-    for (ii=0;ii<_layer_count;++ii)
-      gsl_vector_set(tmp_factored_gsl_vector,ii,
-		     gsl_matrix_get(tmp_factored_gsl_matrix,0,ii));
-    
-    //if (_verboseDebug)
-    //displayVector(tmp_factored_gsl_vector, "getvalue: tmp_factored_gsl_vector", true);
-
-    // work out geomean from this point to all specimen localites
-    double tmp_geomean = getGeomean(tmp_factored_gsl_vector);
-    
-    gsl_matrix_free(tmp_centered_gsl_matrix);
-    gsl_matrix_free(tmp_factored_gsl_matrix);
-    gsl_vector_free(tmp_factored_gsl_vector);
-
-    //Log::instance()->info( "getValue: geomean %6.2f\n", tmp_geomean );
-    
+    _project(centered, 1, factors);
 
     /* % OK, now to convert these into habitat suitability values.
        % Determine what percentage of the species presence points
        % are further away from zero than this point */
-    
-    //cellcount=0;
-
-    //old version checking every value on unsorted vector
-    //for (ii=0; ii<_localityCount; ++ii)
-    //  if (gsl_vector_get(_gsl_geomean_vector,ii)>=tmp_geomean) cellcount+=1;
-    
-    // step up the sorted geomeans vector stop when current geomean is higher
-    // quickest when most cells are of low suitability
-    cellcount=_localityCount;
-    for (ii=_localityCount-1; ii>=0; --ii)
-      if (gsl_vector_get(_gsl_geomean_vector,ii)<=tmp_geomean)
-	{
-	  cellcount=_localityCount-ii-1;
-	  break;
-	}
+    return _suitability(_geomean(factors));
+}
 
-    //Log::instance()->info( "getValue: cellcount %i\n", cellcount );
-    Scalar myReturn=(Scalar)cellcount/_localityCount;
+/** Batch version of getValue. */
+void Enfa::getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const
+{
+    if (numSamples <= 0)
+      return;
+
+    int block = (numSamples < ENFA_BLOCK_SIZE) ? numSamples : ENFA_BLOCK_SIZE;
 
-    //Log::instance()->info( "enfa::getValue %6.2f\n", myReturn );
+    std::vector<double> centered(block * _layer_count);
+    std::vector<double> factors(block * _retained_components_count);
 
-    return myReturn;
+    for (int first=0; first<numSamples; first+=block)
+    {
+	int n = (numSamples - first < block) ? numSamples - first : block;
+
+	for (int p=0; p<n; ++p)
+	  _centerPoint(samples + (first+p)*dim, &centered[p*_layer_count]);
+
+	// factor the whole block with a single matrix product
+	_project(&centered[0], n, &factors[0]);
+
+	for (int p=0; p<n; ++p)
+	  values[first+p] = _suitability(_geomean(&factors[p*_retained_components_count]));
+    }
 }
 
 /** Returns a value that represents the convergence of the algorithm
@@ -884,85 +845,111 @@ gsl_matrix* Enfa::sqrtm(gsl_matrix* original_matrix) const
 }
 
 /*****************************************************************
- * Calculate the geometric mean of the distance from point v to 
-   all species observation points in factored environmental space
-   weighting each factor accordingly 
+ * Copy the parts of the model needed for projection into plain
+ * row-major arrays, so that projection does not need to allocate
+ * gsl objects for each point.
 *****************************************************************/
-double Enfa::getGeomean(gsl_vector* v) const
+void Enfa::_compile()
 {
+    int r = _retained_components_count;
+
+    _center.resize(_layer_count);
+    _scale.resize(_layer_count);
+    _projection.resize(_layer_count * r);
+    _weights.resize(r);
+    _locality_factors.resize(_localityCount * r);
 
-    //Log::instance()->info( "enfa::getGeomean\n" );
+    for (int i=0; i<_layer_count; ++i)
+    {
+	_center[i] = gsl_vector_get(_gsl_avg_background_vector, i);
+	_scale[i] = gsl_vector_get(_gsl_stddev_background_vector, i);
 
-    //if (_verboseDebug)
-    //displayVector(v, "getGeomean input vector v:", true);
+	// discarded components are not needed
+	for (int j=0; j<r; ++j)
+	  _projection[i*r + j] = gsl_matrix_get(_gsl_score_matrix, i, j);
+    }
 
-    gsl_vector * tmp_v = gsl_vector_alloc(_retained_components_count);
-    gsl_vector * tmp_gsl_factor_weights = gsl_vector_alloc(_retained_components_count);
+    for (int j=0; j<r; ++j)
+      _weights[j] = gsl_vector_get(_gsl_factor_weights, j);
 
-    for (int i=0; i<_retained_components_count; ++i)
-      {
-	gsl_vector_set(tmp_v, i,gsl_vector_get(v,i));
-	gsl_vector_set(tmp_gsl_factor_weights, i, gsl_vector_get(_gsl_factor_weights,i));
-      }
-    
-    gsl_vector * tmp_distance_vector = gsl_vector_alloc(_retained_components_count);
-    //gsl_vector * tmp_distance_vector = gsl_vector_alloc(_layer_count);
+    for (int i=0; i<_localityCount; ++i)
+      for (int j=0; j<r; ++j)
+	_locality_factors[i*r + j] = gsl_matrix_get(_gsl_environment_factor_matrix, i, j);
+}
 
-    gsl_vector_view tmp_matrix_row_view;
+/*****************************************************************
+ * Center and standardise a point with the background mean and stddev
+*****************************************************************/
+void Enfa::_centerPoint(const Scalar * x, double * centered) const
+{
+    for (int i=0; i<_layer_count; ++i)
+      centered[i] = (static_cast<float>(x[i]) - _center[i]) / _scale[i];
+}
+
+/*****************************************************************
+ * Multiply centered points by the retained components of the score matrix
+*****************************************************************/
+void Enfa::_project(const double * centered, int n, double * factors) const
+{
+    gsl_matrix_const_view c = gsl_matrix_const_view_array(centered, n, _layer_count);
+    gsl_matrix_const_view p = gsl_matrix_const_view_array(&_projection[0], _layer_count, _retained_components_count);
+    gsl_matrix_view f = gsl_matrix_view_array(factors, n, _retained_components_count);
+
+    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans,
+		   1.0, &c.matrix, &p.matrix,
+		   0.0, &f.matrix);
+}
+
+/*****************************************************************
+ * Calculate the geometric mean of the distance from a factored point
+   to all species observation points in factored environmental space
+   weighting each factor accordingly 
+*****************************************************************/
+double Enfa::_geomean(const double * factors) const
+{
+    int r = _retained_components_count;
+    const double * locality = &_locality_factors[0];
     double tmp_geomean=1.0;
-    double tmp_dist_workspace;
 
     // loop through localities
-    for (int i=0; i<_localityCount; ++i)
+    for (int i=0; i<_localityCount; ++i, locality+=r)
     {
-	tmp_matrix_row_view = gsl_matrix_row(_gsl_environment_factor_matrix,i);
-	//displayVector(&tmp_matrix_row_view.vector, "getGeomean: locality vector i", true);
-	//for (int j=0; j<_layer_count; ++j)
-	// dont need to calculate beyonde the retained components
-	for (int j=0; j<_retained_components_count; ++j)
-		    gsl_vector_set(tmp_distance_vector, j,
-			   gsl_vector_get(&tmp_matrix_row_view.vector,j));
-	//displayVector(tmp_distance_vector, "getGeomean: locality vector i copy ", true);
-
-	// difference between cell and current locality
-	gsl_vector_sub(tmp_distance_vector,tmp_v);
-	//gsl_vector_sub(tmp_distance_vector,v);
-	//displayVector(tmp_distance_vector, "getGeomean: locality vector i subbed ", true);
-
-	// square the differences
-	gsl_vector_mul(tmp_distance_vector, tmp_distance_vector);
-	//displayVector(tmp_distance_vector, "getGeomean: locality vector i squared ", true);
-	// multiply by the factor weights
-	gsl_vector_mul(tmp_distance_vector,tmp_gsl_factor_weights);
-	//gsl_vector_mul(tmp_distance_vector,_gsl_factor_weights);
-	// square and sum the values to get the distance
-	//displayVector(tmp_distance_vector, "getGeomean: locality vector i weighted ", true);
-
-	tmp_dist_workspace=pow(gsl_blas_dasum(tmp_distance_vector),0.5);
-	//Log::instance()->info( "euclidean distance: %6.2f\n", tmp_dist_workspace );
+	// weighted squared differences between cell and current locality
+	// (discarded components have no weight), summed as absolute values
+	// like gsl_blas_dasum did
+	double tmp_dist_workspace=0.0;
+
+	for (int j=0; j<r; ++j)
+	{
+	    double diff = locality[j] - factors[j];
+	    tmp_dist_workspace += diff * diff * fabs(_weights[j]);
+	}
+
+	tmp_dist_workspace = sqrt(tmp_dist_workspace);
 
 	// accumulate for geometric mean calculation
-	// if (tmp_dist_workspace!=0) tmp_geomean*=tmp_dist_workspace;
         // log transform values to reduce chance of float overflow
         if (tmp_dist_workspace!=0) tmp_geomean+=log(tmp_dist_workspace);
-	//Log::instance()->info( "accumulating distance: %6.2f\n", tmp_geomean );
     }
 
-    //Log::instance()->info( "tmp_geomean1: %6.2f\n", tmp_geomean );    
-
     // finally work out geometric mean of distances to the species points
-    // tmp_geomean=pow(tmp_geomean,(double)1/_localityCount);
-    // reverse the log transformation 
-    tmp_geomean=exp(tmp_geomean/_localityCount);
+    // reversing the log transformation 
+    return exp(tmp_geomean/_localityCount);
+}
 
-    //if (_verboseDebug)
-    //  Log::instance()->info( "getgeomean returns: %6.2f\n", tmp_geomean );    
+/*****************************************************************
+ * Proportion of localities whose geometric mean is greater than the
+   specified one
+*****************************************************************/
+Scalar Enfa::_suitability(double geomean) const
+{
+    // the geomeans are sorted, so the first one that is greater
+    // than the current geomean can be found with a binary search
+    std::vector<double>::const_iterator it = std::upper_bound(_geomeans.begin(), _geomeans.end(), geomean);
 
-    gsl_vector_free(tmp_distance_vector);
-    gsl_vector_free(tmp_v);
-    gsl_vector_free(tmp_gsl_factor_weights);
+    int cellcount = (int)(_geomeans.end() - it);
 
-    return tmp_geomean;
+    return (Scalar)cellcount/_localityCount;
 }
 
 /* calculate the inverse using cholesky decomposition */
@@ -1516,9 +1503,8 @@ bool Enfa::enfa1()
 		 1.0, _gsl_environment_matrix, _gsl_score_matrix, 
 		 0.0, _gsl_environment_factor_matrix);
 
-  gsl_vector_view _gsl_geomean_workspace;
-
-  double _tmp_geomean;
+  // copy the factored localities used to calculate geomeans
+  _compile();
 
   //Log::instance()->info( "Calculating geometric means\n" );
   //displayMatrix(_gsl_environment_factor_matrix, "_gsl_environment_factor_matrix", true);
@@ -1526,14 +1512,14 @@ bool Enfa::enfa1()
   // loop through the localities and calculate the geomean
   for (int i=0; i<_localityCount; ++i)
   {
-      _gsl_geomean_workspace=gsl_matrix_row(_gsl_environment_factor_matrix,i);
-      _tmp_geomean=getGeomean(&_gsl_geomean_workspace.vector);
-      gsl_vector_set(_gsl_geomean_vector, i, _tmp_geomean);
+      gsl_vector_set(_gsl_geomean_vector, i, _geomean(&_locality_factors[i*_retained_components_count]));
   }
 
   // finally sort the geomeans to speed up processing later
   gsl_sort_vector(_gsl_geomean_vector);
 
+  _geomeans.assign(_gsl_geomean_vector->data, _gsl_geomean_vector->data + _localityCount);
+
   Log::instance()->info( "ENFA Model Generation Completed\n" );
 
   return true;
@@ -1778,6 +1764,10 @@ Enfa::_setConfiguration( const ConstConfigurationPtr& config )
   for (int i=0; i < _localityCount; ++i)
     gsl_vector_set( _gsl_geomean_vector, i, stl_vector[i] );
 
+  _geomeans = stl_vector;
+
+  _compile();
+
   _done = true;
 
 }
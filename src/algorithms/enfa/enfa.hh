@@ -39,6 +39,8 @@
 #include <openmodeller/Exceptions.hh>
 #include <gsl/gsl_matrix.h>
 
+#include <vector>
+
 /**
 
 Herewith follows a detailed explanation of the Enivironmental Niche Factor Analysis (ENFA). 
@@ -257,6 +259,12 @@ public:
      * (currently double). The vector should contain values looked up on 
      * the environmental variable layers into which the mode is being projected. */
     Scalar getValue( const Sample& x ) const;
+    int supportsThreadedProjection() const { return 1; }
+
+    /** Batch version of getValue. Points are factored in blocks with a
+     * single matrix product and no memory is allocated per point.
+     * @note This method is inherited from the Algorithm class */
+    void getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const;
     
     /** Returns a value that represents the convergence of the algorithm
      * expressed as a number between 0 and 1 where 0 represents model
@@ -310,10 +318,26 @@ protected:
 	input must be positive definite symmetric matrix */
     gsl_matrix* inverse(gsl_matrix* _m) const;
 
-    /** Calculate the geometric mean of the distance from point v to 
-	all species observation points in factored environmental space
+    /** Copy the parts of the model needed for projection into plain
+	row-major arrays (see _center, _projection, _locality_factors).
+	The sorted geomeans (_geomeans) are copied once they are known. **/
+    void _compile();
+
+    /** Center and standardise a point with the background mean and stddev. **/
+    void _centerPoint(const Scalar * x, double * centered) const;
+
+    /** Multiply n centered points (row-major) by the retained columns
+	of the score matrix, storing the factored points in factors. **/
+    void _project(const double * centered, int n, double * factors) const;
+
+    /** Calculate the geometric mean of the distance from a factored point
+	to all species observation points in factored environmental space
 	weighting each factor accordingly **/
-    double getGeomean(gsl_vector* v) const;
+    double _geomean(const double * factors) const;
+
+    /** Proportion of localities whose geometric mean is greater than the
+	specified one (binary search on the sorted geometric means). **/
+    Scalar _suitability(double geomean) const;
 
     /** Discard unwanted components.
      * decide how many components to keep based on one of three methods
@@ -474,6 +498,24 @@ protected:
     /** number of times currently retrying failing model **/
     int _retryCount;
 
+    /** background mean of each layer (see _compile) **/
+    std::vector<double> _center;
+
+    /** background stddev of each layer **/
+    std::vector<double> _scale;
+
+    /** retained columns of the score matrix (layers x retained components) **/
+    std::vector<double> _projection;
+
+    /** weights of the retained components **/
+    std::vector<double> _weights;
+
+    /** factored localities (localities x retained components) **/
+    std::vector<double> _locality_factors;
+
+    /** sorted geometric means of the localities **/
+    std::vector<double> _geomeans;
+
 
 };
 
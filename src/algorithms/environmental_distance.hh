@@ -44,6 +44,7 @@ class EnvironmentalDistance : public AlgorithmImpl{
       int initialize();  // Called by oM to initialize the algorithm
       int done() const { return _done; } // Tell oM when the algorithm finished its work
       Scalar getValue(const Sample& x) const; // Returns the occurence probability
+      int supportsThreadedProjection() const { return 1; }
 
    private:
       // Common-use attributes
@@ -130,9 +130,9 @@ int BioclimHistogram::resamples() const
 
 // ============
 void BioclimHistogram::getBioclimRange(Scalar prediction, int layerIndex, 
-					Scalar& minCutLevel, Scalar& maxCutLevel) const
+					Scalar& minCutLevel, Scalar& maxCutLevel,
+					Random& rnd) const
 {
-  Random rnd;
   int sum, n, UL, LL;
 
   int predIndex = (prediction == 1.0);
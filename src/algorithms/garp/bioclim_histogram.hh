@@ -47,6 +47,8 @@
 // ===========================================================================
 //  Declaration and Implementation of class BioclimHistogram
 // ===========================================================================
+class Random;
+
 class BioclimHistogram
 {
 public:
@@ -58,7 +60,8 @@ public:
   void initialize(const OccurrencesPtr& occs);
 
   void getBioclimRange(Scalar prediction, int layerIndex, 
-		       Scalar& minCutLevel, Scalar& maxCutLevel) const;
+		       Scalar& minCutLevel, Scalar& maxCutLevel,
+		       Random& rnd) const;
 
 private:
   void reset();
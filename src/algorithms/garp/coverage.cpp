@@ -0,0 +1,159 @@
+/**
+ * Definition of GarpCoverage class used in GARP
+ *
+ * @file   coverage.cpp
+ * $Id$
+ *
+ * LICENSE INFORMATION
+ *
+ * Copyright(c), CRIA - Centro de Referencia em Informacao Ambiental
+ *
+ * http://www.cria.org.br
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details:
+ *
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * This is an implementation of the GARP algorithm first developed
+ * by David Stockwell
+ *
+ */
+
+
+#include <openmodeller/Sample.hh>
+#include <openmodeller/Occurrence.hh>
+#include <openmodeller/Occurrences.hh>
+
+#include "coverage.hh"
+
+// ==========================================================================
+static inline int popCount(GarpCoverage::Word word)
+{
+#ifdef __GNUC__
+  return __builtin_popcountl(word);
+#else
+  int count = 0;
+
+  while (word)
+    {
+      word &= word - 1;
+      ++count;
+    }
+
+  return count;
+#endif
+}
+
+// ==========================================================================
+GarpCoverage::GarpCoverage(const OccurrencesPtr& occs) :
+  _occs(occs),
+  _numPoints(occs->numOccurrences()),
+  _numLayers(0),
+  _numWords(0),
+  _numPresences(0),
+  _values(),
+  _presences(),
+  _lastWordMask(~(Word)0)
+{
+  if (_numPoints > 0)
+    _numLayers = (*occs->begin())->environment().size();
+
+  _numWords = (_numPoints + WordBits - 1) / WordBits;
+
+  if (_numPoints % WordBits)
+    _lastWordMask = ((Word)1 << (_numPoints % WordBits)) - 1;
+
+  _values.resize(_numLayers * _numPoints);
+  _presences.assign(_numWords, 0);
+
+  OccurrencesImpl::const_iterator it  = occs->begin();
+  OccurrencesImpl::const_iterator end = occs->end();
+
+  for (int i = 0; it != end; ++it, ++i)
+    {
+      const Sample& sample = (*it)->environment();
+
+      for (int j = 0; j < _numLayers; j++)
+        _values[j * _numPoints + i] = sample[j];
+
+      if ((*it)->abundance() > 0.0)
+        {
+          _presences[i / WordBits] |= (Word)1 << (i % WordBits);
+          ++_numPresences;
+        }
+    }
+}
+
+// ==========================================================================
+void GarpCoverage::fill(Word * mask) const
+{
+  for (int w = 0; w < _numWords; w++)
+    mask[w] = ~(Word)0;
+
+  if (_numWords > 0)
+    mask[_numWords - 1] &= _lastWordMask;
+}
+
+// ==========================================================================
+void GarpCoverage::intersectRange(int layer, Scalar min, Scalar max,
+                                  Word * mask) const
+{
+  const Scalar * values = getLayer(layer);
+
+  for (int w = 0; w < _numWords; w++)
+    {
+      // no need to look at points that were already excluded
+      if (!mask[w])
+        continue;
+
+      const Scalar * v = values + w * WordBits;
+      int size = (w == _numWords - 1) ? _numPoints - w * WordBits : WordBits;
+
+      // same test as membership(): NaN values are kept
+      Word bits = 0;
+      for (int b = 0; b < size; b++)
+        bits |= (Word)( !(v[b] < min || v[b] > max) ) << b;
+
+      mask[w] &= bits;
+    }
+}
+
+// ==========================================================================
+void GarpCoverage::complement(Word * mask) const
+{
+  for (int w = 0; w < _numWords; w++)
+    mask[w] = ~mask[w];
+
+  if (_numWords > 0)
+    mask[_numWords - 1] &= _lastWordMask;
+}
+
+// ==========================================================================
+int GarpCoverage::count(const Word * mask) const
+{
+  int count = 0;
+
+  for (int w = 0; w < _numWords; w++)
+    count += popCount(mask[w]);
+
+  return count;
+}
+
+// ==========================================================================
+int GarpCoverage::countPresences(const Word * mask) const
+{
+  int count = 0;
+
+  for (int w = 0; w < _numWords; w++)
+    count += popCount(mask[w] & _presences[w]);
+
+  return count;
+}
@@ -0,0 +1,116 @@
+/**
+ * Declaration of GarpCoverage class used in GARP
+ *
+ * @file   coverage.hh
+ * $Id$
+ *
+ * LICENSE INFORMATION
+ *
+ * Copyright(c), CRIA - Centro de Referencia em Informacao Ambiental
+ *
+ * http://www.cria.org.br
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details:
+ *
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * This is an implementation of the GARP algorithm first developed
+ * by David Stockwell
+ *
+ */
+
+
+#ifndef _GARP_COVERAGE_HH_
+#define _GARP_COVERAGE_HH_
+
+#include <openmodeller/om.hh>
+
+#include <vector>
+
+/****************************************************************/
+/******************** GarpCoverage class ************************/
+
+/**
+  * Training points used to evaluate Garp rules, stored column by
+  * column (one contiguous array of values per layer). The points a
+  * rule applies to are represented by a bit mask with one bit per
+  * point, so that rule statistics can be calculated by counting
+  * bits instead of visiting each point (see GarpRule::getCoverage).
+  * Points must not change after the object is created.
+  */
+class GarpCoverage
+{
+public:
+  /// Unit of storage of bit masks
+  typedef unsigned long Word;
+
+  /// Number of bits (points) in each word of a bit mask
+  static const int WordBits = 8 * sizeof(Word);
+
+  /// Copies values from the given occurrences
+  GarpCoverage(const OccurrencesPtr& occs);
+
+  /// Occurrences used to create the object
+  const OccurrencesPtr& getOccurrences() const { return _occs; }
+
+  int numPoints() const { return _numPoints; }
+  int numLayers() const { return _numLayers; }
+
+  /// Number of words of a bit mask
+  int numWords() const { return _numWords; }
+
+  /// Values of all points for one layer
+  const Scalar * getLayer(int layer) const
+  { return &_values[0] + layer * _numPoints; }
+
+  /// Number of presence points (abundance greater than zero)
+  int numPresences() const { return _numPresences; }
+
+  /// Set the bits of all points
+  void fill(Word * mask) const;
+
+  /// Clear the bits of points whose value for the layer is out of [min, max]
+  void intersectRange(int layer, Scalar min, Scalar max, Word * mask) const;
+
+  /// Invert the bits of all points
+  void complement(Word * mask) const;
+
+  /// Number of bits set
+  int count(const Word * mask) const;
+
+  /// Number of presence points with bits set
+  int countPresences(const Word * mask) const;
+
+private:
+  OccurrencesPtr _occs;
+
+  int _numPoints;
+  int _numLayers;
+  int _numWords;
+  int _numPresences;
+
+  /// Values of point i for layer j are stored at j * numPoints + i
+  std::vector<Scalar> _values;
+
+  /// Bit mask of presence points
+  std::vector<Word> _presences;
+
+  /// Mask of valid bits in the last word
+  Word _lastWordMask;
+
+  // Disable copying.
+  GarpCoverage(const GarpCoverage&);
+  GarpCoverage& operator=(const GarpCoverage&);
+};
+
+// ====================================================================
+
+#endif
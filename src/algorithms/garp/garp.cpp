@@ -43,6 +43,7 @@
 #include <openmodeller/Random.hh>
 #include <openmodeller/Exceptions.hh>
 #include <openmodeller/ScaleNormalizer.hh>
+#include <openmodeller/ThreadPool.hh>
 
 #include <string>
 using std::string;
@@ -250,6 +251,8 @@ Garp::Garp()
 
   // reset private attributes
   _fittest = _offspring = NULL;
+  _coverage = NULL;
+  _pool = NULL;
 
   _gen = 0;
   _convergence = 1.0;
@@ -281,6 +284,12 @@ Garp::~Garp()
   
   if (_fittest)
     delete _fittest;
+
+  if (_coverage)
+    delete _coverage;
+
+  if (_pool)
+    delete _pool;
 }
 
  
@@ -318,9 +327,21 @@ int Garp::initialize()
   _fittest   = new GarpRuleSet(2 * _popsize);
 
   cacheSamples(_samp, _cachedOccs, _resamples);
+  _coverage = new GarpCoverage(_cachedOccs);
   _bioclimHistogram.initialize(_cachedOccs);
   _regression.calculateParameters(_cachedOccs);
 
+  // run seed is taken from the global generator in the calling thread
+  _rnd = Random( (unsigned int) Random().get(1, 2147483647) );
+
+  int num_threads = getNumThreads();
+
+  if (num_threads < 1)
+    num_threads = ThreadPool::numProcessors();
+
+  if (num_threads > 1)
+    _pool = new ThreadPool(num_threads);
+
   colonize(_offspring, _popsize);
 
   return 1;
@@ -379,6 +400,11 @@ int Garp::iterate()
       // finalize processing of model
       // by filtering out rules that have low performance 
       _fittest->filter(defaultPerfIndex, _significance);
+
+      if (_pool)
+        delete _pool;
+      _pool = NULL;
+
       return 1;
     }
   
@@ -637,14 +663,65 @@ void Garp::keepFittest(GarpRuleSet * source, GarpRuleSet * target,
 /****************************************************************/
 /***************** evaluate *************************************/
 
+/** Evaluates a block of rules. Rules only change their own performance
+  * values, so different blocks can be evaluated by different threads. */
+class GarpEvaluateTask : public ThreadPoolTask
+{
+public:
+  GarpEvaluateTask(GarpRuleSet * ruleset, int begin, int end,
+                   const GarpCoverage * coverage) :
+    ThreadPoolTask(),
+    _ruleset(ruleset),
+    _begin(begin),
+    _end(end),
+    _coverage(coverage)
+  {}
+
+  void run(int)
+  {
+    for (int i = _begin; i < _end; i++)
+      _ruleset->get(i)->evaluate(*_coverage);
+  }
+
+private:
+  GarpRuleSet * _ruleset;
+  int _begin;
+  int _end;
+  const GarpCoverage * _coverage;
+};
+
 void Garp::evaluate(GarpRuleSet * ruleset)
 {
   int i, n;
   
   n = ruleset->numRules();
+
+  if (_pool && n > 1)
+    {
+      int numTasks = (_pool->numThreads() < n) ? _pool->numThreads() : n;
+
+      std::vector<GarpEvaluateTask *> tasks;
+
+      for (i = 0; i < numTasks; i++)
+        {
+          tasks.push_back(new GarpEvaluateTask(ruleset, 
+                                               (i * n) / numTasks, 
+                                               ((i + 1) * n) / numTasks, 
+                                               _coverage));
+          _pool->submit(tasks.back());
+        }
+
+      _pool->waitAll();
+
+      for (i = 0; i < numTasks; i++)
+        delete tasks[i];
+
+      return;
+    }
+
   for (i = 0; i < n; i++)
   { 
-    ruleset->get(i)->evaluate(_cachedOccs);
+    ruleset->get(i)->evaluate(*_coverage);
   }
 
   return;
@@ -657,34 +734,33 @@ void Garp::colonize(GarpRuleSet * ruleset, int numRules)
 {
   int i, p, dim;
   GarpRule * rule = 0;
-  Random rnd;
   
   dim = _samp->numIndependent();
 
   for (i = ruleset->numRules(); i < numRules; i++)
     {
       // pick the next rule to be generated
-      p = rnd(3);
+      p = _rnd(3);
 
       switch (p)
 	{
       case 0: 
         rule = new RangeRule(dim);
 	rule->setPrediction(1.0);
-        ((RangeRule *) rule)->initialize(_bioclimHistogram);
+        ((RangeRule *) rule)->initialize(_bioclimHistogram, _rnd);
         break;
 
       case 1: 
         rule = new NegatedRangeRule(dim); 
 	rule->setPrediction(0.0);
-        ((NegatedRangeRule *) rule)->initialize(_bioclimHistogram);
+        ((NegatedRangeRule *) rule)->initialize(_bioclimHistogram, _rnd);
         break;
 
       case 2: 
         rule = new LogitRule(dim); 
-	Scalar pred = (rnd.get(0.0, 1.0) > 0.5) ? 1.0 : 0.0;
+	Scalar pred = (_rnd.get(0.0, 1.0) > 0.5) ? 1.0 : 0.0;
 	rule->setPrediction(pred);
-        ((LogitRule *) rule)->initialize(_regression);
+        ((LogitRule *) rule)->initialize(_regression, _rnd);
         break;
 	}
 
@@ -699,7 +775,6 @@ void Garp::colonize(GarpRuleSet * ruleset, int numRules)
 void Garp::select(GarpRuleSet * source, GarpRuleSet * target, 
                      double gapsize)
 {
-  Random rnd;
   int * sample;
   int i, j, k, n, temp;
   double perfBest, perfWorst, perfAvg;
@@ -724,7 +799,7 @@ void Garp::select(GarpRuleSet * source, GarpRuleSet * target,
   for (i = 0; i < _popsize; i++)
     sample[i] = i % n;
 
-  ptr = rnd.get(1.0);
+  ptr = _rnd.get(1.0);
   sum = 0.0;
   for (i = 0; i < n; i++) {
     rulePerf = source->get(i)->getPerformance(defaultPerfIndex);
@@ -748,7 +823,7 @@ void Garp::select(GarpRuleSet * source, GarpRuleSet * target,
   // randomly shuffle pointers to new structures 
   for (i = 0; i < _popsize; i++)
     {
-      j = rnd.get (i , _popsize - 1);
+      j = _rnd.get (i , _popsize - 1);
       temp = sample[j];
       sample[j] = sample[i];
       sample[i] = temp;
@@ -784,7 +859,7 @@ void Garp::mutate(GarpRuleSet * ruleset)
   double temperature = 2.0 / (double) _gen;
   n = ruleset->numRules();
   for (i = 0; i < n; i++)
-    ruleset->get(i)->mutate(temperature);
+    ruleset->get(i)->mutate(temperature, _rnd);
 }
 
 /****************************************************************/
@@ -792,7 +867,6 @@ void Garp::mutate(GarpRuleSet * ruleset)
 
 void Garp::crossover(GarpRuleSet * ruleset)
 {
-  Random rnd;
   int nrules, genes, xcount, last, mom, dad, xpt1, xpt2;
 
   genes = _samp->numIndependent();
@@ -801,13 +875,13 @@ void Garp::crossover(GarpRuleSet * ruleset)
 
   for (xcount = 0; xcount < last; xcount += 2)
   {
-    mom = rnd.get(nrules);
-    dad = rnd.get(nrules);
+    mom = _rnd.get(nrules);
+    dad = _rnd.get(nrules);
     if (dad == mom)
       dad = (dad + 1) % nrules;
 
-    xpt1 = rnd.get(genes);
-    xpt2 = rnd.get(genes);
+    xpt1 = _rnd.get(genes);
+    xpt2 = _rnd.get(genes);
 
     ruleset->get(mom)->crossover(ruleset->get(dad), xpt1, xpt2);
   }
@@ -820,6 +894,14 @@ void Garp::deleteTempDataMembers()
   if (_offspring)
     delete _offspring;
   _offspring = NULL;
+
+  if (_pool)
+    delete _pool;
+  _pool = NULL;
+
+  if (_coverage)
+    delete _coverage;
+  _coverage = NULL;
 }
 
 /****************************************************************/
@@ -37,16 +37,18 @@
 
 #include <openmodeller/om.hh>
 #include <openmodeller/Sample.hh>
+#include <openmodeller/Random.hh>
 
 // required include because of enum PerfIndex and class GarpRule
 #include "rules_base.hh" 
 #include "bioclim_histogram.hh"
 #include "regression.hh"
+#include "coverage.hh"
 
 
 class GarpRuleSet;
 
-class Random;
+class ThreadPool;
 
 /****************************************************************/
 /************************* GARP Algorithm ***********************/
@@ -99,6 +101,8 @@ public:
     *        the mode is being projected. 
     */
   Scalar getValue( const Sample& x ) const;
+  int supportsThreadedProjection() const { return 1; }
+  int supportsConcurrentTraining() const { return 1; }
   
   /** Returns a value that represents the convergence of the algorithm
     * expressed as a number between 0 and 1 where 0 represents model
@@ -131,7 +135,8 @@ private:
   void colonize(GarpRuleSet * ruleset, int numRules);
 
 /** Evaluate rules from a rule set based on their performance to predict 
-  *  points provided by a sampler object.
+  *  points provided by a sampler object. Rules are evaluated in parallel
+  *  when more than one thread is available.
   * @param ruleset: rule set to be tested.
   */
   void evaluate(GarpRuleSet * ruleset);
@@ -219,6 +224,17 @@ private:
 
   OccurrencesPtr _cachedOccs;
 
+  /** Cached occurrences stored as bit masks for rule evaluation */
+  GarpCoverage * _coverage;
+
+  /** Random numbers used to create new rules. Each run has its own
+    * stream, seeded from the global generator during initialization,
+    * so that results do not depend on other runs or threads. */
+  Random _rnd;
+
+  /** Threads used to evaluate rules (NULL when running sequentially) */
+  ThreadPool * _pool;
+
   double _convergence;
   int _improvements;
 
@@ -37,17 +37,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <algorithm>
 #include <string>
 using std::string;
 
-#ifdef WIN32
-#include <windows.h>
-#define SLEEP(secs) Sleep(secs * 1000)
-#else
-#include <unistd.h>
-#define SLEEP(secs) sleep(secs);
-#endif
-
 
 /****************************************************************/
 void BestSubsets::printListOfRuns(string msg, AlgorithmRun ** runs, int numOfRuns)
@@ -76,15 +69,17 @@ void BestSubsets::printListOfRuns(string msg, AlgorithmRun ** runs, int numOfRun
   _softOmissionThreshold = false;
   _currentModelsUnderOmissionThreshold = 0;
 
+  _queue = NULL;
+  _samples = NULL;
+
   _finishedRun = NULL;
-  _activeRun = NULL;
   _bestRun = NULL;
 
   _nparam = 0;
   _alg_params = NULL;
 
+  _numSubmittedRuns = 0;
   _numFinishedRuns = 0;
-  _numActiveRuns = 0;
   _done = false;
 
   _maxProgress = 0.0;
@@ -96,6 +91,13 @@ BestSubsets::~BestSubsets()
 {
   int i;
 
+  // waits for the runs that are still executing
+  if (_queue)
+  { delete _queue; }
+
+  if (_samples)
+  { delete _samples; }
+
   if (_finishedRun)
   {
     for (i = 0; i < _numFinishedRuns; i++)
@@ -103,9 +105,6 @@ BestSubsets::~BestSubsets()
     delete[] _finishedRun;
   }
 
-  if (_activeRun)
-  { delete[] _activeRun; }
-
   // bestRun just point to objects referenced by _finishedRun object
   if (_bestRun)
   { delete[] _bestRun; }
@@ -159,13 +158,6 @@ int BestSubsets::initialize()
   {
     _maxThreads = 1;
   }
-  else if ( _maxThreads > 1 )
-  {
-    // When maxThreads is greater than 1, if the machine has only one processor om
-    // can crash. If the machine has more than one processor GDAL can output lots
-    // of IO errors (current GDAL version does not seem to be thread safe).
-    Log::instance()->warn("Multithreading is still experimental. When max threads is greater than 1, depending on software and hardware configuration this application may crash or you may see lots of raster IO warnings. In these cases, we recommend you to set this parameter to 1.\n");
-  }
 
   if (_trainProp <= 1.0)
   {
@@ -184,8 +176,20 @@ int BestSubsets::initialize()
     _modelsUnderOmission = _totalRuns;
   }
 
+  // Runs are executed by worker threads, which must not read the
+  // environmental layers, so the points used to calculate errors
+  // are sampled here and shared by all runs.
+  _samples = new SharedSamples(_samp, _commissionSampleSize);
+
+  if (!_samples->numBackground())
+  {
+    Log::instance()->error("No points available to calculate commission.\n");
+    return 0;
+  }
+
   _finishedRun = new AlgorithmRun*[_totalRuns];
-  _activeRun = new AlgorithmRun*[_maxThreads];
+
+  _queue = new RunQueue(_maxThreads);
 
   transferParametersToAlgorithm();
 
@@ -197,109 +201,87 @@ int BestSubsets::initialize()
 
 int BestSubsets::iterate()
 {
-  static int iterations = 0;
-  int active;
-  AlgorithmRun * algRun;
-
-  ++iterations;
-
   if (_done)
   { return 1; }
 
-  // check if it should start new runs
-  if ((_numFinishedRuns + _numActiveRuns < _totalRuns) && 
-      !earlyTerminationConditionMet())
-  {
-    // it needs to start more runs
-    // wait for a slot for a new thread
-    if ((active = numActiveThreads()) >= _maxThreads)
-    {
-      //Log::instance()->info("%5d] Waiting for a slot to run next thread (%d out of %d)\n", iterations, active, _maxThreads);
-      SLEEP(2); 
-    }
-
-    else
-    {
-      int runId = _numFinishedRuns + _numActiveRuns;
-
-      //Log::instance()->info("%5d] There is an empty slot to run next thread (%d out of %d) - %d\n", iterations, active, _maxThreads, runId);
+  // keep the queue full while more runs are needed
+  while (!_queue->full() && _numSubmittedRuns < _totalRuns &&
+         !earlyTerminationConditionMet())
+  { submitRun(); }
 
-      // start new Algorithm
-      SamplerPtr train, test;
-      splitSampler( _samp, &train, &test, _trainProp );
+  // wait for the next run to finish
+  AlgorithmRun * run = static_cast<AlgorithmRun *>( _queue->next() );
 
-      Log::instance()->debug( "Presences: orig=%d, train=%d, test=%d\n", _samp->numPresence(), train->numPresence(), test->numPresence() );
-      Log::instance()->debug( "Absences:  orig=%d, train=%d, test=%d\n", _samp->numAbsence(), train->numAbsence(), test->numAbsence() );
-
-      algRun = new AlgorithmRun();
-      algRun->initialize(runId,
-          _commissionSampleSize, train, test, 
-          _nparam, _alg_params, 
-          (BSAlgorithmFactory *) this);
-      _activeRun[_numActiveRuns++] = algRun;
-      algRun->run();
-    }
+  if (run)
+  {
+    finishRun(run);
   }
-
   else
   {
-    // no more runs are needed
-    // check if all active threads have finished
-    active = numActiveThreads();
-      if (active)
-      {
-        // there are still threads running
-        /*
-           Log::instance()->info("%5d] Waiting for %d active thread(s) to finish.\n", 
-           iterations, active);
-           */
-        SLEEP(2); 
-      }
-
-      else
-      {
-        // all running threads terminated
-        // calculate best subset and exit
-        //Log::instance()->info("%5d] Calculating best and terminating algorithm.\n", i);
-        calculateBestSubset();
-        _done = true;
-      }
+    // all runs terminated
+    // calculate best subset and exit
+    calculateBestSubset();
+    _done = true;
   }
 
   return 1;
 }
 
 /****************************************************************/
-int BestSubsets::numActiveThreads()
+void BestSubsets::submitRun()
 {
-  int i;
-  AlgorithmRun * run;
+  // start new Algorithm
+  // (everything that samples the environment is done here, in the 
+  // calling thread)
+  SamplerPtr train;
+  std::vector<int> test;
+  _samples->split( _trainProp, &train, &test );
+
+  Log::instance()->debug( "Presences: orig=%d, train=%d, test=%d\n", _samp->numPresence(), train->numPresence(), (int)test.size() );
+  Log::instance()->debug( "Absences:  orig=%d, train=%d\n", _samp->numAbsence(), train->numAbsence() );
+
+  AlgorithmRun * algRun = new AlgorithmRun();
+
+  // an algorithm that could not be initialized must not be queued
+  if (!algRun->initialize(_numSubmittedRuns++,
+                          _samples, train, test, 
+                          _nparam, _alg_params, 
+                          (BSAlgorithmFactory *) this))
+  {
+    delete algRun;
+    Log::instance()->error( "Algorithm could not be initialized.\n" );
+    throw AlgorithmException( "Algorithm could not be initialized.\n" );
+  }
+
+  _queue->submit(algRun);
+}
 
-  for (i = 0; i < _numActiveRuns; i++)
+/****************************************************************/
+void BestSubsets::finishRun( AlgorithmRun * run )
+{
+  if (run->cancelled() || run->failed())
   {
-    run = _activeRun[i];
+    delete run;
+    return;
+  }
 
-    if (!run->running())
-    {
-      //Log::instance()->info("Thread %d has just finished.\n", run->getId());
-
-      // run finished its work
-      // move it to finished runs
-      // and remove it from list of active runs
-      _finishedRun[_numFinishedRuns++] = run;
-      _activeRun[i] = _activeRun[--_numActiveRuns];
-      _activeRun[_numActiveRuns] = NULL;
-
-      // update count of models under omission threshold
-      if (!_softOmissionThreshold)
-      {
-        if (run->getOmission() <= _omissionThreshold)
-        { _currentModelsUnderOmissionThreshold++; }
-      }
-    }
+  _finishedRun[_numFinishedRuns++] = run;
+
+  // update count of models under omission threshold
+  if (!_softOmissionThreshold)
+  {
+    if (run->getOmission() <= _omissionThreshold)
+    { _currentModelsUnderOmissionThreshold++; }
   }
 
-  return _numActiveRuns;
+  // runs waiting in the queue are no longer needed
+  if (earlyTerminationConditionMet())
+  {
+    int cancelled = _queue->cancelPending();
+
+    if (cancelled)
+    { Log::instance()->debug("Cancelled %d queued runs.\n", cancelled); }
+  }
 }
 
 /****************************************************************/
@@ -316,6 +298,13 @@ int BestSubsets::calculateBestSubset()
 
   Log::instance()->info("Calculating best subset of models.\n");
 
+  // failed runs are discarded
+  if (_numFinishedRuns < _modelsUnderOmission)
+  {
+    Log::instance()->warn("Only %d runs finished. ModelsUnderOmission will be reduced to (%d)\n", _numFinishedRuns, _numFinishedRuns);
+    _modelsUnderOmission = _numFinishedRuns;
+  }
+
   // make a copy of finished runs to play with
   AlgorithmRun ** runList = new AlgorithmRun*[_numFinishedRuns];
   for (i = 0; i < _numFinishedRuns; i++)
@@ -326,12 +315,12 @@ int BestSubsets::calculateBestSubset()
   // get list of models that pass omission test
   // sort runs by omission
   // first <_modelsUnderOmission> runs are the selected ones
-  sortRuns(runList, _numFinishedRuns, 0);
+  sortRuns(runList, _numFinishedRuns, _modelsUnderOmission, 0);
 
   printListOfRuns("Finished Runs by Omission:", runList, _numFinishedRuns);
 
   // get list of models that pass commission test
-  sortRuns(runList, _modelsUnderOmission, 1);
+  sortRuns(runList, _modelsUnderOmission, _modelsUnderOmission, 1);
 
   printListOfRuns("Best Omission Runs by Commission:", runList, _numFinishedRuns);
 
@@ -351,37 +340,47 @@ int BestSubsets::calculateBestSubset()
 
   delete[] runList;
 
-  Log::instance()->info("Selected best %d models out of %d.\n", _numBestRuns, _totalRuns);
+  Log::instance()->info("Selected best %d models out of %d.\n", _numBestRuns, _numFinishedRuns);
 
   return 1;
 }
 
 /****************************************************************/
-void BestSubsets::sortRuns(AlgorithmRun ** runList, 
-    int nelements, int errorType)
+// Orders runs by one of the error components. Ties are broken by id,
+// so that the selected runs do not depend on the order in which they
+// finished.
+class RunErrorLess
 {
-  int i, j;
-  AlgorithmRun * runJ0, * runJ1;
+public:
+  RunErrorLess(int errorType) : _errorType(errorType) {}
 
-  Log::instance()->info("Sorting list %d of %d elements by index %d.\n", runList, nelements, errorType);
+  bool operator()(const AlgorithmRun * run0, const AlgorithmRun * run1) const
+  {
+    double error0 = run0->getError(_errorType);
+    double error1 = run1->getError(_errorType);
 
-  // bubble sort
-  // TODO: change to quicksort if this becomes a bottleneck
-  for (i = 0; i < nelements - 1; i++)
-  { 
-    for (j = 0; j < nelements - i - 1; j++)
-    {
-      runJ0 = runList[j];
-      runJ1 = runList[j + 1];
-
-      if (runJ0->getError(errorType) > runJ1->getError(errorType))
-      {
-        // exchange elements j and j + 1
-        runList[j] = runJ1;
-        runList[j + 1] = runJ0;
-      }
-    }
+    if (error0 != error1)
+    { return error0 < error1; }
+
+    return run0->getId() < run1->getId();
   }
+
+private:
+  int _errorType;
+};
+
+/****************************************************************/
+void BestSubsets::sortRuns(AlgorithmRun ** runList, 
+    int nelements, int nsorted, int errorType)
+{
+  Log::instance()->info("Sorting list %d of %d elements by index %d.\n", runList, nelements, errorType);
+
+  // only the first <nsorted> runs need to be in order
+  if (nsorted > nelements)
+  { nsorted = nelements; }
+
+  std::partial_sort(runList, runList + nsorted, runList + nelements,
+                    RunErrorLess(errorType));
 }
 
 /****************************************************************/
@@ -405,12 +404,8 @@ float BestSubsets::getProgress() const
     float progByTotalRuns = 0.0;
     float progByHardOmission = 0.0;
 
-    float avgProgressActiveRuns = 0.0;
-    for (int i = 0; i < _numActiveRuns; i++)
-    { avgProgressActiveRuns += _activeRun[i]->getProgress(); }
-    avgProgressActiveRuns /= _numActiveRuns;
-
-    progByTotalRuns = (_numFinishedRuns + avgProgressActiveRuns) / (float) _totalRuns;
+    if (_queue)
+    { progByTotalRuns = _queue->getProgress() / (float) _totalRuns; }
 
     if (!_softOmissionThreshold)
     {
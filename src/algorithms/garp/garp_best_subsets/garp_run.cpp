@@ -30,60 +30,32 @@
 #include <openmodeller/om.hh>
 
 #include "garp_run.hh"
-#include "garp_run_thread.hh"
 #include "bs_algorithm_factory.hh"
 #include <openmodeller/AlgParameter.hh>
 
-/****************************************************************/
-/************************ GARP Run Thread ***********************/
-
-// TODO: modify strategy to reuse threads instead of creating a 
-//       new one for every garp run
-
-THREAD_PROC_RETURN_TYPE AlgorithmRunThreadProc(void * threadData)
-{
-  AlgorithmRun * algRun = (AlgorithmRun *) threadData;
-
-  //Log::instance()->debug("Starting new thread (%d).\n", algRun->getId());
-
-  while (!algRun->done())
-    algRun->iterate();
-
-  algRun->calculateCommission();
-  algRun->calculateOmission();
-  algRun->finalize();
-  
-  //Log::instance()->debug("Finishing thread (%d).\n", algRun->getId());
-
-  THREAD_PROC_RETURN_STATEMENT;
-}
-
-
 /****************************************************************/
 /************************* GARP Run *****************************/
 
 AlgorithmRun::AlgorithmRun() :
   _id(-1),
-  _running( false ),
   _omission( -1.0 ),
   _commission( -1.0 ),
-  _commission_samples( 0 ),
+  _samples( NULL ),
+  _test(),
   _alg( NULL ),
-  _train_sampler(),
-  _test_sampler()
+  _train_sampler()
 {
   //Log::instance()->info("Creating an AlgorithmRun at: %x\n",this);
 }
 
 AlgorithmRun::AlgorithmRun( const AlgorithmPtr& alg ) :
   _id(-1),
-  _running( false ),
   _omission( -1.0 ),
   _commission( -1.0 ),
-  _commission_samples( 0 ),
+  _samples( NULL ),
+  _test(),
   _alg( alg ),
-  _train_sampler(),
-  _test_sampler()
+  _train_sampler()
 {
   //Log::instance()->info("Creating an AlgorithmRun at: %x\n",this);
 }
@@ -95,40 +67,39 @@ AlgorithmRun::~AlgorithmRun()
 }
 
 /****************************************************************/
-int AlgorithmRun::initialize(int id, int comm_samples,
+int AlgorithmRun::initialize(int id, const SharedSamples * samples,
 			     const SamplerPtr& train_sampler, 
-			     const SamplerPtr& test_sampler, 
+			     const std::vector<int>& test, 
 			     int nparam, AlgParameter * param,
 			     BSAlgorithmFactory * factory)
 {
   Log::instance()->debug( "Initializing garp run (%d)\n", id );
 
   _id = id;
-  _commission_samples = comm_samples;
+  _samples = samples;
+  _test = test;
 
   _train_sampler = train_sampler;
-  _test_sampler = test_sampler;
 
   _alg = factory->getBSAlgorithm();
   _alg->setSampler(train_sampler);
   _alg->setParameters(nparam, param);
-  _alg->initialize();
 
-  return 1;
+  return _alg->initialize();
 }
 
 /****************************************************************/
-int AlgorithmRun::run()
+void AlgorithmRun::execute()
 {
   //Log::instance()->debug("Starting new garp run (%d).\n", _id);
-  _running = true;
-  THREAD_START(AlgorithmRunThreadProc, this); 
-  return 1;  
-}
 
-/****************************************************************/
-bool AlgorithmRun::running() const
-{ return _running; }
+  while (!done())
+    iterate();
+
+  calculateCommission();
+  calculateOmission();
+  finalize();
+}
 
 /****************************************************************/
 int AlgorithmRun::iterate()
@@ -149,45 +120,18 @@ float AlgorithmRun::getProgress() const
 int AlgorithmRun::finalize()           
 {
   //Log::instance()->debug("Finishing up garp run.(%d)\n", _id);
-  _running = false;
   //_alg->deleteTempDataMembers(); // this is not in Algorithm interface
-  THREAD_END();
   return 1;
 }
 
 /****************************************************************/
 int AlgorithmRun::calculateCommission()           
 {
-  int i;
-  double sum = 0.0;
-
-  // TODO: check how to use absences in computing commission
-
   //Log::instance()->debug("Calculating commission error (%d).\n", _id);
 
-  // get random points from the background to estimate 
-  // area predicted present
-  bool hasAbsences = (_train_sampler->numAbsence() != 0);
-  for (i = 0; i < _commission_samples; i++) {
-
-    Scalar value;
-    if (hasAbsences) {
-
-      ConstOccurrencePtr occ = _train_sampler->getAbsence();
-      value = _alg->getValue(occ->environment()); 
-    }
-    else {
-
-      OccurrencePtr occ = _train_sampler->getPseudoAbsence();
-      value = _alg->getValue(occ->environment()); 
-    }
-
-    // discard novalue (-1); zero is irrelevant to the sum
-    if (value > 0)
-      sum += value;
-  }
-
-  _commission = sum / (double) _commission_samples;
+  // use the background points (sampled before the run started)
+  // to estimate area predicted present
+  _commission = _samples->getCommission( *_alg );
 
   return 1;
 }
@@ -199,26 +143,8 @@ int AlgorithmRun::calculateOmission()
 
   //Log::instance()->debug("Calculating omission error (%d).\n", _id);
 
-  // test which kind of test (intrinsic or extrinsic) should be performed
-  SamplerPtr sampler;
-
-  if (!_test_sampler)
-    { sampler = _train_sampler; }
-  else
-    { sampler = _test_sampler; }
-
-  int nomitted = 0;
-  OccurrencesPtr presences = sampler->getPresences();
-  OccurrencesImpl::const_iterator it  = presences->begin();
-  OccurrencesImpl::const_iterator end = presences->end();
-
-  while (it != end)
-    {
-      nomitted = !_alg->getValue((*it)->environment()); 
-      ++it;
-    }
-
-  _omission = (double) nomitted / (double) presences->numOccurrences();
+  // extrinsic test, or intrinsic when there are no test points
+  _omission = _samples->getOmission( *_alg, _test );
 
   return 1;
 }
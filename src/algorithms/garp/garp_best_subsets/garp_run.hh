@@ -33,6 +33,11 @@
 
 #include <openmodeller/om.hh>
 
+#include "RunQueue.hh"
+#include "SharedSamples.hh"
+
+#include <vector>
+
 class AlgorithmImpl;
 class AlgParameter;
 class BSAlgorithmFactory;
@@ -42,27 +47,27 @@ class BSAlgorithmFactory;
 
 /**
   * Wraps up a single Algorithm run and its results (calculated error
-  * components). Also handles multi-threading aspects of
-  * computation.
+  * components). Runs are executed by the worker threads of a
+  * RunQueue, so the algorithm is initialized (which samples the
+  * environment) before the run is submitted.
   */
-class AlgorithmRun
+class AlgorithmRun : public QueuedRun
 {
 public:
   AlgorithmRun();
   AlgorithmRun( const AlgorithmPtr& alg );
   virtual ~AlgorithmRun();
 
-  int initialize(int id, int comm_samples,
+  int initialize(int id, const SharedSamples * samples,
 		 const SamplerPtr& train_sampler, 
-		 const SamplerPtr& test_sampler, 
+		 const std::vector<int>& test, 
 		 int nparam, AlgParameter * param,
 		 BSAlgorithmFactory * factory);
-  int run();
+  void execute();
   int iterate();
   int finalize();
 
   int done() const;
-  bool running() const;
   int getId() const { return _id; }
   float getProgress() const;
   double getOmission() const;
@@ -77,13 +82,12 @@ public:
 private:
 
   int _id;                   /// Identified for this particular garp run
-  bool _running;             /// Indicates whether the thread is running
   double _omission;          /// Omission error for this run
   double _commission;        /// Commission error, approximated by area predicted present
-  int _commission_samples;   /// Number of points used to calculate commission
+  const SharedSamples * _samples; /// Points used to calculate errors
+  std::vector<int> _test;    /// Test presences (rows of the presence matrix)
   AlgorithmPtr _alg;      /// Algorithm used in this run
   SamplerPtr _train_sampler;
-  SamplerPtr _test_sampler;
 
   AlgorithmRun( const AlgorithmRun& );
   AlgorithmRun& operator=(const AlgorithmRun& );
@@ -247,10 +247,9 @@ void GarpRule::crossover(GarpRule * rule, int xpt1, int xpt2)
 }
 
 // ==========================================================================
-void GarpRule::mutate(double temperature)
+void GarpRule::mutate(double temperature, Random& rnd)
 {
   Scalar rnd1, rnd2;
-  Random rnd;
   int j;
   
   j = rnd.get(_numGenes);
@@ -294,15 +293,14 @@ bool GarpRule::similar(const GarpRule * otherRule) const
 }
 
 // ==========================================================================
-double GarpRule::evaluate(const OccurrencesPtr& occs)
+bool GarpRule::getCoverage(const GarpCoverage& coverage, GarpCoverage::Word * mask) const
 {
-  int i;
-
-  double utility[10];
-
-  //next line commented out since its not used
-  //int dimension = (*occs)[0]->environment().size();
+  return false;
+}
 
+// ==========================================================================
+double GarpRule::evaluate(const OccurrencesPtr& occs)
+{
   int n = occs->numOccurrences();
 
   // value of dependent variable from the current sample point
@@ -335,21 +333,12 @@ double GarpRule::evaluate(const OccurrencesPtr& occs)
   // other intermediate statistics
   double pYcXs, pYcs;
 
-  // prior probability
-  double priorProb;
-
   // note that pXSs is always equals to no, so it has been removed
 
   // reset counters
   pXs = pYs = pXYs = no = 0;
   pYcXs = pYcs = 0.0;
 
-  // reset utility values
-  for (i = 1; i < 10; i++) 
-    utility[i] = 0.0;
-  
-  utility[0] = 1.0;
-
   //FILE * flog = fopen("evaluate.log", "w");
 
   OccurrencesImpl::const_iterator it  = occs->begin();
@@ -359,7 +348,7 @@ double GarpRule::evaluate(const OccurrencesPtr& occs)
     {	
       // environmental (independent) variables values from current sample point
       Scalar pointValue = ( (*it)->abundance() > 0.0 ) ? 1.0 : 0.0;
-      Sample sample = (*it)->environment();
+      const Sample& sample = (*it)->environment();
 
       strength = getStrength(sample);
       certainty = getCertainty(pointValue);
@@ -394,7 +383,63 @@ double GarpRule::evaluate(const OccurrencesPtr& occs)
       Log::instance()->error("Assertion failed (no != pXs): %d != %d", no, pXs);
       throw AlgorithmException("Assertion failed");
     }
+
+  return setPerformance(n, pXs, pYs, pXYs, no, pYcs, pYcXs);
+}
+
+// ==========================================================================
+double GarpRule::evaluate(const GarpCoverage& coverage)
+{
+  int n = coverage.numPoints();
+
+  std::vector<GarpCoverage::Word> mask(coverage.numWords());
+
+  if (n == 0 || !getCoverage(coverage, &mask[0]))
+    return evaluate(coverage.getOccurrences());
+
+  // Point values are either 1 (presence) or 0 (absence), so the sums
+  // calculated by evaluate(occs) are the number of points of each
+  // kind multiplied by the certainty and error of that kind.
+  int numPresences = coverage.numPresences();
+  int numAbsences  = n - numPresences;
+
+  int certainty1 = getCertainty(1.0);
+  int certainty0 = getCertainty(0.0);
+
+  double error1 = getError(0, 1.0);
+  double error0 = getError(0, 0.0);
+
+  // number of points that rule applies to, by kind
+  int pXs  = coverage.count(&mask[0]);
+  int pXs1 = coverage.countPresences(&mask[0]);
+  int pXs0 = pXs - pXs1;
+
+  int pYs  = numPresences * certainty1 + numAbsences * certainty0;
+  int pXYs = pXs1 * certainty1 + pXs0 * certainty0;
+
+  double pYcs  = numPresences * error1 + numAbsences * error0;
+  double pYcXs = pXs1 * getError(error1, 1.0) + pXs0 * getError(error0, 0.0);
+
+  return setPerformance(n, pXs, pYs, pXYs, pXs, pYcs, pYcXs);
+}
+
+// ==========================================================================
+double GarpRule::setPerformance(int n, int pXs, int pYs, int pXYs, int no,
+                                double pYcs, double pYcXs)
+{
+  int i;
+
+  double utility[10];
+
+  // prior probability
+  double priorProb;
+
+  // reset utility values
+  for (i = 1; i < 10; i++) 
+    utility[i] = 0.0;
   
+  utility[0] = 1.0;
+
   // Priors
   utility[1] = pXs  / (double) n;		// proportion 
   utility[2] = pYs  / (double) n;		// Prior probability
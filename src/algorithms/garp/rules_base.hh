@@ -39,6 +39,10 @@
 #include <openmodeller/om.hh>
 #include <openmodeller/Sample.hh>
 
+#include "coverage.hh"
+
+class Random;
+
 enum PerfIndex
 {
   /** Utility: main performance value. Default is significance. */
@@ -162,20 +166,35 @@ public:
   double getPerformance(PerfIndex perfIndex) const;
 
   virtual int getStrength(const Sample& sample) const = 0;
+
+  /** Sets the bits of the training points the rule applies to (the
+    * points with strength 1), all at once.
+    * @return false if the rule does not support it, in which case
+    *  getStrength is called for each point.
+    */
+  virtual bool getCoverage(const GarpCoverage& coverage, GarpCoverage::Word * mask) const;
+
   virtual int getCertainty(const Scalar pred) const;
   virtual double getError(const Scalar predefinedValue, const Scalar prediction) const;
   
   virtual bool similar(const GarpRule * compareToRule) const;
-  virtual void mutate(double temperature);
+  virtual void mutate(double temperature, Random& rnd);
   virtual void crossover(GarpRule * rule, int xpt1, int xpt2);
 
   void adjustRange(Scalar& v1, Scalar& v2) const;
   virtual bool applies(const Sample& sample) const = 0;
   double evaluate(const OccurrencesPtr& occs);
+
+  /// Same as evaluate(occs), using the bit masks of the training points
+  double evaluate(const GarpCoverage& coverage);
   
   virtual void log();
 
 protected:
+  /// Stores the performance values calculated from the rule statistics
+  double setPerformance(int n, int pXs, int pYs, int pXYs, int no,
+                        double pYcs, double pYcXs);
+
   /// BYTE vector containing the genes (representation of the variables in a Genetic Algorithm
   Sample _chrom1;
   Sample _chrom2;
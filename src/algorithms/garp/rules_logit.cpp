@@ -66,10 +66,9 @@ LogitRule::LogitRule(Scalar prediction, int numGenes,
 LogitRule::~LogitRule() {}
 
 // ==========================================================================
-void LogitRule::initialize(const Regression& reg)
+void LogitRule::initialize(const Regression& reg, Random& rnd)
 {
   int i, j;
-  Random rnd;
   
   for (i = 0; i < _numGenes; i++)
     {
@@ -118,6 +117,43 @@ int LogitRule::getStrength(const Sample& sample) const
   return (prob >= 0.5);
 }
 
+// ==========================================================================
+bool LogitRule::getCoverage(const GarpCoverage& coverage, GarpCoverage::Word * mask) const
+{
+  int n = coverage.numPoints();
+
+  // accumulate the sums of all points one gene at a time, in the
+  // same order as getStrength does
+  std::vector<Scalar> sum(n, 0.0);
+
+  for (int j = 0; j < coverage.numLayers(); j++)
+    {
+      if (equalEps(_chrom1[j], -1.0))
+        continue;
+
+      Scalar c1 = _chrom1[j];
+      Scalar c2i2 = _chrom2[j]; c2i2 *= c2i2;
+
+      const Scalar * values = coverage.getLayer(j);
+
+      for (int i = 0; i < n; i++)
+        sum[i] += ( values[i] * c1 ) + ( values[i] * c2i2 );
+    }
+
+  for (int w = 0; w < coverage.numWords(); w++)
+    mask[w] = 0;
+
+  for (int i = 0; i < n; i++)
+    {
+      Scalar prob = 1.0 / (1.0 + (double) exp(-sum[i]));
+
+      if (prob >= 0.5)
+        mask[i / GarpCoverage::WordBits] |= (GarpCoverage::Word)1 << (i % GarpCoverage::WordBits);
+    }
+
+  return true;
+}
+
 // ==========================================================================
 bool LogitRule::similar(const GarpRule * rule) const
 {
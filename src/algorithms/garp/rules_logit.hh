@@ -62,9 +62,10 @@ public:
   
   virtual char type() const				{ return 'r'; }
   
-  virtual void initialize(const Regression& regression);
+  virtual void initialize(const Regression& regression, Random& rnd);
   virtual bool applies(const Sample& sample) const;
   virtual int getStrength(const Sample& sample) const;
+  virtual bool getCoverage(const GarpCoverage& coverage, GarpCoverage::Word * mask) const;
   
   virtual bool similar(const GarpRule * objOtherRule) const;
 
@@ -89,6 +89,15 @@ int NegatedRangeRule::getStrength(const Sample& sample) const
   return neg_strength;
 }
 
+// ==========================================================================
+bool NegatedRangeRule::getCoverage(const GarpCoverage& coverage, GarpCoverage::Word * mask) const
+{
+  RangeRule::getCoverage(coverage, mask);
+  coverage.complement(mask);
+
+  return true;
+}
+
 // ==========================================================================
 void NegatedRangeRule::log()
 {
@@ -70,6 +70,7 @@ public:
   
   virtual bool applies(const Sample& sample) const;
   virtual int getStrength(const Sample& sample) const;
+  virtual bool getCoverage(const GarpCoverage& coverage, GarpCoverage::Word * mask) const;
 
   void log();
 };
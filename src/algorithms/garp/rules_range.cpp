@@ -65,10 +65,9 @@ RangeRule::RangeRule(Scalar prediction, int numGenes,
 RangeRule::~RangeRule() { }
 
 // ==========================================================================
-void RangeRule::initialize(const BioclimHistogram& histogram)
+void RangeRule::initialize(const BioclimHistogram& histogram, Random& rnd)
 {
   int i, j;
-  Random rnd;
 
   // loop iterates through variables
   for(i = 0; i < _numGenes; i++)
@@ -76,7 +75,7 @@ void RangeRule::initialize(const BioclimHistogram& histogram)
       j = rnd.get(_numGenes);
       
       Scalar a = 0 , b = 0;
-      histogram.getBioclimRange(_prediction, j, a, b);
+      histogram.getBioclimRange(_prediction, j, a, b, rnd);
       _chrom1[j] = a;
       _chrom2[j] = b;
     }
@@ -113,6 +112,23 @@ int RangeRule::getStrength(const Sample& sample) const
   return 1;
 }
 
+// ==========================================================================
+bool RangeRule::getCoverage(const GarpCoverage& coverage, GarpCoverage::Word * mask) const
+{
+  coverage.fill(mask);
+
+  // intersection of the ranges of all genes that are not "don't care"
+  for (int i = 0; i < _numGenes; i++)
+    {
+      if (equalEps(_chrom1[i], -1.0) && equalEps(_chrom2[i], +1.0))
+        continue;
+
+      coverage.intersectRange(i, _chrom1[i], _chrom2[i], mask);
+    }
+
+  return true;
+}
+
 // ==========================================================================
 void RangeRule::log()
 {
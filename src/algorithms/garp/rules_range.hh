@@ -70,9 +70,10 @@ public:
   
   virtual char type() const				{ return 'd'; }
   
-  virtual void initialize(const BioclimHistogram& histogram);
+  virtual void initialize(const BioclimHistogram& histogram, Random& rnd);
   virtual bool applies(const Sample& sample) const;
   virtual int getStrength(const Sample& sample) const;
+  virtual bool getCoverage(const GarpCoverage& coverage, GarpCoverage::Word * mask) const;
 
   void log();
 };
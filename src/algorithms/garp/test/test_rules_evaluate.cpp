@@ -35,6 +35,7 @@
 #include <rules_range.hh>
 #include <rules_negrange.hh>
 #include <rules_logit.hh>
+#include <coverage.hh>
 #include <test_rules_defs.hh>
 #include <test_rules_evaluate_data.cpp>
 
@@ -91,18 +92,29 @@ bool checkEqualArray(Scalar * array1, Scalar * array2, int size, double veps)
   return result;
 }
 
+// fixture shared by the evaluation tests: a rule with the given genes
+// and prediction, and the points of one of the sample sets
+template <class T>
+T * createRule(int sampleIndex, Scalar * ruleGenes, Scalar rulePred,
+	       OccurrencesPtr& occs, int *dim)
+{
+  T * rule = new T();
+  occs = getSampleSet(sampleIndex, dim);
+  rule->setPrediction(rulePred);
+  rule->setGenes(ruleGenes, *dim);
+  return rule;
+}
+
 template <class T>
 bool testEvaluate(int sampleIndex, Scalar * ruleGenes,
 		  Scalar rulePred, Scalar * rulePerfs)
 {
-  int i, dim;
+  int dim;
   double * perf;
   bool result;
 
-  T * rule = new T();
-  OccurrencesPtr occs = getSampleSet(sampleIndex, &dim);
-  rule->setPrediction(rulePred);
-  rule->setGenes(ruleGenes, dim);
+  OccurrencesPtr occs;
+  T * rule = createRule<T>(sampleIndex, ruleGenes, rulePred, occs, &dim);
   rule->evaluate(occs);
   perf = rule->getPerformanceArray();
 
@@ -135,6 +147,62 @@ bool testEvaluate(int sampleIndex, Scalar * ruleGenes,
   return result;
 }
 
+template <class T>
+bool testEvaluateCoverage(int sampleIndex, Scalar * ruleGenes,
+			  Scalar rulePred, Scalar * rulePerfs)
+{
+  int dim;
+  double * perf;
+  bool result;
+
+  OccurrencesPtr occs;
+  T * rule = createRule<T>(sampleIndex, ruleGenes, rulePred, occs, &dim);
+  GarpCoverage coverage(occs);
+  rule->evaluate(coverage);
+  perf = rule->getPerformanceArray();
+
+  result = checkEqualArray(perf, rulePerfs, 10, eps);
+  delete rule;
+  return result;
+}
+
+// checks that the bit mask of a rule has the points it applies to, and
+// that both ways of evaluating the rule give the same performance
+template <class T>
+bool testCoverageMembership(int sampleIndex, Scalar * ruleGenes,
+			    Scalar rulePred)
+{
+  int dim;
+  bool result = true;
+
+  OccurrencesPtr occs;
+  T * rule = createRule<T>(sampleIndex, ruleGenes, rulePred, occs, &dim);
+  GarpCoverage coverage(occs);
+
+  std::vector<GarpCoverage::Word> mask(coverage.numWords());
+  result = rule->getCoverage(coverage, &mask[0]);
+
+  OccurrencesImpl::const_iterator it = occs->begin();
+  OccurrencesImpl::const_iterator end = occs->end();
+
+  for (int i = 0; it != end; ++it, ++i)
+    {
+      bool bit = (mask[i / GarpCoverage::WordBits] >> (i % GarpCoverage::WordBits)) & 1;
+      result = result && (bit == rule->applies((*it)->environment()));
+    }
+
+  Scalar perfs[10];
+  rule->evaluate(occs);
+  for (int i = 0; i < 10; i++)
+    { perfs[i] = rule->getPerformanceArray()[i]; }
+
+  rule->evaluate(coverage);
+  result = result && checkEqualArray(rule->getPerformanceArray(), perfs, 10, eps);
+
+  delete rule;
+  return result;
+}
+
 
 // SampleSet 1
 // ===========
@@ -197,6 +265,37 @@ TEST( evaluate4_6, NegatedRangeRule )
 
 
 
+// Coverage (bit mask) evaluation
+// ==============================
+TEST( evaluateCoverage1_1, RangeRule )
+{ CHECK(testEvaluateCoverage<ExtRangeRule>(1, RuleGenes1_1, RulePred1_1, RulePerfs1_1)); }
+
+TEST( evaluateCoverage1_3, NegatedRangeRule )
+{ CHECK(testEvaluateCoverage<ExtNegatedRangeRule>(1, RuleGenes1_3, RulePred1_3, RulePerfs1_3)); }
+
+TEST( evaluateCoverage2_3, RangeRule )
+{ CHECK(testEvaluateCoverage<ExtRangeRule>(2, RuleGenes2_3, RulePred2_3, RulePerfs2_3)); }
+
+TEST( evaluateCoverage4_2, RangeRule )
+{ CHECK(testEvaluateCoverage<ExtRangeRule>(4, RuleGenes4_2, RulePred4_2, RulePerfs4_2)); }
+
+TEST( evaluateCoverage4_5, NegatedRangeRule )
+{ CHECK(testEvaluateCoverage<ExtNegatedRangeRule>(4, RuleGenes4_5, RulePred4_5, RulePerfs4_5)); }
+
+TEST( coverageMembership4_1, LogitRule )
+{
+  Scalar genes[4] = {+0.34, -0.46, +0.38, -0.35};
+  CHECK(testCoverageMembership<ExtLogitRule>(4, genes, 1.0));
+}
+
+TEST( coverageMembership4_2, LogitRule )
+{
+  // first gene not used
+  Scalar genes[4] = {-1.00, +0.50, -0.70, +0.20};
+  CHECK(testCoverageMembership<ExtLogitRule>(4, genes, 0.0));
+}
+
+
 // Logit regression tests
 TEST( regression4_1, LogitRule )
 {
@@ -78,7 +78,7 @@ int GarpRule::getCertainty(Scalar pred) const { g_log("Ct"); };
 double GarpRule::getError(Scalar predefinedValue, Scalar pred) const { g_log("Er"); };
 void GarpRule::adjustRange(Scalar& v1, Scalar& v2) const { g_log("Ad"); };
 void GarpRule::crossover(GarpRule * rule, int xpt1, int xpt2) { g_log("Co"); };
-void GarpRule::mutate(double temperature) { g_log("Mu"); };
+void GarpRule::mutate(double temperature, Random& rnd) { g_log("Mu"); };
 bool GarpRule::similar(const GarpRule * objOtherRule) const { g_log("Si"); };
 double GarpRule::evaluate(const OccurrencesPtr& occs) { g_log("Ev"); };
 void GarpRule::log() {};
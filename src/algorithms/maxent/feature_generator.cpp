@@ -177,6 +177,20 @@ FeatureGenerator::lambda(int idx)
   return _features[idx]->lambda();
 }
 
+int
+FeatureGenerator::findThreshold( Scalar t ) const
+{
+  // Thresholds are sorted
+  std::vector<Scalar>::const_iterator it = std::lower_bound( _thresholds.begin(), _thresholds.end(), t - 1e-12*std::max(1.0, fabs(t)) );
+
+  if ( it == _thresholds.end() || fabs(*it - t) > 1e-12*std::max(1.0, fabs(t)) ) {
+
+    return -1;
+  }
+
+  return (int)(it - _thresholds.begin());
+}
+
 Scalar
 FeatureGenerator::getPrecision(Scalar val)
 {
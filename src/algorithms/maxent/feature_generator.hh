@@ -75,6 +75,15 @@ public:
 
   int getLastRef() const { return _last_ref; }
 
+  int numThresholds() const { return (int)_thresholds.size(); }
+
+  int getLayerIndex() const { return _feature->getLayerIndex(); }
+
+  bool isReverse() const { return _reverse; }
+
+  // Index of threshold t, or -1 if it is not one of the thresholds
+  int findThreshold( Scalar t ) const;
+
 protected:
 
   Scalar getVal(Sample s);
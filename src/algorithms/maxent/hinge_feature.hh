@@ -48,6 +48,10 @@ public:
   ConfigurationPtr getConfiguration() const;
   void setConfiguration( const ConstConfigurationPtr & config );
 
+  int getLayerIndex() const {return _layerIndex;}
+
+  bool isReverse() const {return _reverse;}
+
 private:
   int _layerIndex;
   bool _reverse;
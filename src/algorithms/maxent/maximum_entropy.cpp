@@ -43,12 +43,15 @@
 #include "threshold_generator.hh"
 #include "hinge_generator.hh"
 
+#include <openmodeller/ThreadPool.hh>
+
 #include <iostream>
 #include <iomanip>
 #include <sstream>
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <map>
 
 #include <limits>
 #include <math.h>
@@ -64,7 +67,7 @@ using std::pair;
 /****************************************************************/
 /********************** Algorithm's Metadata ********************/
 
-#define NUM_PARAM 14
+#define NUM_PARAM 16
 
 #define BACKGROUND_ID      "NumberOfBackgroundPoints"
 #define USE_ABSENCES_ID    "UseAbsencesAsBackground"
@@ -80,12 +83,21 @@ using std::pair;
 #define PT_THR_ID          "MinSamplesForProductThreshold"
 #define Q_THR_ID           "MinSamplesForQuadratic"
 #define HINGE_THR_ID       "MinSamplesForHinge"
+#define INITIAL_MODEL_ID   "InitialModel"
+#define SAVE_BACKGROUND_ID "SaveBackgroundPoints"
 
 #define MAXENT_LOG_PREFIX "Maxent: "
 
 #define MINLIMIT 1.0e-6
 #define MINDEV 1.0e-5
 
+// Number of background points of each chunk of a sweep. It does not
+// depend on the number of threads, so sums are always the same.
+#define MX_CHUNK_SIZE 4096
+
+// Number of features whose loss bounds are calculated by each task.
+#define MX_BOUND_BLOCK_SIZE 256u
+
 /******************************/
 /*** Algorithm's parameters ***/
 
@@ -277,6 +289,32 @@ static AlgParamMetadata parameters[NUM_PARAM] = {
     0,      // Parameter's upper limit.
     "15"    // Parameter's typical (default) value.
   },
+  // Initial model
+  {
+    INITIAL_MODEL_ID, // Id.
+    "Initial model",  // Name.
+    String,           // Type.
+    "Serialized model used to initialize training.", // Overview
+    "Name of a file with a serialized Maxent model (created with the " SAVE_BACKGROUND_ID " parameter) used to initialize training. Its background points and the lambdas of its features are reused, so that retraining after a few occurrences are added only needs the iterations required to converge again. When empty, training starts from scratch.", // Description.
+    0,      // Not zero if the parameter has lower limit.
+    0,      // Parameter's lower limit.
+    0,      // Not zero if the parameter has upper limit.
+    0,      // Parameter's upper limit.
+    ""      // Parameter's typical (default) value.
+  },
+  // Save background points
+  {
+    SAVE_BACKGROUND_ID,        // Id.
+    "Save background points",  // Name.
+    Integer,                   // Type.
+    "Save background points with the model.", // Overview
+    "Save the background points with the serialized model (1=yes, 0=no), so that it can be used as the initial model of another training. Models are much larger when background points are saved.", // Description.
+    1,      // Not zero if the parameter has lower limit.
+    0,      // Parameter's lower limit.
+    1,      // Not zero if the parameter has upper limit.
+    1,      // Parameter's upper limit.
+    "0"     // Parameter's typical (default) value.
+  },
 };
 
 /************************************/
@@ -286,7 +324,7 @@ static AlgMetadata metadata = {
   
   "MAXENT",          // Id.
   "Maximum Entropy", // Name.
-  "1.0",       	     // Version.
+  "1.1",       	     // Version.
 
   // Overview.
   "The principle of maximum entropy is a method for analyzing available qualitative information in order to determine a unique epistemic probability distribution. It states that the least biased distribution that encodes certain given information is that which maximizes the information entropy (content retrieved from Wikipedia on the 19th of May, 2008: http://en.wikipedia.org/wiki/Maximum_entropy).",
@@ -327,252 +365,823 @@ algorithmMetadata()
 }
 
 /****************************************************************/
-/************************ Maximum Entropy ***********************/
-
-/*******************/
-/*** constructor ***/
-
-MaximumEntropy::MaximumEntropy() :
-  AlgorithmImpl(&metadata),
-  _done(false),
-  _iteration(0),
-  _parallelUpdateFreq(30),
-  _change(10),
-  _updateInterval(20),
-  _select(5),
-  _autofeatures(false),
-  _pt_thr(80),
-  _q_thr(10),
-  _hinge_thr(15)
-{ }
-
-/******************/
-/*** destructor ***/
+/************************ Feature Columns ***********************/
 
-MaximumEntropy::~MaximumEntropy()
+/*
+ * Values of a feature (same as getVal) for rows [first, last) of a
+ * column-major matrix of environmental values with num_rows rows.
+ */
+static void
+featureValues( MxFeature *f, const Scalar *columns, int num_rows, int first, int last, double *values )
 {
-  unsigned int n = _features.size();
+  int n = last - first;
 
-  Log::instance()->debug("Deallocating %d features\n", n);
+  Scalar min = f->minimum();
+  Scalar scale = f->scale();
 
-  for (unsigned int i = 0; i < n; ++i) {
+  switch ( f->type() ) {
 
-   // Avoid deallocating post generated features - this happens in the feature generator
-   if ( _features[i]->postGenerated() ) {
+    case F_LINEAR: {
 
-     _features[i] = 0;
-   }
-   else {
+      const Scalar *x = columns + ((LinearFeature*)f)->getLayerIndex()*num_rows + first;
 
-     delete _features[i];
-   }
-  }
+      for ( int i = 0; i < n; ++i ) {
 
-  unsigned int m = _generators.size();
+        values[i] = ( x[i] - min ) / scale;
+      }
+      break;
+    }
+    case F_QUADRATIC: {
 
-  Log::instance()->debug("Deallocating %d generators\n", n);
+      const Scalar *x = columns + ((QuadraticFeature*)f)->getLayerIndex()*num_rows + first;
 
-  for (unsigned int j = 0; j < m; ++j)
-    delete _generators[j];
-}
+      for ( int i = 0; i < n; ++i ) {
 
-/**************************/
-/*** need Normalization ***/
-int MaximumEntropy::needNormalization()
-{
-  // Normalization is performed internally based on background points
-  return 0;
-}
+        values[i] = ( x[i]*x[i] - min ) / scale;
+      }
+      break;
+    }
+    case F_PRODUCT: {
 
-/******************/
-/*** initialize ***/
+      const Scalar *x1 = columns + ((ProductFeature*)f)->getLayerIndex1()*num_rows + first;
+      const Scalar *x2 = columns + ((ProductFeature*)f)->getLayerIndex2()*num_rows + first;
 
-int
-MaximumEntropy::initialize()
-{
-  // Check the number of presences.
-  _num_presences = _samp->numPresence();
+      for ( int i = 0; i < n; ++i ) {
 
-  if ( _num_presences == 0 ) {
+        values[i] = ( x1[i]*x2[i] - min ) / scale;
+      }
+      break;
+    }
+    case F_HINGE: {
 
-    Log::instance()->error( MAXENT_LOG_PREFIX "No presence points inside the mask!\n" );
-    return 0;
-  }
-  
-  // Load presence points.
-  _presences = _samp->getPresences();
-  
-  // Number of iterations
-  if ( ! getParameter( ITERATIONS_ID, &_max_iterations ) ) {
+      const Scalar *x = columns + ((HingeFeature*)f)->getLayerIndex()*num_rows + first;
 
-    Log::instance()->warn( MAXENT_LOG_PREFIX "Parameter '" ITERATIONS_ID "' not passed. Using default value (500)\n" );
-    _max_iterations = 500;
-  }
-  else {
+      double sign = ((HingeFeature*)f)->isReverse() ? -1.0 : 1.0;
 
-    if ( _max_iterations <= 0 ) {
-      
-      Log::instance()->error( MAXENT_LOG_PREFIX "Parameter '" ITERATIONS_ID "' must be greater then zero.\n" );
-      return 0;
-    }
-  }
-  
-  // Tolerance
-  if ( ! getParameter( TOLERANCE_ID, &_tolerance ) ) {
+      for ( int i = 0; i < n; ++i ) {
 
-    Log::instance()->warn( MAXENT_LOG_PREFIX "Parameter '" TOLERANCE_ID "' not passed. Using default value (1-E05)\n" );
-    _tolerance = 0.00001;
-  }
-  else {
-    if ( _tolerance <= 0.0 ) {
+        double val = sign * x[i];
 
-      Log::instance()->error( MAXENT_LOG_PREFIX "Parameter '" TOLERANCE_ID "' must be greater than zero\n" );
-      return 0;
+        values[i] = ( val > min ) ? ( val - min ) / scale : 0.0;
+      }
+      break;
     }
-  }
+    case F_THRESHOLD: {
 
-  // Quadratic features
-  _quadratic = true;
-  int quadratic;
-  if ( getParameter( QUADRATIC_ID, &quadratic ) && quadratic == 0 ) {
+      const Scalar *x = columns + ((ThresholdFeature*)f)->getLayerIndex()*num_rows + first;
 
-    _quadratic = false;
-  }
+      Scalar t = ((ThresholdFeature*)f)->threshold();
 
-  // Product features
-  _product = true;
-  int product;
-  if ( getParameter( PRODUCT_ID, &product ) && product == 0 ) {
+      for ( int i = 0; i < n; ++i ) {
 
-    _product = false;
+        values[i] = ( x[i] > t ) ? 1.0 : 0.0;
+      }
+      break;
+    }
   }
+}
 
-  // Hinge features
-  _hinge = true;
-  int hinge;
-  if ( getParameter( HINGE_ID, &hinge ) && hinge == 0 ) {
-
-    _hinge = false;
-  }
+/*
+ * Raw values of normalizable features (before setting min and max).
+ */
+static void
+featureRawValues( MxFeature *f, const Scalar *columns, int num_rows, double *values )
+{
+  int l1 = 0, l2 = -1;
 
-  // Threshold features
-  _threshold = true;
-  int threshold;
-  if ( getParameter( THRESHOLD_ID, &threshold ) && threshold == 0 ) {
+  if ( f->type() == F_LINEAR ) {
 
-    _threshold = false;
+    l1 = ((LinearFeature*)f)->getLayerIndex();
   }
+  else if ( f->type() == F_QUADRATIC ) {
 
-  // Auto features
-  _autofeatures = true;
-  int autofeatures;
-  if ( getParameter( AUTOFEATURES_ID, &autofeatures ) && autofeatures == 0 ) {
+    l1 = l2 = ((QuadraticFeature*)f)->getLayerIndex();
+  }
+  else if ( f->type() == F_PRODUCT ) {
 
-    _autofeatures = false;
+    l1 = ((ProductFeature*)f)->getLayerIndex1();
+    l2 = ((ProductFeature*)f)->getLayerIndex2();
   }
 
-  if ( _autofeatures ) {
+  const Scalar *x1 = columns + l1*num_rows;
 
-    // Product & threshold threshold
-    if ( ! getParameter( PT_THR_ID, &_pt_thr ) ) {
+  if ( l2 < 0 ) {
 
-      _pt_thr = 80;
+    for ( int i = 0; i < num_rows; ++i ) {
+
+      values[i] = x1[i];
     }
-    else {
+  }
+  else {
 
-      if ( _pt_thr < 1 ) {
-      
-        _pt_thr = 1;
-      }
-    }  
+    const Scalar *x2 = columns + l2*num_rows;
 
-    // Quadratic threshold
-    if ( ! getParameter( Q_THR_ID, &_q_thr ) ) {
+    for ( int i = 0; i < num_rows; ++i ) {
 
-      _q_thr = 10;
+      values[i] = x1[i]*x2[i];
     }
-    else {
+  }
+}
 
-      if ( _q_thr < 1 ) {
-      
-        _q_thr = 1;
-      }
-    }  
 
-    // Hinge threshold
-    if ( ! getParameter( HINGE_THR_ID, &_hinge_thr ) ) {
+/****************************************************************/
+/************************** Loss Bounds *************************/
 
-      _hinge_thr = 15;
-    }
-    else {
+/*
+ * Step of a feature's lambda given by the closed-form solution for
+ * binary features (see MaximumEntropy::getAlpha).
+ */
+static double
+mxAlpha( double w1, double n1, double beta1, double lambda )
+{
+  double alpha = 0.0;
+  double w0 = 1.0 - w1;
+  double n0 = 1.0 - n1;
 
-      if ( _hinge_thr < 1 ) {
-      
-        _hinge_thr = 1;
-      }
-    }  
-  }
+  if ( ( w0 >= MINLIMIT ) && ( w1 >= MINLIMIT ) ) {
 
-  bool use_absences_as_background = false;
-  int use_abs;
-  if ( getParameter( USE_ABSENCES_ID, &use_abs ) && use_abs == 1 ) {
+    if ( n1 - beta1 > MINLIMIT ) {
 
-    use_absences_as_background = true;
-  }
+      alpha = log( (n1 - beta1) * w0 / ((n0 + beta1) * w1) );
 
-  if ( use_absences_as_background ) {
+      if ( alpha + lambda <= 0.0 ) {
 
-    _num_background = _samp->numAbsence();
+	if ( n0 - beta1 > MINLIMIT ) {
 
-    int param_background;
+	  alpha = log( (n1 + beta1) * w0 / ( (n0 - beta1) * w1) );
 
-    if ( _num_background && getParameter( BACKGROUND_ID, &param_background ) && param_background > _num_background ) {
+          if ( alpha + lambda >= 0.0 ) {
 
-    Log::instance()->warn( MAXENT_LOG_PREFIX "Number of absence points (%d) is less than the specified number of background points (%d). Using the first.\n", _num_background, param_background);
+            alpha = -lambda;
+          }
+        }
+        else {
+
+          alpha = -lambda;
+        }
+      }
     }
-  }
-  else {
+    else {
 
-    if ( ! getParameter( BACKGROUND_ID, &_num_background ) ) {
+      if ( n0 - beta1 > MINLIMIT ) {
 
-      Log::instance()->warn( MAXENT_LOG_PREFIX "Parameter '" BACKGROUND_ID "' unspecified. Using default value (10000).\n");
+        alpha = log( (n1 + beta1) * w0 / ( (n0 - beta1) * w1) );
+	
+        if ( alpha + lambda >= 0.0 ) {
 
-      _num_background = 10000;
+          alpha = -lambda;
+        }
+      }
+      else {
+
+        alpha = -lambda;
+      }
     }
   }
 
-  if ( _num_background <= 0 ) {
-	
-    Log::instance()->warn( MAXENT_LOG_PREFIX "Number of background points must be greater than zero!\n" );
-    return 0;
-  }
+  return alpha;
+}
 
-  bool merge_points = true; // default
-  int merge_param;
-  if ( getParameter( MERGE_POINTS_ID, &merge_param ) && !merge_param ) {
+/*
+ * Bound on the loss change of a feature (see MaximumEntropy::lossBound).
+ */
+static double
+mxLossBound( bool active, double w1, double n1, double beta1, double lambda )
+{
+  if ( !active ) {
 
-    merge_points = false;
+     return 0.0;
   }
-    
-  _background = new OccurrencesImpl( _presences->label(), _presences->coordSystem() );
 
-  if ( use_absences_as_background ) {
+  // Calculate delta loss bound
+  double dlb = 0;
+  double w0 = 1.0 - w1;
+  // Determine alpha
+  double alpha = mxAlpha( w1, n1, beta1, lambda );
+  double infinity = std::numeric_limits<double>::infinity();
 
-    _background->appendFrom( _samp->getAbsences() );
-  }
-  else {
+  if ( n1 != -1.0 ) {
 
-    // Generate background points
+    if ( alpha < infinity ) {
 
-    Log::instance()->info( MAXENT_LOG_PREFIX "Generating random background points.\n" );
+      dlb = -n1 * alpha + log( w0 + w1 * exp(alpha) ) +	beta1 * ( fabs(lambda + alpha) - fabs(lambda) );
 
-    for ( int i = 0; i < _num_background; ++i ) {
+#ifdef MSVC
+      bool dlb_isnan = (_isnan(dlb) == 1) ? true : false;
+#else
+      bool dlb_isnan = std::isnan(dlb);
+#endif
+      if ( dlb_isnan ) {
+
+        dlb = 0.0;
+      }
+    }
+  }
+
+  return dlb;
+}
+
+/*
+ * Derivative of the loss with respect to a feature's lambda.
+ */
+static double
+mxDerivative( double w1, double n1, double beta1, double lambda )
+{
+  double deriv = w1 - n1;
+
+  if ( lambda < 0.0 ) {
+
+    return deriv - beta1;
+  }
+
+  if ( lambda > 0.0 ) {
+
+    return deriv + beta1;
+  }
+
+  if ( deriv + beta1 > 0.0 ) {
+
+    return deriv + beta1;
+  }
+
+  if ( deriv - beta1 < 0.0 ) {
+
+    return deriv - beta1;
+  }
+
+  return 0.0;
+}
+
+/*
+ * Loss bounds of a range of features or of the thresholds of a generator.
+ */
+class MxBoundTask : public ThreadPoolTask {
+
+public:
+
+  MxBoundTask( const vector<MxFeature*> *features, int first, int last, double *dlb ) :
+    ThreadPoolTask(), features( features ), generator( 0 ), first( first ), last( last ), dlb( dlb ) {}
+
+  MxBoundTask( FeatureGenerator *generator, double *dlb ) :
+    ThreadPoolTask(), features( 0 ), generator( generator ),
+    first( generator->getFirstRef() ), last( generator->getLastRef() ), dlb( dlb ) {}
+
+  void run( int )
+  {
+    if ( generator ) {
+
+      for ( int j = first; j < last; ++j ) {
+
+        dlb[j-first] = mxLossBound( true, generator->exp(j), generator->sampExp(j), generator->sampDev(j), generator->lambda(j) );
+      }
+    }
+    else {
+
+      for ( int j = first; j < last; ++j ) {
+
+        MxFeature *f = (*features)[j];
+
+        dlb[j-first] = mxLossBound( f->isActive(), f->exp(), f->sampExp(), f->sampDev(), f->lambda() );
+      }
+    }
+  }
+
+  const vector<MxFeature*> *features;
+  FeatureGenerator *generator;
+  int first;
+  int last;
+  double *dlb;
+};
+
+
+/****************************************************************/
+/**************************** Sweeps ****************************/
+
+/*
+ * Computation over a chunk of background points (see MaximumEntropy::sweep).
+ * Chunks write to disjoint positions of point arrays, and to their own
+ * partial sums.
+ */
+class MxSweep {
+
+public:
+
+  MxSweep( int num_sums ) : num_sums( num_sums ) {}
+
+  virtual ~MxSweep() {}
+
+  virtual void run( int first, int last, double *sums ) const = 0;
+
+  int num_sums;
+};
+
+class MxSweepTask : public ThreadPoolTask {
+
+public:
+
+  MxSweepTask( const MxSweep *sweep, int first, int last, double *sums ) :
+    ThreadPoolTask(), sweep( sweep ), first( first ), last( last ), sums( sums ) {}
+
+  void run( int ) { sweep->run( first, last, sums ); }
+
+  const MxSweep *sweep;
+  int first;
+  int last;
+  double *sums;
+};
+
+class MxGeneratorTask : public ThreadPoolTask {
+
+public:
+
+  MxGeneratorTask( FeatureGenerator *generator, double *density, double z_lambda ) :
+    ThreadPoolTask(), generator( generator ), density( density ), z_lambda( z_lambda ) {}
+
+  void run( int ) { generator->updateExp( density, z_lambda ); }
+
+  FeatureGenerator *generator;
+  double *density;
+  double z_lambda;
+};
+
+/*
+ * Density of each point, its sum, and the sum of density*value of some
+ * features (sums: z, then one per feature).
+ */
+class MxDensitySweep : public MxSweep {
+
+public:
+
+  MxDensitySweep( const vector<MxFeature*>& features, const Scalar *columns, int num_rows, const double *linear_pred, double linear_normalizer, double *density ) :
+    MxSweep( 1 + (int)features.size() ),
+    features( features ), columns( columns ), num_rows( num_rows ),
+    linear_pred( linear_pred ), linear_normalizer( linear_normalizer ), density( density ) {}
+
+  void run( int first, int last, double *sums ) const
+  {
+    for ( int i = first; i < last; ++i ) {
+
+      double d = exp( linear_pred[i] - linear_normalizer );
+
+      density[i] = d;
+
+      sums[0] += d;
+    }
+
+    vector<double> values( last - first );
+
+    for ( unsigned int j = 0; j < features.size(); ++j ) {
+
+      featureValues( features[j], columns, num_rows, first, last, &values[0] );
+
+      double sum = sums[1+j];
+
+      for ( int i = first; i < last; ++i ) {
+
+        sum += density[i] * values[i-first];
+      }
+
+      sums[1+j] = sum;
+    }
+  }
+
+  const vector<MxFeature*>& features;
+  const Scalar *columns;
+  int num_rows;
+  const double *linear_pred;
+  double linear_normalizer;
+  double *density;
+};
+
+/*
+ * Sum of density*g(value) of a single feature.
+ */
+class MxFeatureSweep : public MxSweep {
+
+public:
+
+  enum Kind { EXPECTATION, SECOND_MOMENT, EXP_CHANGE };
+
+  MxFeatureSweep( Kind kind, MxFeature *feature, const Scalar *columns, int num_rows, const double *density, double alpha = 0.0 ) :
+    MxSweep( 1 ),
+    kind( kind ), feature( feature ), columns( columns ), num_rows( num_rows ),
+    density( density ), alpha( alpha ) {}
+
+  void run( int first, int last, double *sums ) const
+  {
+    vector<double> values( last - first );
+
+    featureValues( feature, columns, num_rows, first, last, &values[0] );
+
+    double sum = sums[0];
+
+    for ( int i = first; i < last; ++i ) {
+
+      double v = values[i-first];
+
+      if ( kind == EXPECTATION ) {
+
+        sum += density[i] * v;
+      }
+      else if ( kind == SECOND_MOMENT ) {
+
+        sum += density[i] * pow( v, 2 );
+      }
+      else {
+
+        sum += density[i] * exp( alpha * v );
+      }
+    }
+
+    sums[0] = sum;
+  }
+
+  Kind kind;
+  MxFeature *feature;
+  const Scalar *columns;
+  int num_rows;
+  const double *density;
+  double alpha;
+};
+
+/*
+ * Newton step of parallel updates (sums: th, ty, then one per feature).
+ */
+class MxNewtonSweep : public MxSweep {
+
+public:
+
+  MxNewtonSweep( const vector<MxFeature*>& features, const double *alpha, const Scalar *columns, int num_rows, const double *density ) :
+    MxSweep( 2 + (int)features.size() ),
+    features( features ), alpha( alpha ), columns( columns ), num_rows( num_rows ),
+    density( density ) {}
+
+  void run( int first, int last, double *sums ) const
+  {
+    int n = last - first;
+
+    vector<double> values( n );
+    vector<double> ft( n, 0.0 );
+
+    for ( unsigned int j = 0; j < features.size(); ++j ) {
+
+      if ( alpha[j] == 0.0 ) {
+
+        continue;
+      }
+
+      featureValues( features[j], columns, num_rows, first, last, &values[0] );
+
+      double sum = sums[2+j];
+
+      for ( int i = 0; i < n; ++i ) {
+
+        ft[i] += alpha[j] * values[i];
+        sum += density[first+i] * values[i];
+      }
+
+      sums[2+j] = sum;
+    }
+
+    for ( int i = 0; i < n; ++i ) {
+
+      double d = density[first+i];
+
+      sums[0] += d * pow(ft[i], 2);
+      sums[1] += d * ft[i];
+    }
+  }
+
+  const vector<MxFeature*>& features;
+  const double *alpha;
+  const Scalar *columns;
+  int num_rows;
+  const double *density;
+};
+
+/*
+ * Add coef*value of some features to the linear predictor of each point.
+ */
+class MxLinearPredSweep : public MxSweep {
+
+public:
+
+  MxLinearPredSweep( const Scalar *columns, int num_rows, double *linear_pred ) :
+    MxSweep( 0 ), features(), coefs(), columns( columns ), num_rows( num_rows ),
+    linear_pred( linear_pred ) {}
+
+  void add( MxFeature *f, double coef ) { features.push_back( f ); coefs.push_back( coef ); }
+
+  void run( int first, int last, double * ) const
+  {
+    vector<double> values( last - first );
+
+    for ( unsigned int j = 0; j < features.size(); ++j ) {
+
+      featureValues( features[j], columns, num_rows, first, last, &values[0] );
+
+      for ( int i = first; i < last; ++i ) {
+
+        linear_pred[i] += coefs[j] * values[i-first];
+      }
+    }
+  }
+
+  vector<MxFeature*> features;
+  vector<double> coefs;
+  const Scalar *columns;
+  int num_rows;
+  double *linear_pred;
+};
+
+
+/****************************************************************/
+/************************ Maximum Entropy ***********************/
+
+/*******************/
+/*** constructor ***/
+
+MaximumEntropy::MaximumEntropy() :
+  AlgorithmImpl(&metadata),
+  _compiled(false),
+  _constant(0.0),
+  _exp_entropy(1.0),
+  _pool(0),
+  _num_layers(0),
+  _num_sampled_background(0),
+  _save_background(false),
+  _done(false),
+  _iteration(0),
+  _parallelUpdateFreq(30),
+  _change(10),
+  _updateInterval(20),
+  _select(5),
+  _autofeatures(false),
+  _pt_thr(80),
+  _q_thr(10),
+  _hinge_thr(15)
+{ }
+
+/******************/
+/*** destructor ***/
+
+MaximumEntropy::~MaximumEntropy()
+{
+  delete _pool;
+
+  unsigned int n = _features.size();
+
+  Log::instance()->debug("Deallocating %d features\n", n);
+
+  for (unsigned int i = 0; i < n; ++i) {
+
+   // Avoid deallocating post generated features - this happens in the feature generator
+   if ( _features[i]->postGenerated() ) {
+
+     _features[i] = 0;
+   }
+   else {
+
+     delete _features[i];
+   }
+  }
+
+  unsigned int m = _generators.size();
+
+  Log::instance()->debug("Deallocating %d generators\n", n);
+
+  for (unsigned int j = 0; j < m; ++j)
+    delete _generators[j];
+
+  for (unsigned int k = 0; k < _initial_features.size(); ++k)
+    delete _initial_features[k];
+}
+
+/**************************/
+/*** need Normalization ***/
+int MaximumEntropy::needNormalization()
+{
+  // Normalization is performed internally based on background points
+  return 0;
+}
+
+/******************/
+/*** initialize ***/
+
+int
+MaximumEntropy::initialize()
+{
+  // Check the number of presences.
+  _num_presences = _samp->numPresence();
+
+  if ( _num_presences == 0 ) {
+
+    Log::instance()->error( MAXENT_LOG_PREFIX "No presence points inside the mask!\n" );
+    return 0;
+  }
+  
+  // Load presence points.
+  _presences = _samp->getPresences();
+  
+  // Number of iterations
+  if ( ! getParameter( ITERATIONS_ID, &_max_iterations ) ) {
+
+    Log::instance()->warn( MAXENT_LOG_PREFIX "Parameter '" ITERATIONS_ID "' not passed. Using default value (500)\n" );
+    _max_iterations = 500;
+  }
+  else {
+
+    if ( _max_iterations <= 0 ) {
+      
+      Log::instance()->error( MAXENT_LOG_PREFIX "Parameter '" ITERATIONS_ID "' must be greater then zero.\n" );
+      return 0;
+    }
+  }
+  
+  // Tolerance
+  if ( ! getParameter( TOLERANCE_ID, &_tolerance ) ) {
+
+    Log::instance()->warn( MAXENT_LOG_PREFIX "Parameter '" TOLERANCE_ID "' not passed. Using default value (1-E05)\n" );
+    _tolerance = 0.00001;
+  }
+  else {
+    if ( _tolerance <= 0.0 ) {
+
+      Log::instance()->error( MAXENT_LOG_PREFIX "Parameter '" TOLERANCE_ID "' must be greater than zero\n" );
+      return 0;
+    }
+  }
+
+  // Quadratic features
+  _quadratic = true;
+  int quadratic;
+  if ( getParameter( QUADRATIC_ID, &quadratic ) && quadratic == 0 ) {
+
+    _quadratic = false;
+  }
+
+  // Product features
+  _product = true;
+  int product;
+  if ( getParameter( PRODUCT_ID, &product ) && product == 0 ) {
+
+    _product = false;
+  }
+
+  // Hinge features
+  _hinge = true;
+  int hinge;
+  if ( getParameter( HINGE_ID, &hinge ) && hinge == 0 ) {
+
+    _hinge = false;
+  }
+
+  // Threshold features
+  _threshold = true;
+  int threshold;
+  if ( getParameter( THRESHOLD_ID, &threshold ) && threshold == 0 ) {
+
+    _threshold = false;
+  }
+
+  // Auto features
+  _autofeatures = true;
+  int autofeatures;
+  if ( getParameter( AUTOFEATURES_ID, &autofeatures ) && autofeatures == 0 ) {
+
+    _autofeatures = false;
+  }
+
+  if ( _autofeatures ) {
+
+    // Product & threshold threshold
+    if ( ! getParameter( PT_THR_ID, &_pt_thr ) ) {
+
+      _pt_thr = 80;
+    }
+    else {
+
+      if ( _pt_thr < 1 ) {
+      
+        _pt_thr = 1;
+      }
+    }  
+
+    // Quadratic threshold
+    if ( ! getParameter( Q_THR_ID, &_q_thr ) ) {
+
+      _q_thr = 10;
+    }
+    else {
+
+      if ( _q_thr < 1 ) {
+      
+        _q_thr = 1;
+      }
+    }  
+
+    // Hinge threshold
+    if ( ! getParameter( HINGE_THR_ID, &_hinge_thr ) ) {
+
+      _hinge_thr = 15;
+    }
+    else {
+
+      if ( _hinge_thr < 1 ) {
+      
+        _hinge_thr = 1;
+      }
+    }  
+  }
+
+  // Initial model
+  std::string initial_model;
+  if ( getParameter( INITIAL_MODEL_ID, &initial_model ) && ! initial_model.empty() ) {
+
+    if ( ! loadInitialModel( initial_model ) ) {
+
+      return 0;
+    }
+  }
+
+  int save_background;
+  if ( getParameter( SAVE_BACKGROUND_ID, &save_background ) && save_background == 1 ) {
+
+    _save_background = true;
+  }
+
+  bool use_absences_as_background = false;
+  int use_abs;
+  if ( getParameter( USE_ABSENCES_ID, &use_abs ) && use_abs == 1 ) {
+
+    use_absences_as_background = true;
+  }
+
+  if ( _initial_background ) {
+
+    _num_background = _initial_background->numOccurrences();
+  }
+  else if ( use_absences_as_background ) {
+
+    _num_background = _samp->numAbsence();
+
+    int param_background;
+
+    if ( _num_background && getParameter( BACKGROUND_ID, &param_background ) && param_background > _num_background ) {
+
+    Log::instance()->warn( MAXENT_LOG_PREFIX "Number of absence points (%d) is less than the specified number of background points (%d). Using the first.\n", _num_background, param_background);
+    }
+  }
+  else {
+
+    if ( ! getParameter( BACKGROUND_ID, &_num_background ) ) {
+
+      Log::instance()->warn( MAXENT_LOG_PREFIX "Parameter '" BACKGROUND_ID "' unspecified. Using default value (10000).\n");
+
+      _num_background = 10000;
+    }
+  }
+
+  if ( _num_background <= 0 ) {
+	
+    Log::instance()->warn( MAXENT_LOG_PREFIX "Number of background points must be greater than zero!\n" );
+    return 0;
+  }
+
+  bool merge_points = true; // default
+  int merge_param;
+  if ( getParameter( MERGE_POINTS_ID, &merge_param ) && !merge_param ) {
+
+    merge_points = false;
+  }
+    
+  _background = new OccurrencesImpl( _presences->label(), _presences->coordSystem() );
+
+  if ( _initial_background ) {
+
+    // Reuse background points of the initial model
+    _background->appendFrom( _initial_background );
+    _initial_background = OccurrencesPtr();
+  }
+  else if ( use_absences_as_background ) {
+
+    _background->appendFrom( _samp->getAbsences() );
+  }
+  else {
+
+    // Generate background points
+
+    Log::instance()->info( MAXENT_LOG_PREFIX "Generating random background points.\n" );
+
+    for ( int i = 0; i < _num_background; ++i ) {
 
       OccurrencePtr oc = _samp->getPseudoAbsence();
       _background->insert( oc ); 
     }
   }
 
+  _num_sampled_background = _num_background;
+
   if ( merge_points ) {
 
     _num_background += _num_presences;
@@ -646,6 +1255,21 @@ MaximumEntropy::initTrainer()
   _convergence_test_frequency = 20;
   _previous_loss = std::numeric_limits<double>::infinity();
 
+  loadColumns();
+
+  // Sweeps over background points and loss bound scans can run in parallel
+  int num_threads = getNumThreads();
+
+  if ( num_threads < 1 ) {
+
+    num_threads = ThreadPool::numProcessors();
+  }
+
+  if ( num_threads > 1 ) {
+
+    _pool = new ThreadPool( num_threads );
+  }
+
   bool deactivated_threshold_generator = false;
   bool deactivated_hinge_generator = false;
 
@@ -764,95 +1388,54 @@ MaximumEntropy::initTrainer()
     Log::instance()->error( MAXENT_LOG_PREFIX "No features available. Select more feature types or deselect auto features.\n" );
   }
 
-  unsigned int n = active_features;
   Log::instance()->debug("Using %d features\n", active_features);
 
-  // Normalize features
-  OccurrencesImpl::const_iterator b_iterator = _background->begin();
-  OccurrencesImpl::const_iterator b_end = _background->end();
-  Sample ref(n);
-  Sample smin(n);
-  Sample smax(n);
-  Scalar raw_val;
-  i = 0;
-
-  while ( b_iterator != b_end ) {
-    
-    Sample sample = (*b_iterator)->originalEnvironment();
+  // Normalize features with the min and max raw values among background points
+  vector<double> raw_vals( _num_background );
 
-    // Get raw values for each feature and put them in ref
-    i = 0;
-    for ( it = _features.begin(); it != _features.end(); ++it ) {
-
-      if ( !(*it)->isActive() ) {
-
-        continue;
-      }
-
-      if ( (*it)->isNormalizable() ) {
-
-        raw_val = (*it)->getRawVal(sample);
-
-        ref[i] = raw_val;
-      }
-
-      ++i;
-    }
-
-    if ( b_iterator == _background->begin() ) {
-
-      // First iteration: use ref for smin and smax
-      smin = ref;
-      smax = ref;
-    }
-    else {
-
-      // Subsequent iterations: determine min and max 
-      smin &= ref;
-      smax |= ref;
-    }
-
-    ++b_iterator;
-  }
-
-  // Set final min and max values
-  i = 0;
   for ( it = _features.begin(); it != _features.end(); ++it ) {
 
-    if ( !(*it)->isActive() ) {
+    if ( !(*it)->isActive() || !(*it)->isNormalizable() ) {
 
       continue;
     }
 
-    if ( (*it)->isNormalizable() ) {
+    featureRawValues( *it, &_bg_columns[0], _num_background, &raw_vals[0] );
+
+    Scalar smin = raw_vals[0];
+    Scalar smax = raw_vals[0];
 
-      (*it)->setMinMax( smin[i], smax[i] );
+    for ( int j = 1; j < _num_background; ++j ) {
+
+      smin = min( smin, raw_vals[j] );
+      smax = max( smax, raw_vals[j] );
     }
 
-    ++i;
+    (*it)->setMinMax( smin, smax );
   }
 
+  applyInitialModel();
+
   setLinearPred();
 
   assignBetas();
 
   // calculate observed feature expectations - pi~[f] (empirical average of f)
-  OccurrencesImpl::const_iterator p_iterator = _presences->begin();
-  OccurrencesImpl::const_iterator p_end = _presences->end();
 
   // sum feature values to calculate mean and std
+  vector<double> vals( _num_presences );
   Scalar val;
-  while ( p_iterator != p_end ) {
 
-    Sample sample = (*p_iterator)->originalEnvironment();
+  for ( it = _features.begin(); it != _features.end(); ++it ) {
 
-    for ( it = _features.begin(); it != _features.end(); ++it ) {
+    featureValues( *it, &_pr_columns[0], _num_presences, 0, _num_presences, &vals[0] );
 
-      val = (*it)->getVal(sample);
+    for ( int j = 0; j < _num_presences; ++j ) {
+
+      val = vals[j];
       (*it)->setMean( (*it)->mean() + val );
       (*it)->setStd( (*it)->std() + pow(val, 2) );
     }
-    ++p_iterator;
   }
 
   // calculate mean, std and expected values for each feature
@@ -925,6 +1508,20 @@ MaximumEntropy::initTrainer()
   for ( git = _generators.begin(); git != _generators.end(); ++git ) {
 
     (*git)->setSampExp( MINDEV );
+
+    // Features exported by applyInitialModel get the same values they
+    // would get if they were exported now
+    for ( int t = 0; t < (*git)->numThresholds(); ++t ) {
+
+      MxFeature *f = (*git)->getFeature( t );
+
+      if ( f ) {
+
+        f->setSampExp( (*git)->sampExp( t ) );
+        f->setSampDev( (*git)->sampDev( t ) );
+        f->setBeta( (*git)->beta() );
+      }
+    }
   }
 
   _density = new double[_num_background];
@@ -965,6 +1562,11 @@ MaximumEntropy::endTrainer()
   delete[] _density;
   delete[] _linear_pred;
 
+  delete _pool;
+  _pool = 0;
+
+  compileFeatures();
+
   _done = true;
 }
 
@@ -976,39 +1578,45 @@ MaximumEntropy::sequentialProc()
 {
   double retvalue;
 
+  // Loss bounds are calculated in parallel, but the best feature is
+  // always picked in the same order to get the same results
+  vector<double> features_dlb;
+  vector< vector<double> > generators_dlb;
+
+  lossBounds( features_dlb, &generators_dlb );
+
   // Determine best feature
   MxFeature* best_f = 0;
   double best_dlb = 1.0;
   double alpha = 0.0;
 
-  vector<MxFeature*>::iterator it;
-  for ( it = _features.begin(); it != _features.end(); ++it ) {
+  for ( unsigned int i = 0; i < _features.size(); ++i ) {
 
-    double dlb = lossBound( (*it)->isActive(), (*it)->exp(), (*it)->sampExp(), (*it)->sampDev(), (*it)->lambda(), (*it)->getDescription(_samp->getEnvironment()) );
+    MxFeature *f = _features[i];
 
-    if (!(*it)->isActive() || (*it)->postGenerated() || dlb >= best_dlb) {
+    if (!f->isActive() || f->postGenerated() || features_dlb[i] >= best_dlb) {
       continue;
     }
 
-    best_f = *it;
-    best_dlb = dlb;
+    best_f = f;
+    best_dlb = features_dlb[i];
   }    
 
   int best_thr = -1;
   FeatureGenerator* best_gen = 0;
 
   // Also check generator features
-  vector<FeatureGenerator*>::iterator git;
+  for ( unsigned int g = 0; g < _generators.size(); ++g ) {
 
-  for ( git = _generators.begin(); git != _generators.end(); ++git ) {
+    FeatureGenerator *gen = _generators[g];
 
-    for ( int j = (*git)->getFirstRef(); j < (*git)->getLastRef(); j++ ) {
+    for ( int j = gen->getFirstRef(); j < gen->getLastRef(); j++ ) {
 
-      double dlb = lossBound( true, (*git)->exp(j), (*git)->sampExp(j), (*git)->sampDev(j), (*git)->lambda(j), "G" );
+      double dlb = generators_dlb[g][j-gen->getFirstRef()];
 
       if ( dlb < best_dlb ) {
 
-        best_gen = *git;
+        best_gen = gen;
         best_dlb = dlb;
         best_thr = j;
       }
@@ -1036,20 +1644,11 @@ MaximumEntropy::sequentialProc()
   // Update expectation if necessary
   if ( best_f->lastExpChange() != _iteration - 1 ) {
 
-    OccurrencesImpl::const_iterator p_iterator = _background->begin();
-    OccurrencesImpl::const_iterator p_end = _background->end();
-    int i = 0;
     double sum = 0.0;
 
-    while ( p_iterator != p_end ) {
-    
-      Sample sample = (*p_iterator)->originalEnvironment();
-
-      sum += _density[i] * best_f->getVal(sample);
+    MxFeatureSweep s( MxFeatureSweep::EXPECTATION, best_f, &_bg_columns[0], _num_background, _density );
 
-      ++i;
-      ++p_iterator;
-    }
+    sweep( s, &sum );
 
     best_f->setExp( sum / _z_lambda );
     best_f->setLastExpChange( _iteration );
@@ -1108,37 +1707,66 @@ MaximumEntropy::sequentialProc()
 double 
 MaximumEntropy::lossBound( bool active, double w1, double n1, double beta1, double lambda, std::string description )
 {
-  if ( !active ) {
+  UNUSED(description);
+
+  return mxLossBound( active, w1, n1, beta1, lambda );
+}
+
+/*******************/
+/*** loss Bounds ***/
+
+void
+MaximumEntropy::lossBounds( vector<double>& features_dlb, vector< vector<double> > *generators_dlb )
+{
+  features_dlb.resize( _features.size() );
+
+  vector<MxBoundTask*> tasks;
+
+  for ( unsigned int first = 0; first < _features.size(); first += MX_BOUND_BLOCK_SIZE ) {
+
+    unsigned int last = std::min( first + MX_BOUND_BLOCK_SIZE, (unsigned int)_features.size() );
+
+    tasks.push_back( new MxBoundTask( &_features, first, last, &features_dlb[first] ) );
+  }
+
+  if ( generators_dlb ) {
+
+    generators_dlb->resize( _generators.size() );
+
+    for ( unsigned int g = 0; g < _generators.size(); ++g ) {
 
-     return 0.0;
+      FeatureGenerator *gen = _generators[g];
+
+      (*generators_dlb)[g].resize( gen->getLastRef() - gen->getFirstRef() );
+
+      if ( gen->getLastRef() > gen->getFirstRef() ) {
+
+        tasks.push_back( new MxBoundTask( gen, &(*generators_dlb)[g][0] ) );
+      }
+    }
   }
 
-  // Calculate delta loss bound
-  double dlb = 0;
-  double w0 = 1.0 - w1;
-  // Determine alpha
-  double alpha = getAlpha( w1, n1, beta1, lambda, description );
-  double infinity = std::numeric_limits<double>::infinity();
+  if ( _pool && tasks.size() > 1 ) {
 
-  if ( n1 != -1.0 ) {
+    for ( unsigned int i = 0; i < tasks.size(); ++i ) {
 
-    if ( alpha < infinity ) {
+      _pool->submit( tasks[i] );
+    }
 
-      dlb = -n1 * alpha + log( w0 + w1 * exp(alpha) ) +	beta1 * ( fabs(lambda + alpha) - fabs(lambda) );
+    _pool->waitAll();
+  }
+  else {
 
-#ifdef MSVC
-      bool dlb_isnan = (_isnan(dlb) == 1) ? true : false;
-#else
-      bool dlb_isnan = std::isnan(dlb);
-#endif
-      if ( dlb_isnan ) {
+    for ( unsigned int i = 0; i < tasks.size(); ++i ) {
 
-        dlb = 0.0;
-      }
+      tasks[i]->run( 0 );
     }
   }
 
-  return dlb;
+  for ( unsigned int i = 0; i < tasks.size(); ++i ) {
+
+    delete tasks[i];
+  }
 }
 
 /*********************/
@@ -1173,39 +1801,18 @@ MaximumEntropy::parallelProc()
 
   // Newton step
 
-  double th = 0.0;
-  double ty = 0.0;
-  double ft;
-  double d;
-  double v;
-
-  OccurrencesImpl::const_iterator p_iterator = _background->begin();
-  OccurrencesImpl::const_iterator p_end = _background->end();
-  int i = 0;
-
-  while ( p_iterator != p_end ) {
-    
-    Sample sample = (*p_iterator)->originalEnvironment();
-
-    ft = 0.0;
-    d = _density[i];
-
-    for ( unsigned int j = 0; j < _features.size(); ++j ) {
+  vector<double> sums( 2 + _features.size() );
 
-      if ( alpha[j] != 0.0 ) {
+  MxNewtonSweep s( _features, alpha, &_bg_columns[0], _num_background, _density );
 
-        v = _features[j]->getVal(sample);
+  sweep( s, &sums[0] );
 
-        ft += alpha[j] * v;
-        sum[j] += d * v;
-      }
-    }
+  double th = sums[0];
+  double ty = sums[1];
 
-    th += d * pow(ft, 2);
-    ty += d * ft;
+  for ( unsigned int j = 0; j < _features.size(); ++j ) {
 
-    ++i;
-    ++p_iterator;
+    sum[j] = sums[2+j];
   }
 
   int cnt = 0;
@@ -1231,7 +1838,12 @@ MaximumEntropy::parallelProc()
 
     for ( unsigned int i = 0; i < _features.size(); ++i ) {
 
-      step += getDeriv( _features[i] ) * alpha[i];
+      if ( alpha[i] != 0.0 ) {
+
+        MxFeature *f = _features[i];
+
+        step += mxDerivative( f->exp(), f->sampExp(), f->sampDev(), f->lambda() ) * alpha[i];
+      }
     }
 
     step = -step / th;
@@ -1296,27 +1908,20 @@ MaximumEntropy::setLinearPred()
 
     _linear_pred[i] = 0.0;
   }
-  
-  OccurrencesImpl::const_iterator p_iterator = _background->begin();
-  OccurrencesImpl::const_iterator p_end = _background->end();
-  int i = 0;
 
-  while ( p_iterator != p_end ) {
-    
-    Sample sample = (*p_iterator)->originalEnvironment();
+  MxLinearPredSweep s( &_bg_columns[0], _num_background, _linear_pred );
 
-    vector<MxFeature*>::iterator it;
-    for ( it = _features.begin(); it != _features.end(); ++it ) {
+  vector<MxFeature*>::iterator it;
+  for ( it = _features.begin(); it != _features.end(); ++it ) {
 
-      if ( (*it)->lambda() != 0.0 ) {
+    if ( (*it)->lambda() != 0.0 ) {
 
-        _linear_pred[i] += (*it)->lambda() * (*it)->getVal(sample);
-      }
+      s.add( *it, (*it)->lambda() );
     }
-    ++i;
-    ++p_iterator;
   }
 
+  sweep( s, 0 );
+
   setLinearNormalizer();
 }
 
@@ -1381,7 +1986,20 @@ MaximumEntropy::assignBetas()
   vector<MxFeature*>::iterator it;
   for ( it = _features.begin(); it != _features.end(); ++it ) {
 
-    (*it)->setBeta( beta_common );
+    // Hinge and threshold features only show up here when they come
+    // from an initial model
+    if ( (*it)->type() == F_HINGE ) {
+
+      (*it)->setBeta( beta_hinge );
+    }
+    else if ( (*it)->type() == F_THRESHOLD ) {
+
+      (*it)->setBeta( beta_threshold );
+    }
+    else {
+
+      (*it)->setBeta( beta_common );
+    }
   }
 
   vector<FeatureGenerator*>::iterator itg;
@@ -1469,105 +2087,463 @@ MaximumEntropy::calcDensity()
 void
 MaximumEntropy::calcDensity( vector<MxFeature*> to_update )
 {
-  _z_lambda = 0.0;
-  double d;
-  double* f_sum = new double[to_update.size()];
+  // Sums: z lambda followed by one per feature
+  vector<double> sums( 1 + to_update.size() );
+
+  MxDensitySweep s( to_update, &_bg_columns[0], _num_background, _linear_pred, _linear_normalizer, _density );
+
+  sweep( s, &sums[0] );
+
+  _z_lambda = sums[0];
+
   for ( unsigned int j = 0; j < to_update.size(); ++j ) {
 
-    f_sum[j] = 0.0;
+    to_update[j]->setLastExpChange( _iteration );
+    to_update[j]->setExp( sums[1+j] / _z_lambda );
   }
-  
-  OccurrencesImpl::const_iterator p_iterator = _background->begin();
-  OccurrencesImpl::const_iterator p_end = _background->end();
-  int i = 0;
 
-  while ( p_iterator != p_end ) {
-    
-    d = exp( _linear_pred[i] - _linear_normalizer );
+  // Update feature expectations for all generators
+  updateGenerators();
+}
+
+/*************/
+/*** sweep ***/
+
+void
+MaximumEntropy::sweep( MxSweep& s, double *sums )
+{
+  int num_chunks = ( _num_background + MX_CHUNK_SIZE - 1 ) / MX_CHUNK_SIZE;
+
+  int num_sums = s.num_sums;
+
+  vector<double> partial( num_chunks * num_sums + 1, 0.0 );
+
+  if ( _pool && num_chunks > 1 ) {
 
-    _density[i] = d;
+    vector<MxSweepTask*> tasks;
 
-    _z_lambda += d;
+    for ( int c = 0; c < num_chunks; ++c ) {
 
-    Sample sample = (*p_iterator)->originalEnvironment();
+      int first = c * MX_CHUNK_SIZE;
+      int last = min( first + MX_CHUNK_SIZE, _num_background );
 
-    for ( unsigned int j = 0; j < to_update.size(); ++j ) {
+      tasks.push_back( new MxSweepTask( &s, first, last, &partial[c*num_sums] ) );
 
-      f_sum[j] += d * to_update[j]->getVal(sample);
+      _pool->submit( tasks.back() );
     }
 
-    ++i;
-    ++p_iterator;
+    _pool->waitAll();
+
+    for ( int c = 0; c < num_chunks; ++c ) {
+
+      delete tasks[c];
+    }
   }
+  else {
 
-  for ( unsigned int j = 0; j < to_update.size(); ++j ) {
+    for ( int c = 0; c < num_chunks; ++c ) {
 
-    to_update[j]->setLastExpChange( _iteration );
-    to_update[j]->setExp( f_sum[j] / _z_lambda );
+      int first = c * MX_CHUNK_SIZE;
+      int last = min( first + MX_CHUNK_SIZE, _num_background );
+
+      s.run( first, last, &partial[c*num_sums] );
+    }
   }
 
-  // Update feature expectations for all generators
-  vector<FeatureGenerator*>::iterator git;
-  for ( git = _generators.begin(); git != _generators.end(); ++git ) {
+  // Partial sums are added in chunk order
+  for ( int j = 0; j < num_sums; ++j ) {
 
-    (*git)->updateExp( _density, _z_lambda );
-  }    
+    double sum = partial[j];
 
-  delete[] f_sum;
+    for ( int c = 1; c < num_chunks; ++c ) {
+
+      sum += partial[c*num_sums + j];
+    }
+
+    sums[j] = sum;
+  }
 }
 
-/*****************/
-/*** get Alpha ***/
+/*************************/
+/*** update Generators ***/
 
-double
-MaximumEntropy::getAlpha( double w1, double n1, double beta1, double lambda, std::string description )
+void
+MaximumEntropy::updateGenerators()
 {
-  double alpha = 0.0;
-  double w0 = 1.0 - w1;
-  double n0 = 1.0 - n1;
+  if ( _pool && _generators.size() > 1 ) {
 
-  if ( ( w0 >= MINLIMIT ) && ( w1 >= MINLIMIT ) ) {
+    // Each generator only updates its own expectations
+    vector<MxGeneratorTask*> tasks;
 
-    if ( n1 - beta1 > MINLIMIT ) {
+    vector<FeatureGenerator*>::iterator git;
+    for ( git = _generators.begin(); git != _generators.end(); ++git ) {
+
+      tasks.push_back( new MxGeneratorTask( *git, _density, _z_lambda ) );
+
+      _pool->submit( tasks.back() );
+    }
+
+    _pool->waitAll();
+
+    for ( unsigned int i = 0; i < tasks.size(); ++i ) {
+
+      delete tasks[i];
+    }
+  }
+  else {
+
+    vector<FeatureGenerator*>::iterator git;
+    for ( git = _generators.begin(); git != _generators.end(); ++git ) {
+
+      (*git)->updateExp( _density, _z_lambda );
+    }
+  }
+}
+
+/********************/
+/*** load Columns ***/
+
+void
+MaximumEntropy::loadColumns()
+{
+  _num_layers = _samp->numIndependent();
+
+  _bg_columns.assign( _num_layers * _num_background, 0.0 );
+  _pr_columns.assign( _num_layers * _num_presences, 0.0 );
+
+  OccurrencesImpl::const_iterator it = _background->begin();
+  OccurrencesImpl::const_iterator end = _background->end();
+
+  for ( int i = 0; it != end && i < _num_background; ++it, ++i ) {
+
+    const Sample& sample = (*it)->originalEnvironment();
+
+    for ( int j = 0; j < _num_layers; ++j ) {
+
+      _bg_columns[j*_num_background + i] = sample[j];
+    }
+  }
+
+  it = _presences->begin();
+  end = _presences->end();
+
+  for ( int i = 0; it != end && i < _num_presences; ++it, ++i ) {
+
+    const Sample& sample = (*it)->originalEnvironment();
+
+    for ( int j = 0; j < _num_layers; ++j ) {
+
+      _pr_columns[j*_num_presences + i] = sample[j];
+    }
+  }
+}
+
+/**************************/
+/*** load Initial Model ***/
+
+bool
+MaximumEntropy::loadInitialModel( const std::string& file )
+{
+  ConstConfigurationPtr model_config;
+
+  try {
+
+    ConstConfigurationPtr config = Configuration::readXml( file.c_str() );
+
+    // Accept serialized models as well as algorithm sections
+    ConstConfigurationPtr alg_config = config;
+
+    if ( config->getName() != "Algorithm" ) {
+
+      alg_config = config->getSubsection( "Algorithm" );
+    }
+
+    model_config = alg_config->getSubsection( "Model" )->getSubsection( "MaximumEntropy" );
+  }
+  catch ( std::exception& e ) {
+
+    Log::instance()->error( MAXENT_LOG_PREFIX "Could not read initial model from %s: %s\n", file.c_str(), e.what() );
+    return false;
+  }
+
+  ConstConfigurationPtr bg_config = model_config->getSubsection( "Background", false );
+
+  if ( ! bg_config || ! bg_config->getSubsection( "Occurrences", false ) ) {
+
+    Log::instance()->error( MAXENT_LOG_PREFIX "Initial model %s has no background points. It must be created with the " SAVE_BACKGROUND_ID " parameter.\n", file.c_str() );
+    return false;
+  }
+
+  ConstConfigurationPtr features_config = model_config->getSubsection( "Features", false );
+
+  if ( ! features_config ) {
+
+    Log::instance()->error( MAXENT_LOG_PREFIX "Initial model %s has no features.\n", file.c_str() );
+    return false;
+  }
+
+  // Background points are sampled again, since the environment may differ
+  // from the one used to create the initial model
+  _initial_background = new OccurrencesImpl( 0.0 );
+  _initial_background->setConfiguration( bg_config->getSubsection( "Occurrences" ) );
+  _initial_background->setEnvironment( _samp->getEnvironment(), "Background" );
+
+  if ( _initial_background->isEmpty() ) {
+
+    Log::instance()->error( MAXENT_LOG_PREFIX "No background points of the initial model have environmental data.\n" );
+    return false;
+  }
+
+  Configuration::subsection_list features = features_config->getAllSubsections();
+
+  Configuration::subsection_list::iterator feature = features.begin();
+  Configuration::subsection_list::iterator last_feature = features.end();
+
+  int num_layers = _samp->numIndependent();
+
+  for ( ; feature != last_feature; ++feature ) {
+
+    if ( (*feature)->getName() != "Feature" ) {
+
+      continue;
+    }
+
+    int feature_type = (*feature)->getAttributeAsInt( "Type", 0 );
+
+    ConstConfigurationPtr feature_config = *feature;
+
+    MxFeature *f = 0;
+    int max_layer = 0;
+
+    if ( feature_type == F_LINEAR ) {
+
+      LinearFeature *lf = new LinearFeature( feature_config );
+      max_layer = lf->getLayerIndex();
+      f = lf;
+    }
+    else if ( feature_type == F_QUADRATIC ) {
+
+      QuadraticFeature *qf = new QuadraticFeature( feature_config );
+      max_layer = qf->getLayerIndex();
+      f = qf;
+    }
+    else if ( feature_type == F_PRODUCT ) {
+
+      ProductFeature *pf = new ProductFeature( feature_config );
+      max_layer = max( pf->getLayerIndex1(), pf->getLayerIndex2() );
+      f = pf;
+    }
+    else if ( feature_type == F_HINGE ) {
+
+      HingeFeature *hf = new HingeFeature( feature_config );
+      max_layer = hf->getLayerIndex();
+      f = hf;
+    }
+    else if ( feature_type == F_THRESHOLD ) {
+
+      ThresholdFeature *tf = new ThresholdFeature( feature_config );
+      max_layer = tf->getLayerIndex();
+      f = tf;
+    }
+    else {
+
+      Log::instance()->error( MAXENT_LOG_PREFIX "Unknown feature type in initial model\n" );
+      return false;
+    }
+
+    _initial_features.push_back( f );
+
+    if ( max_layer >= num_layers ) {
+
+      Log::instance()->error( MAXENT_LOG_PREFIX "Initial model %s uses more layers than the current environment.\n", file.c_str() );
+      return false;
+    }
+  }
+
+  Log::instance()->info( MAXENT_LOG_PREFIX "Initializing training with model %s (%d features, %d background points)\n", file.c_str(), (int)_initial_features.size(), _initial_background->numOccurrences() );
+
+  return true;
+}
+
+/***************************/
+/*** apply Initial Model ***/
+
+void
+MaximumEntropy::applyInitialModel()
+{
+  if ( _initial_features.empty() ) {
+
+    return;
+  }
+
+  bool has_hinge = false;
+  bool has_threshold = false;
+
+  for ( unsigned int g = 0; g < _generators.size(); ++g ) {
+
+    if ( _generators[g]->type() == G_HINGE ) {
+
+      has_hinge = true;
+    }
+    else if ( _generators[g]->type() == G_THRESHOLD ) {
+
+      has_threshold = true;
+    }
+  }
+
+  int num_used = 0;
+
+  for ( unsigned int i = 0; i < _initial_features.size(); ++i ) {
+
+    MxFeature *f = _initial_features[i];
+
+    int type = f->type();
+
+    if ( type == F_HINGE || type == F_THRESHOLD ) {
+
+      if ( ( type == F_HINGE && ! has_hinge ) || ( type == F_THRESHOLD && ! has_threshold ) ) {
+
+        continue;
+      }
+
+      int gen_type = ( type == F_HINGE ) ? G_HINGE : G_THRESHOLD;
+      int layer = ( type == F_HINGE ) ? ((HingeFeature *)f)->getLayerIndex() : ((ThresholdFeature *)f)->getLayerIndex();
+      bool reverse = ( type == F_HINGE ) && ((HingeFeature *)f)->isReverse();
+      Scalar threshold = ( type == F_HINGE ) ? f->minimum() : ((ThresholdFeature *)f)->threshold();
+
+      // Transfer the lambda to the feature of its generator with the same
+      // threshold, so that it keeps being trained like any generated
+      // feature and is never generated again
+      FeatureGenerator *gen = 0;
+      int idx = -1;
+
+      for ( unsigned int g = 0; g < _generators.size(); ++g ) {
+
+        FeatureGenerator *candidate = _generators[g];
+
+        if ( candidate->type() == gen_type && candidate->getLayerIndex() == layer && candidate->isReverse() == reverse ) {
+
+          idx = candidate->findThreshold( threshold );
+
+          if ( idx >= 0 ) {
+
+            gen = candidate;
+          }
+
+          break;
+        }
+      }
+
+      MxFeature *same = 0;
+
+      if ( gen ) {
+
+        same = gen->getFeature( idx );
+
+        if ( same == 0 ) {
+
+          same = gen->exportFeature( idx );
+          _features.push_back( same );
+        }
+      }
+      else {
 
-      alpha = log( (n1 - beta1) * w0 / ((n0 + beta1) * w1) );
+        // Thresholds that do not exist with the current points are
+        // trained as regular features
+        for ( unsigned int j = 0; j < _features.size(); ++j ) {
 
-      if ( alpha + lambda <= 0.0 ) {
+          MxFeature *g = _features[j];
 
-	if ( n0 - beta1 > MINLIMIT ) {
+          if ( g->type() != type || g->postGenerated() ) {
 
-	  alpha = log( (n1 + beta1) * w0 / ( (n0 - beta1) * w1) );
+            continue;
+          }
 
-          if ( alpha + lambda >= 0.0 ) {
+          if ( ( type == F_HINGE && ((HingeFeature *)g)->getLayerIndex() == layer && ((HingeFeature *)g)->isReverse() == reverse && g->minimum() == threshold ) ||
+               ( type == F_THRESHOLD && ((ThresholdFeature *)g)->getLayerIndex() == layer && ((ThresholdFeature *)g)->threshold() == threshold ) ) {
 
-            alpha = -lambda;
+            same = g;
+            break;
           }
         }
-        else {
 
-          alpha = -lambda;
+        if ( same == 0 ) {
+
+          f->setPostGenerated( false );
+          f->setPrevLambda( f->lambda() );
+          _features.push_back( f );
+          _initial_features[i] = 0;
+          ++num_used;
+          continue;
         }
       }
+
+      // Features with the same threshold are merged
+      same->setLambda( same->lambda() + f->lambda() );
+      same->setPrevLambda( same->lambda() );
+      ++num_used;
+
+      continue;
     }
-    else {
 
-      if ( n0 - beta1 > MINLIMIT ) {
+    // Transfer the lambda to the corresponding feature
+    for ( unsigned int j = 0; j < _features.size(); ++j ) {
 
-        alpha = log( (n1 + beta1) * w0 / ( (n0 - beta1) * w1) );
-	
-        if ( alpha + lambda >= 0.0 ) {
+      MxFeature *g = _features[j];
 
-          alpha = -lambda;
-        }
+      if ( g->type() != type || ! g->isActive() ) {
+
+        continue;
       }
-      else {
 
-        alpha = -lambda;
+      bool same = false;
+
+      if ( type == F_LINEAR ) {
+
+        same = ((LinearFeature *)g)->getLayerIndex() == ((LinearFeature *)f)->getLayerIndex();
+      }
+      else if ( type == F_QUADRATIC ) {
+
+        same = ((QuadraticFeature *)g)->getLayerIndex() == ((QuadraticFeature *)f)->getLayerIndex();
+      }
+      else if ( type == F_PRODUCT ) {
+
+        same = ((ProductFeature *)g)->getLayerIndex1() == ((ProductFeature *)f)->getLayerIndex1() &&
+               ((ProductFeature *)g)->getLayerIndex2() == ((ProductFeature *)f)->getLayerIndex2();
+      }
+
+      if ( same ) {
+
+        g->setLambda( f->lambda() );
+        g->setPrevLambda( f->lambda() );
+        ++num_used;
+        break;
       }
     }
   }
 
-  return alpha;
+  if ( num_used < (int)_initial_features.size() ) {
+
+    Log::instance()->warn( MAXENT_LOG_PREFIX "%d features of the initial model are not available with the current parameters and will be ignored.\n", (int)_initial_features.size() - num_used );
+  }
+
+  for ( unsigned int i = 0; i < _initial_features.size(); ++i ) {
+
+    delete _initial_features[i];
+  }
+
+  _initial_features.clear();
+}
+
+/*****************/
+/*** get Alpha ***/
+
+double
+MaximumEntropy::getAlpha( double w1, double n1, double beta1, double lambda, std::string description )
+{
+  UNUSED(description);
+
+  return mxAlpha( w1, n1, beta1, lambda );
 }
 
 /********************/
@@ -1614,21 +2590,11 @@ MaximumEntropy::lossChange( MxFeature * f, double alpha )
   double n1 = f->sampExp();
   double beta1 = f->sampDev();
   double change;
-
-  OccurrencesImpl::const_iterator p_iterator = _background->begin();
-  OccurrencesImpl::const_iterator p_end = _background->end();
-  int i = 0;
   double zz = 0.0;
 
-  while ( p_iterator != p_end ) {
+  MxFeatureSweep s( MxFeatureSweep::EXP_CHANGE, f, &_bg_columns[0], _num_background, _density, alpha );
 
-    Sample sample = (*p_iterator)->originalEnvironment();
-
-    zz += _density[i] * exp(alpha * f->getVal( sample ));
-
-    ++i;
-    ++p_iterator;
-  }
+  sweep( s, &zz );
 
   change = -alpha * n1 + log(zz) + (fabs(lambda + alpha) - fabs(lambda)) * beta1;
  
@@ -1644,19 +2610,9 @@ MaximumEntropy::runNewtonStep( MxFeature * f ) {
   double w1 = f->exp();
   double wu = 0.0;
 
-  OccurrencesImpl::const_iterator p_iterator = _background->begin();
-  OccurrencesImpl::const_iterator p_end = _background->end();
-  int i = 0;
-
-  while ( p_iterator != p_end ) {
-
-    Sample sample = (*p_iterator)->originalEnvironment();
+  MxFeatureSweep s( MxFeatureSweep::SECOND_MOMENT, f, &_bg_columns[0], _num_background, _density );
 
-    wu += _density[i] * pow( f->getVal(sample), 2 );
-
-    ++i;
-    ++p_iterator;
-  }
+  sweep( s, &wu );
 
   wu = wu / _z_lambda - pow(w1, 2);
 
@@ -1687,31 +2643,10 @@ MaximumEntropy::getDeriv( MxFeature * f )
   double n1 = f->sampExp();
   double beta1 = f->sampDev();
   double lambda = f->lambda();
-  double deriv = w1 - n1;
 
   Log::instance()->debug("f: %s w1=%.16f n1=%.16f beta1=%.16f lambda=%.16f\n", f->getDescription(_samp->getEnvironment()).c_str(), w1, n1, beta1, lambda);
 
-  if ( lambda < 0.0 ) {
-
-    return deriv - beta1;
-  }
-
-  if ( lambda > 0.0 ) {
-
-    return deriv + beta1;
-  }
-
-  if ( deriv + beta1 > 0.0 ) {
-
-    return deriv + beta1;
-  }
-
-  if ( deriv - beta1 < 0.0 ) {
-
-    return deriv - beta1;
-  }
-
-  return 0.0;
+  return mxDerivative( w1, n1, beta1, lambda );
 }
 
 /******************/
@@ -1755,24 +2690,13 @@ MaximumEntropy::increaseLambda( MxFeature * f, double alpha, vector<MxFeature*>
 
     f->setLambda( lambda + alpha );
 
-    OccurrencesImpl::const_iterator p_iterator = _background->begin();
-    OccurrencesImpl::const_iterator p_end = _background->end();
-    int i = 0;
-
-    while ( p_iterator != p_end ) {
-
-      Sample sample = (*p_iterator)->originalEnvironment();
+    MxLinearPredSweep s( &_bg_columns[0], _num_background, _linear_pred );
 
-      _linear_pred[i] += alpha * f->getVal( sample );
+    s.add( f, alpha );
 
-      if ( i == 0 || _linear_pred[i] > _linear_normalizer ) {
+    sweep( s, 0 );
 
-        _linear_normalizer = _linear_pred[i];
-      }
-
-      ++i;
-      ++p_iterator;
-    }
+    setLinearNormalizer();
 
     calcDensity( to_update );
   }
@@ -1788,6 +2712,8 @@ MaximumEntropy::increaseLambda( double* alpha, vector<MxFeature*> to_update )
 {
   double lambda;
 
+  MxLinearPredSweep s( &_bg_columns[0], _num_background, _linear_pred );
+
   for ( unsigned int i = 0; i < _features.size(); ++i ) {
 
     lambda = _features[i]->lambda();
@@ -1796,22 +2722,12 @@ MaximumEntropy::increaseLambda( double* alpha, vector<MxFeature*> to_update )
 
       _features[i]->setLambda( lambda + alpha[i] );
 
-      OccurrencesImpl::const_iterator p_iterator = _background->begin();
-      OccurrencesImpl::const_iterator p_end = _background->end();
-      int j = 0;
-
-      while ( p_iterator != p_end ) {
-
-        Sample sample = (*p_iterator)->originalEnvironment();
-
-        _linear_pred[j] += alpha[i] * _features[i]->getVal( sample );
-
-        ++j;
-        ++p_iterator;
-      }
+      s.add( _features[i], alpha[i] );
     }
   }
 
+  sweep( s, 0 );
+
   setLinearNormalizer();
   calcDensity( to_update );
   updateReg();
@@ -1912,6 +2828,10 @@ MaximumEntropy::featuresToUpdate()
   vector< pair<int, double> > lb;
   vector<MxFeature*> to_update;
   vector<int> to_update_idx;
+
+  vector<double> features_dlb;
+
+  lossBounds( features_dlb, 0 );
   
   vector<MxFeature*>::iterator it;
   for ( it = _features.begin(); it != _features.end(); ++it,++j ) {
@@ -1922,7 +2842,7 @@ MaximumEntropy::featuresToUpdate()
       to_update_idx.push_back(j);
     }
 
-    lb.push_back( make_pair(j, lossBound( (*it)->isActive(), (*it)->exp(), (*it)->sampExp(), (*it)->sampDev(), (*it)->lambda(), (*it)->getDescription(_samp->getEnvironment())) ) );
+    lb.push_back( make_pair(j, features_dlb[j]) );
   }
 
   sort( lb.begin(), lb.end(), by_value() );
@@ -1979,6 +2899,15 @@ MaximumEntropy::done() const
 Scalar
 MaximumEntropy::getValue( const Sample& x ) const
 {
+  if ( _compiled ) {
+
+    Scalar value;
+
+    getValues( x.begin(), 1, (int)x.size(), 0, &value );
+
+    return value;
+  }
+
   double prob = 0.0 ;
   double val;
 
@@ -1995,7 +2924,15 @@ MaximumEntropy::getValue( const Sample& x ) const
     prob += (*it)->lambda() * val;
   }
 
-  prob = exp(prob - _linear_normalizer)/_z_lambda;
+  return outputValue( prob - _linear_normalizer );
+}
+
+/******************/
+/*** get Values ***/
+Scalar
+MaximumEntropy::outputValue( double linear_pred ) const
+{
+  double prob = exp(linear_pred)/_z_lambda;
 
   if ( !finite(prob) ) {
 
@@ -2011,8 +2948,262 @@ MaximumEntropy::getValue( const Sample& x ) const
   }
   else {
 
-    return ( ( exp(_entropy) * prob ) / ( 1 + ( exp(_entropy) * prob ) ) );
+    return ( ( _exp_entropy * prob ) / ( 1 + ( _exp_entropy * prob ) ) );
+  }
+}
+
+void
+MaximumEntropy::getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const
+{
+  if ( ! _compiled ) {
+
+    AlgorithmImpl::getValues( samples, numSamples, dim, numCategorical, values );
+    return;
+  }
+
+  // Linear predictors are accumulated in the output array, one group
+  // of features at a time for all points.
+  for ( int i = 0; i < numSamples; ++i ) {
+
+    values[i] = _constant;
+  }
+
+  vector<MxLayerFunction>::const_iterator fn = _layer_functions.begin();
+
+  for ( ; fn != _layer_functions.end(); ++fn ) {
+
+    const Scalar *knots = &fn->knots[0];
+    const Scalar *last_knot = knots + fn->knots.size();
+    const double *slopes = &fn->slopes[0];
+    const double *intercepts = &fn->intercepts[0];
+
+    const Scalar *x = samples + fn->layer;
+
+    for ( int i = 0; i < numSamples; ++i, x += dim ) {
+
+      // Segment index is the number of knots lower than the value
+      int s = (int)( std::lower_bound( knots, last_knot, *x ) - knots );
+
+      values[i] += slopes[s] * (*x) + intercepts[s];
+    }
+  }
+
+  vector<MxProductTerm>::const_iterator term = _product_terms.begin();
+
+  for ( ; term != _product_terms.end(); ++term ) {
+
+    const Scalar *x1 = samples + term->layer1;
+    const Scalar *x2 = samples + term->layer2;
+
+    const Scalar lower = term->lower;
+    const Scalar upper = term->upper;
+    const double coef = term->coef;
+
+    for ( int i = 0; i < numSamples; ++i ) {
+
+      Scalar val = x1[i*dim] * x2[i*dim];
+
+      val = ( val < lower ) ? lower : val;
+      val = ( val > upper ) ? upper : val;
+
+      values[i] += coef * val;
+    }
+  }
+
+  for ( int i = 0; i < numSamples; ++i ) {
+
+    values[i] = outputValue( values[i] );
+  }
+}
+
+/************************/
+/*** compile Features ***/
+void
+MaximumEntropy::compileFeatures()
+{
+  _compiled = false;
+  _layer_functions.clear();
+  _product_terms.clear();
+
+  _exp_entropy = exp(_entropy);
+
+  _constant = -_linear_normalizer;
+
+  // Piecewise linear features are first grouped by layer
+  std::map< int, vector<MxFeature*> > layer_features;
+
+  vector<MxFeature*>::const_iterator it;
+
+  for ( it = _features.begin(); it != _features.end(); ++it ) {
+
+    MxFeature *f = *it;
+
+    double lambda = f->lambda();
+
+    if ( lambda == 0.0 ) {
+
+      continue;
+    }
+
+    int type = f->type();
+
+    // Normalized features are clamped between min and max, which would
+    // divide by zero here (leave these models to the feature objects)
+    if ( type != F_THRESHOLD && ! ( f->scale() > 0.0 ) ) {
+
+      Log::instance()->debug( MAXENT_LOG_PREFIX "Feature with null scale. Model will not be compiled.\n" );
+      _layer_functions.clear();
+      _product_terms.clear();
+      return;
+    }
+
+    if ( type == F_LINEAR ) {
+
+      layer_features[((LinearFeature*)f)->getLayerIndex()].push_back( f );
+    }
+    else if ( type == F_HINGE ) {
+
+      layer_features[((HingeFeature*)f)->getLayerIndex()].push_back( f );
+    }
+    else if ( type == F_THRESHOLD ) {
+
+      layer_features[((ThresholdFeature*)f)->getLayerIndex()].push_back( f );
+    }
+    else if ( type == F_QUADRATIC || type == F_PRODUCT ) {
+
+      // lambda*clamp((x1*x2-min)/scale, 0, 1) = coef*clamp(x1*x2, min, max) - coef*min
+      MxProductTerm term;
+
+      if ( type == F_QUADRATIC ) {
+
+        term.layer1 = term.layer2 = ((QuadraticFeature*)f)->getLayerIndex();
+      }
+      else {
+
+        term.layer1 = ((ProductFeature*)f)->getLayerIndex1();
+        term.layer2 = ((ProductFeature*)f)->getLayerIndex2();
+      }
+
+      term.lower = f->minimum();
+      term.upper = f->maximum();
+      term.coef = lambda / f->scale();
+
+      _constant -= term.coef * term.lower;
+
+      _product_terms.push_back( term );
+    }
+    else {
+
+      return;
+    }
+  }
+
+  std::map< int, vector<MxFeature*> >::const_iterator lf = layer_features.begin();
+
+  for ( ; lf != layer_features.end(); ++lf ) {
+
+    MxLayerFunction fn;
+
+    fn.layer = lf->first;
+
+    const vector<MxFeature*>& features = lf->second;
+
+    // Knots: value range of linear and hinge features and thresholds
+    for ( it = features.begin(); it != features.end(); ++it ) {
+
+      MxFeature *f = *it;
+
+      if ( f->type() == F_THRESHOLD ) {
+
+        fn.knots.push_back( ((ThresholdFeature*)f)->threshold() );
+      }
+      else if ( f->type() == F_HINGE && ((HingeFeature*)f)->isReverse() ) {
+
+        fn.knots.push_back( -f->maximum() );
+        fn.knots.push_back( -f->minimum() );
+      }
+      else {
+
+        fn.knots.push_back( f->minimum() );
+        fn.knots.push_back( f->maximum() );
+      }
+    }
+
+    std::sort( fn.knots.begin(), fn.knots.end() );
+    fn.knots.erase( std::unique( fn.knots.begin(), fn.knots.end() ), fn.knots.end() );
+
+    int num_segments = (int)fn.knots.size() + 1;
+
+    fn.slopes.assign( num_segments, 0.0 );
+    fn.intercepts.assign( num_segments, 0.0 );
+
+    for ( it = features.begin(); it != features.end(); ++it ) {
+
+      MxFeature *f = *it;
+
+      double lambda = f->lambda();
+
+      if ( f->type() == F_THRESHOLD ) {
+
+        // lambda when x > t
+        int t = (int)( std::lower_bound( fn.knots.begin(), fn.knots.end(), ((ThresholdFeature*)f)->threshold() ) - fn.knots.begin() );
+
+        for ( int s = t + 1; s < num_segments; ++s ) {
+
+          fn.intercepts[s] += lambda;
+        }
+
+        continue;
+      }
+
+      // lambda*clamp((v-min)/scale, 0, 1) with v = x or v = -x (reverse hinge)
+      double coef = lambda / f->scale();
+      double full = coef * ( f->maximum() - f->minimum() );
+
+      bool reverse = ( f->type() == F_HINGE && ((HingeFeature*)f)->isReverse() );
+
+      Scalar k1 = reverse ? -f->maximum() : f->minimum();
+      Scalar k2 = reverse ? -f->minimum() : f->maximum();
+
+      int a = (int)( std::lower_bound( fn.knots.begin(), fn.knots.end(), k1 ) - fn.knots.begin() );
+      int b = (int)( std::lower_bound( fn.knots.begin(), fn.knots.end(), k2 ) - fn.knots.begin() );
+
+      for ( int s = 0; s < num_segments; ++s ) {
+
+        if ( s <= a ) {
+
+          // x <= k1: 0 (or full when reverse)
+          if ( reverse ) {
+
+            fn.intercepts[s] += full;
+          }
+        }
+        else if ( s <= b ) {
+
+          if ( reverse ) {
+
+            fn.slopes[s] -= coef;
+          }
+          else {
+
+            fn.slopes[s] += coef;
+          }
+
+          fn.intercepts[s] -= coef * f->minimum();
+        }
+        else if ( ! reverse ) {
+
+          fn.intercepts[s] += full;
+        }
+      }
+    }
+
+    _layer_functions.push_back( fn );
   }
+
+  _compiled = true;
+
+  Log::instance()->debug( MAXENT_LOG_PREFIX "Compiled %d layer functions and %d product terms\n", (int)_layer_functions.size(), (int)_product_terms.size() );
 }
 
 /***********************/
@@ -2062,6 +3253,26 @@ MaximumEntropy::_getConfiguration( ConfigurationPtr& config ) const
   features_config->addNameValue( "Num", num_active_features );
 
   model_config->addSubsection( features_config );
+
+  // Background points without merged presences (see loadInitialModel)
+  if ( _save_background && _background && _num_sampled_background > 0 ) {
+
+    OccurrencesPtr background( new OccurrencesImpl( _background->label(), _background->coordSystem() ) );
+
+    OccurrencesImpl::const_iterator it = _background->begin();
+    OccurrencesImpl::const_iterator end = _background->end();
+
+    for ( int i = 0; it != end && i < _num_sampled_background; ++it, ++i ) {
+
+      background->insert( *it );
+    }
+
+    ConfigurationPtr background_config( new ConfigurationImpl( "Background" ) );
+
+    background_config->addSubsection( background->getConfiguration() );
+
+    model_config->addSubsection( background_config );
+  }
 }
 
 void
@@ -2135,5 +3346,18 @@ MaximumEntropy::_setConfiguration( const ConstConfigurationPtr& config )
     }
   }
 
+  // Background points are kept to be serialized again
+  ConstConfigurationPtr background_config = model_config->getSubsection( "Background", false );
+
+  if ( background_config && background_config->getSubsection( "Occurrences", false ) ) {
+
+    _background = new OccurrencesImpl( 0.0 );
+    _background->setConfiguration( background_config->getSubsection( "Occurrences" ) );
+    _num_sampled_background = _background->numOccurrences();
+    _save_background = true;
+  }
+
+  compileFeatures();
+
   _done = true;
 }
@@ -39,6 +39,9 @@ using std::pair;
 #include "mxfeature.hh"
 #include "feature_generator.hh"
 
+class ThreadPool;
+class MxSweep;
+
 /*********************************************************/
 /******************** Maximum Entropy ********************/
 
@@ -57,6 +60,8 @@ public:
   float getProgress() const;
   int done() const;
   Scalar getValue( const Sample& x ) const;
+  int supportsThreadedProjection() const { return 1; }
+  void getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const;
   int getConvergence( Scalar * const val ) const;
 
 private:
@@ -88,6 +93,56 @@ private:
   // Dump the given maxent vars related to a specfic iteration
   void displayInfo( MxFeature * f, double loss_bound, double new_loss, double delta_loss, double alpha );
 
+  // Copy environmental values of background and presence points into
+  // column-major matrices used during training.
+  void loadColumns();
+
+  // Run a computation over all background points, split into chunks
+  // that may run in parallel. Partial sums of the chunks are added in
+  // chunk order, so results do not depend on the number of threads.
+  void sweep( MxSweep& s, double *sums );
+
+  // Read features and background points of a serialized model used
+  // to initialize training.
+  bool loadInitialModel( const std::string& file );
+
+  // Transfer the lambdas of the initial model to the new features.
+  void applyInitialModel();
+
+  // Update expectations of all feature generators (in parallel).
+  void updateGenerators();
+
+  // Calculate the loss bounds of all features and, optionally, of all
+  // thresholds of each feature generator (in parallel).
+  void lossBounds( vector<double>& features_dlb, vector< vector<double> > *generators_dlb );
+
+  // Compile the features with non zero lambda into the flat program
+  // used by getValue and getValues.
+  void compileFeatures();
+
+  // Convert the linear predictor of a point into the model output.
+  Scalar outputValue( double linear_pred ) const;
+
+  // Sum of linear, hinge and threshold features of one layer. It is a
+  // piecewise linear function of the layer value, so it is stored as
+  // sorted knots plus the slope and intercept of each segment. Segment
+  // i holds the values greater than knot i-1 and not greater than knot i.
+  struct MxLayerFunction {
+    int layer;
+    vector<Scalar> knots;
+    vector<double> slopes;     // knots.size()+1 segments
+    vector<double> intercepts; // knots.size()+1 segments
+  };
+
+  // Quadratic (layer1 == layer2) or product feature: coef*clamp(x1*x2).
+  struct MxProductTerm {
+    int layer1;
+    int layer2;
+    Scalar lower;
+    Scalar upper;
+    double coef;
+  };
+
   double *_linear_pred; // probability of each point
   double _linear_normalizer;/// linear normalizer
   double *_density; // density for each point
@@ -95,6 +150,25 @@ private:
   double _z_lambda;
   double _entropy;
 
+  // Compiled features (see compileFeatures).
+  bool _compiled;
+  double _constant; // Constant terms minus the linear normalizer.
+  double _exp_entropy;
+  vector<MxLayerFunction> _layer_functions;
+  vector<MxProductTerm> _product_terms;
+
+  // Training data (see loadColumns).
+  ThreadPool *_pool;
+  int _num_layers;
+  vector<Scalar> _bg_columns; // _num_layers columns with _num_background values
+  vector<Scalar> _pr_columns; // _num_layers columns with _num_presences values
+
+  // Initial model (see loadInitialModel).
+  vector<MxFeature*> _initial_features;
+  OccurrencesPtr _initial_background;
+  int _num_sampled_background; // Background points without merged presences
+  bool _save_background; // Serialize background points (see SAVE_BACKGROUND_ID)
+
 protected:
 
   virtual void _getConfiguration( ConfigurationPtr& ) const;
@@ -96,7 +96,12 @@ public:
 
   void setMinMax( Scalar pmin, Scalar pmax ){_min=pmin; _max=pmax; _scale=pmax-pmin;}
 
+  Scalar minimum() const {return _min;}
+  Scalar maximum() const {return _max;}
+  Scalar scale() const {return _scale;}
+
   bool postGenerated() const {return _postgen;}
+  void setPostGenerated( bool postgen ){_postgen = postgen;}
 
 protected:
   MxFeature() {
@@ -51,6 +51,9 @@ public:
   ConfigurationPtr getConfiguration() const;
   void setConfiguration( const ConstConfigurationPtr & config );
 
+  int getLayerIndex1() const {return _layerIndex1;}
+  int getLayerIndex2() const {return _layerIndex2;}
+
 private:
   int _layerIndex1;
   int _layerIndex2;
@@ -53,6 +53,8 @@ public:
   
   void setConfiguration( const ConstConfigurationPtr & config );
 
+  int getLayerIndex() const {return _layerIndex;}
+
 private:
   
   int _layerIndex;
@@ -53,6 +53,10 @@ public:
   
   void setConfiguration( const ConstConfigurationPtr & config );
 
+  int getLayerIndex() const {return _layerIndex;}
+
+  Scalar threshold() const {return _t;}
+
 private:
   
   int _layerIndex;
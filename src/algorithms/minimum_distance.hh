@@ -51,6 +51,7 @@ public:
   int done() const;
 
   Scalar getValue( const Sample& x ) const;
+  int supportsThreadedProjection() const { return 1; }
   int    getConvergence( Scalar *val );
 
 protected:
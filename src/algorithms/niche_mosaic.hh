@@ -70,6 +70,7 @@ class NicheMosaic : public AlgorithmImpl
    float getProgress() const;
 
    Scalar getValue( const Sample& x ) const;
+   int supportsThreadedProjection() const { return 1; }
 
    //set minimum, maximum and delta for each layer.
    int setMinMaxDelta();
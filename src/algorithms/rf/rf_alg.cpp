@@ -28,6 +28,7 @@
 
 #include <openmodeller/Sampler.hh>
 #include <openmodeller/Exceptions.hh>
+#include <openmodeller/ThreadPool.hh>
 
 #include <string.h>
 #include <stdio.h>
@@ -144,6 +145,39 @@ algorithmMetadata()
 }
 
 
+/****************************************************************/
+/************************ Tree Growth Task **********************/
+
+/*
+ * Grows a tree and measures the importance of each variable with its
+ * out-of-bag instances. Trees only use their own seeds, so they can be
+ * grown by any thread.
+ */
+class RfGrowTask : public ThreadPoolTask {
+
+public:
+
+  RfGrowTask( Tree *tree, unsigned int seed ) :
+    ThreadPoolTask(),
+    tree( tree ),
+    seed( seed ),
+    importance()
+  {}
+
+  void run( int )
+  {
+    tree->grow();
+    tree->variable_importance( &importance, &seed );
+  }
+
+  Tree *tree;
+
+  unsigned int seed; // Used to permute variables.
+
+  vector<float> importance;
+};
+
+
 /*********************************************/
 /************** SVM algorithm ****************/
 
@@ -153,7 +187,10 @@ algorithmMetadata()
 RfAlgorithm::RfAlgorithm() :
   AlgorithmImpl( &metadata ),
   _done( false ),
-  _initialized( false )
+  _initialized( false ),
+  _pool( 0 ),
+  _oob_cases( 0 ),
+  _oob_accuracy( -1.0 )
 {
 }
 
@@ -163,6 +200,8 @@ RfAlgorithm::RfAlgorithm() :
 
 RfAlgorithm::~RfAlgorithm()
 {
+  delete _pool;
+
   if ( _initialized ) {
 
     delete _set;
@@ -299,6 +338,23 @@ RfAlgorithm::initialize()
     _set = InstanceSet::load_unsupervised( data, &seed );
   }
 
+  _oob_predictions.resize( _set->size(), DiscreteDist( 2 ) );
+
+  _importance_sum.resize( num_layers, 0.0 );
+
+  // Trees can be grown in parallel
+  int num_threads = getNumThreads();
+
+  if ( num_threads < 1 ) {
+
+    num_threads = ThreadPool::numProcessors();
+  }
+
+  if ( num_threads > 1 && _num_trees > 1 ) {
+
+    _pool = new ThreadPool( num_threads );
+  }
+
   _initialized = true;
 
   return 1;
@@ -324,30 +380,178 @@ RfAlgorithm::_sampleToLine( Sample sample, stringstream& ss ) const
 int
 RfAlgorithm::iterate()
 {
-  if ( (int)_trees.size() < _num_trees ) {
+  int num_grown = (int)_trees.size();
 
-    weight_list* w = new weight_list( _set->size(), _set->size());
+  if ( num_grown < _num_trees ) {
 
-    // sample with replacement
-    for ( unsigned int j = 0; j < _set->size(); ++j ) {
+    // Trees of a batch are prepared in sequence (bootstrap samples and
+    // seeds come from _rand) and then grown in parallel, so the forest
+    // does not depend on the number of threads.
+    int batch = _pool ? _pool->numThreads() : 1;
 
-      int instance = _rand.get( 0, _set->size() - 1 );
-      w->add( instance, _class_weights[_set->label(instance)] );
+    if ( batch > _num_trees - num_grown ) {
+
+      batch = _num_trees - num_grown;
     }
 
-    Tree* tree = new Tree( *_set, w, _k, 1, 0, _rand.get(1000) );
-    tree->grow();
+    vector<RfGrowTask*> tasks;
+
+    for ( int b = 0; b < batch; ++b ) {
+
+      weight_list* w = new weight_list( _set->size(), _set->size());
+
+      // sample with replacement
+      for ( unsigned int j = 0; j < _set->size(); ++j ) {
+
+        int instance = _rand.get( 0, _set->size() - 1 );
+        w->add( instance, _class_weights[_set->label(instance)] );
+      }
+
+      Tree* tree = new Tree( *_set, w, _k, 1, 0, _rand.get(1000) );
+
+      tasks.push_back( new RfGrowTask( tree, num_grown + b + 1 ) );
+    }
+
+    if ( _pool ) {
 
-    _trees.push_back(tree);
+      for ( int b = 0; b < batch; ++b ) {
+
+        _pool->submit( tasks[b] );
+      }
+
+      _pool->waitAll();
+    }
+    else {
+
+      tasks[0]->run( 0 );
+    }
+
+    for ( int b = 0; b < batch; ++b ) {
+
+      Tree *tree = tasks[b]->tree;
+
+      // Out-of-bag votes and importance
+      tree->oob_predictions( &_oob_predictions );
+
+      for ( unsigned int i = 0; i < _set->size(); ++i ) {
+
+        if ( tree->oob( i ) ) {
+
+          ++_oob_cases;
+        }
+      }
+
+      const vector<float>& importance = tasks[b]->importance;
+
+      for ( unsigned int j = 0; j < importance.size() && j < _importance_sum.size(); ++j ) {
+
+        _importance_sum[j] += importance[j];
+      }
+
+      _trees.push_back( tree );
+
+      delete tasks[b];
+    }
   }
   else {
 
+    delete _pool;
+    _pool = 0;
+
+    _summarize();
+
+    _flatten();
+
     _done = true;
   }
 
   return 1;
 }
 
+/*****************/
+/*** summarize ***/
+void
+RfAlgorithm::_summarize()
+{
+  int correct = 0;
+  int total = 0;
+
+  // Only instances that were out of bag for at least one tree
+  for ( unsigned int i = 0; i < _oob_predictions.size(); ++i ) {
+
+    if ( _oob_predictions[i].sum() > 0 ) {
+
+      ++total;
+
+      if ( _oob_predictions[i].mode() == _set->label(i) ) {
+
+        ++correct;
+      }
+    }
+  }
+
+  _oob_accuracy = ( total > 0 ) ? (double)correct / (double)total : -1.0;
+
+  _importance.resize( _importance_sum.size() );
+
+  for ( unsigned int j = 0; j < _importance_sum.size(); ++j ) {
+
+    _importance[j] = ( _oob_cases > 0 ) ? _importance_sum[j] / (double)_oob_cases : 0.0;
+  }
+
+  if ( _oob_accuracy >= 0.0 ) {
+
+    Log::instance()->info( RF_LOG_PREFIX "Out-of-bag accuracy: %.4f\n", _oob_accuracy );
+  }
+
+  for ( unsigned int j = 0; j < _importance.size(); ++j ) {
+
+    Log::instance()->debug( RF_LOG_PREFIX "Importance of variable %u: %.4f\n", j, _importance[j] );
+  }
+}
+
+/***************/
+/*** flatten ***/
+void
+RfAlgorithm::_flatten()
+{
+  _nodes.clear();
+  _roots.clear();
+
+  for ( unsigned int i = 0; i < _trees.size(); ++i ) {
+
+    int offset = (int)_nodes.size();
+
+    _roots.push_back( offset );
+
+    unsigned int num_nodes = _trees[i]->num_nodes();
+
+    for ( unsigned int j = 0; j < num_nodes; ++j ) {
+
+      const tree_node *p_node = _trees[i]->get_node( j );
+
+      FlatNode node;
+
+      if ( p_node->status == SPLIT ) {
+
+        node.split = p_node->split_point;
+        node.attr = (int)p_node->attr;
+        node.left = offset + (int)p_node->left;
+        node.right = offset + (int)p_node->right;
+      }
+      else {
+
+        node.split = 0.0;
+        node.attr = -1;
+        node.left = (int)p_node->label;
+        node.right = 0;
+      }
+
+      _nodes.push_back( node );
+    }
+  }
+}
+
 /********************/
 /*** get Progress ***/
 float RfAlgorithm::getProgress() const
@@ -374,31 +578,63 @@ RfAlgorithm::done() const
 Scalar
 RfAlgorithm::getValue( const Sample& x ) const
 {
-  stringstream sdata("");
-
-  _sampleToLine( x, sdata );
+  Scalar value;
 
-  istream data( sdata.rdbuf() );
+  getValues( x.begin(), 1, (int)x.size(), 0, &value );
 
-  stringstream slabels("0");
+  return value;
+}
 
-  istream labels( slabels.rdbuf() );
+/******************/
+/*** get Values ***/
+void
+RfAlgorithm::getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const
+{
+  int num_trees = (int)_roots.size();
 
-  InstanceSet* set = InstanceSet::load_csv_and_labels( data, labels );
+  if ( num_trees == 0 ) {
 
-  DiscreteDist votes;
+    for ( int i = 0; i < numSamples; ++i ) {
 
-  for ( unsigned int i = 0; i < _trees.size(); ++i ) {
+      values[i] = 0.0;
+    }
 
-    int predict = _trees[i]->predict( *set, 0 );
-    votes.add( predict );
+    return;
   }
 
-  float prob = votes.percentage(0);
+  // Number of trees voting for presence (label 0). All points go
+  // through each tree before the next one, keeping its nodes in cache.
+  vector<int> votes( numSamples, 0 );
+
+  const FlatNode *nodes = &_nodes[0];
+
+  for ( int t = 0; t < num_trees; ++t ) {
 
-  delete set;
+    int root = _roots[t];
 
-  return (double)prob;
+    const Scalar *sample = samples;
+
+    for ( int i = 0; i < numSamples; ++i, sample += dim ) {
+
+      const FlatNode *node = nodes + root;
+
+      // Variables are compared with the same precision used in training.
+      while ( node->attr >= 0 ) {
+
+        node = nodes + ( ( (float)sample[node->attr] < node->split ) ? node->left : node->right );
+      }
+
+      if ( node->left == 0 ) {
+
+        ++votes[i];
+      }
+    }
+  }
+
+  for ( int i = 0; i < numSamples; ++i ) {
+
+    values[i] = (double)( float(votes[i]) / float(num_trees) );
+  }
 }
 
 /***********************/
@@ -424,6 +660,16 @@ RfAlgorithm::_getConfiguration( ConfigurationPtr& config ) const
   model_config->addNameValue( "Trees", _num_trees );
   model_config->addNameValue( "K", _k );
 
+  if ( _oob_accuracy >= 0.0 ) {
+
+    model_config->addNameValue( "OobAccuracy", _oob_accuracy );
+  }
+
+  if ( ! _importance.empty() ) {
+
+    model_config->addNameValue( "VariableImportance", &_importance[0], (int)_importance.size() );
+  }
+
   Tree* p_tree = NULL;
   tree_node* p_node = NULL;
 
@@ -488,6 +734,19 @@ RfAlgorithm::_setConfiguration( const ConstConfigurationPtr& config )
 
   _k = model_config->getAttributeAsInt( "K", 0 );
 
+  // Out-of-bag statistics are not available in older models
+  _oob_accuracy = model_config->getAttributeAsDouble( "OobAccuracy", -1.0 );
+
+  try {
+
+    _importance = model_config->getAttributeAsVecDouble( "VariableImportance" );
+  }
+  catch ( AttributeNotFound& e ) {
+
+    UNUSED(e);
+    _importance.clear();
+  }
+
   _trees.reserve( _num_trees );
 
   Configuration::subsection_list trees = model_config->getAllSubsections();
@@ -546,6 +805,8 @@ RfAlgorithm::_setConfiguration( const ConstConfigurationPtr& config )
     _trees.push_back( my_tree );
   }
 
+  _flatten();
+
   _initialized = true;
 
   _done = true;
@@ -34,6 +34,9 @@
 
 #include "librf/instance_set.h"
 #include "librf/tree.h"
+#include "librf/discrete_dist.h"
+
+class ThreadPool;
 
 /*****************************************/
 /************* Random Forests ************/
@@ -56,12 +59,33 @@ public:
   int done() const;
 
   Scalar getValue( const Sample& x ) const;
+  int supportsThreadedProjection() const { return 1; }
+  void getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const;
   int getConvergence( Scalar * const val ) const;
 
 protected:
 
+  /** Node of the flattened forest used for prediction. */
+  struct FlatNode {
+
+    float split; // Split point.
+    int attr;    // Split variable, or -1 for terminal nodes.
+    int left;    // Position of the left child, or label of terminal nodes.
+    int right;   // Position of the right child.
+  };
+
   void _sampleToLine( Sample sample, stringstream& ss ) const;
 
+  /** Copy all trees into _nodes, so that predictions are calculated
+   *  directly from samples (see getValues).
+   */
+  void _flatten();
+
+  /** Calculate the out-of-bag accuracy and the importance of each
+   *  variable after all trees were grown.
+   */
+  void _summarize();
+
   void _getConfiguration( ConfigurationPtr& ) const;
 
   void _setConfiguration( const ConstConfigurationPtr& );
@@ -81,6 +105,22 @@ protected:
   vector<int> _class_weights;
 
   vector<librf::Tree*> _trees;
+
+  ThreadPool *_pool; // Workers used to grow trees (only with more than one thread).
+
+  vector<librf::DiscreteDist> _oob_predictions; // Votes of the trees for their out-of-bag instances.
+
+  vector<double> _importance_sum; // Decrease in out-of-bag correct predictions after permuting each variable.
+
+  long _oob_cases; // Total number of out-of-bag instances of all trees.
+
+  double _oob_accuracy; // Out-of-bag accuracy of the forest (negative if unknown).
+
+  vector<double> _importance; // Mean decrease in out-of-bag accuracy for each variable.
+
+  vector<FlatNode> _nodes; // Nodes of all trees, in sequence.
+
+  vector<int> _roots; // Position of the root node of each tree.
 };
 
 
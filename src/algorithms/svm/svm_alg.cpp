@@ -29,10 +29,15 @@
 #include <openmodeller/MeanVarianceNormalizer.hh>
 #include <openmodeller/Sampler.hh>
 #include <openmodeller/Exceptions.hh>
+#include <openmodeller/ThreadPool.hh>
+#include <openmodeller/Random.hh>
 
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+
+#include <algorithm>
 
 //debug
 #include <iostream>
@@ -42,7 +47,7 @@ using namespace std;
 /****************************************************************/
 /********************** Algorithm's Metadata ********************/
 
-#define NUM_PARAM 9
+#define NUM_PARAM 13
 
 #define SVMTYPE_ID    "SvmType"
 #define KERNELTYPE_ID "KernelType"
@@ -53,9 +58,16 @@ using namespace std;
 #define NU_ID         "Nu"
 #define PROB_ID       "ProbabilisticOutput"
 #define PSEUDO_ID     "NumberOfPseudoAbsences"
+#define FOLDS_ID      "CrossValidationFolds"
+#define CGRID_ID      "CGrid"
+#define GAMMAGRID_ID  "GammaGrid"
+#define NUGRID_ID     "NuGrid"
 
 #define SVM_LOG_PREFIX "SvmAlgorithm: "
 
+// Number of points whose decision values are calculated together.
+#define SVM_BLOCK_SIZE 64
+
 /******************************/
 /*** Algorithm's parameters ***/
 
@@ -178,6 +190,58 @@ static AlgParamMetadata parameters[NUM_PARAM] = {
     0,         // Parameter's upper limit.
     "0"        // Parameter's typical (default) value.
   },
+  // Number of cross-validation folds for grid search
+  {
+    FOLDS_ID,                    // Id.
+    "Cross-validation folds",    // Name.
+    Integer,                     // Type.
+    "Number of folds used to choose parameters by cross-validation (0 = no grid search).", // Overview
+    "When greater than 1, C, gamma and nu are chosen among the values of the respective grid parameters with the best accuracy in a k-fold cross-validation with this number of folds (only for C-SVC and Nu-SVC). The final model is then trained with all points using the chosen values. Zero disables the grid search.", // Description.
+    1,         // Not zero if the parameter has lower limit.
+    0,         // Parameter's lower limit.
+    0,         // Not zero if the parameter has upper limit.
+    0,         // Parameter's upper limit.
+    "0"        // Parameter's typical (default) value.
+  },
+  // C grid
+  {
+    CGRID_ID,                    // Id.
+    "Cost grid",                 // Name.
+    String,                      // Type.
+    "Comma-separated values of cost for grid search.", // Overview
+    "Comma-separated values of cost to be tried during grid search (only for C-SVC). When empty, only the value of the cost parameter will be used.", // Description.
+    0,         // Not zero if the parameter has lower limit.
+    0,         // Parameter's lower limit.
+    0,         // Not zero if the parameter has upper limit.
+    0,         // Parameter's upper limit.
+    ""         // Parameter's typical (default) value.
+  },
+  // Gamma grid
+  {
+    GAMMAGRID_ID,                // Id.
+    "Gamma grid",                // Name.
+    String,                      // Type.
+    "Comma-separated values of gamma for grid search.", // Overview
+    "Comma-separated values of gamma to be tried during grid search (only for polynomial and radial basis kernels). When empty, only the value of the gamma parameter will be used.", // Description.
+    0,         // Not zero if the parameter has lower limit.
+    0,         // Parameter's lower limit.
+    0,         // Not zero if the parameter has upper limit.
+    0,         // Parameter's upper limit.
+    ""         // Parameter's typical (default) value.
+  },
+  // Nu grid
+  {
+    NUGRID_ID,                   // Id.
+    "Nu grid",                   // Name.
+    String,                      // Type.
+    "Comma-separated values of nu for grid search.", // Overview
+    "Comma-separated values of nu to be tried during grid search (only for Nu-SVC). When empty, only the value of the nu parameter will be used.", // Description.
+    0,         // Not zero if the parameter has lower limit.
+    0,         // Parameter's lower limit.
+    0,         // Not zero if the parameter has upper limit.
+    0,         // Parameter's upper limit.
+    ""         // Parameter's typical (default) value.
+  },
 };
 
 /************************************/
@@ -187,13 +251,13 @@ static AlgMetadata metadata = {
 
   "SVM", 	                   // Id.
   "SVM (Support Vector Machines)", // Name.
-  "0.5",       	                   // Version.
+  "0.6",       	                   // Version.
 
   // Overview
   "Support vector machines (SVMs) are a set of related supervised learning methods that belong to a family of generalized linear classifiers. They can also be considered a special case of Tikhonov regularization. A special property of SVMs is that they simultaneously minimize the empirical classification error and maximize the geometric margin; hence they are also known as maximum margin classifiers. Content retrieved from Wikipedia on the 13th of June, 2007: http://en.wikipedia.org/w/index.php?title=Support_vector_machine&oldid=136646498.",
 
   // Description.
-  "Support vector machines map input vectors to a higher dimensional space where a maximal separating hyperplane is constructed. Two parallel hyperplanes are constructed on each side of the hyperplane that separates the data. The separating hyperplane is the hyperplane that maximises the distance between the two parallel hyperplanes. An assumption is made that the larger the margin or distance between these parallel hyperplanes the better the generalisation error of the classifier will be. The model produced by support vector classification only depends on a subset of the training data, because the cost function for building the model does not care about training points that lie beyond the margin. Content retrieved from Wikipedia on the 13th of June, 2007: http://en.wikipedia.org/w/index.php?title=Support_vector_machine&oldid=136646498. The openModeller implementation of SVMs makes use of the libsvm library version 2.85: Chih-Chung Chang and Chih-Jen Lin, LIBSVM: a library for support vector machines, 2001. Software available at http://www.csie.ntu.edu.tw/~cjlin/libsvm.\n\nRelease history:\n version 0.1: initial release\n version 0.2: New parameter to specify the number of pseudo-absences to be generated; upgraded to libsvm 2.85; fixed memory leaks\n version 0.3: when absences are needed and the number of pseudo absences to be generated is zero, it will default to the same number of presences\n version 0.4: included missing serialization of C\n version 0.5: the indication if the algorithm needed normalized environmental data was not working when the algorithm was loaded from an existing model.",
+  "Support vector machines map input vectors to a higher dimensional space where a maximal separating hyperplane is constructed. Two parallel hyperplanes are constructed on each side of the hyperplane that separates the data. The separating hyperplane is the hyperplane that maximises the distance between the two parallel hyperplanes. An assumption is made that the larger the margin or distance between these parallel hyperplanes the better the generalisation error of the classifier will be. The model produced by support vector classification only depends on a subset of the training data, because the cost function for building the model does not care about training points that lie beyond the margin. Content retrieved from Wikipedia on the 13th of June, 2007: http://en.wikipedia.org/w/index.php?title=Support_vector_machine&oldid=136646498. The openModeller implementation of SVMs makes use of the libsvm library version 2.85: Chih-Chung Chang and Chih-Jen Lin, LIBSVM: a library for support vector machines, 2001. Software available at http://www.csie.ntu.edu.tw/~cjlin/libsvm.\n\nRelease history:\n version 0.1: initial release\n version 0.2: New parameter to specify the number of pseudo-absences to be generated; upgraded to libsvm 2.85; fixed memory leaks\n version 0.3: when absences are needed and the number of pseudo absences to be generated is zero, it will default to the same number of presences\n version 0.4: included missing serialization of C\n version 0.5: the indication if the algorithm needed normalized environmental data was not working when the algorithm was loaded from an existing model.\n version 0.6: optional grid search of C, gamma and nu with k-fold cross-validation.",
 
   "Vladimir N. Vapnik", // Algorithm author.
   "1) Vapnik, V. (1995) The Nature of Statistical Learning Theory. SpringerVerlag. 2) Schlkopf, B., Smola, A., Williamson, R. and Bartlett, P.L.(2000). New support vector algorithms. Neural Computation, 12, 1207-1245. 3) Schlkopf, B., Platt, J.C., Shawe-Taylor, J., Smola A.J. and Williamson, R.C. (2001). Estimating the support of a high-dimensional distribution. Neural Computation, 13, 1443-1471. 4) Cristianini, N. & Shawe-Taylor, J. (2000). An Introduction to Support Vector Machines and other kernel-based learning methods. Cambridge University Press.", // Bibliography.
@@ -251,6 +315,246 @@ algorithmMetadata()
 }
 
 
+/****************************************************************/
+/************************* Helper functions *********************/
+
+/*
+ * Integer power (same as in libsvm).
+ */
+static inline double
+svmPowi( double base, int times )
+{
+  double tmp = base, ret = 1.0;
+
+  for ( int t = times; t > 0; t /= 2 ) {
+
+    if ( t % 2 == 1 ) {
+
+      ret *= tmp;
+    }
+
+    tmp = tmp * tmp;
+  }
+
+  return ret;
+}
+
+/*
+ * Pairwise coupling of two classes, following exactly the same steps
+ * of multiclass_probability in libsvm so that results do not change.
+ * @param r01 Probability of the first class given by Platt scaling.
+ * @param p Array with 2 positions to receive the class probabilities.
+ */
+static void
+svmCoupleProbabilities( double r01, double *p )
+{
+  const int k = 2;
+  const int max_iter = 100;
+  const double eps = 0.005/k;
+
+  double r[k][k];
+  r[0][1] = r01;
+  r[1][0] = 1 - r01;
+
+  double Q[k][k];
+  double Qp[k];
+  double pQp;
+  int t, j;
+
+  for ( t = 0; t < k; t++ ) {
+
+    p[t] = 1.0/k;
+    Q[t][t] = 0;
+
+    for ( j = 0; j < t; j++ ) {
+
+      Q[t][t] += r[j][t]*r[j][t];
+      Q[t][j] = Q[j][t];
+    }
+
+    for ( j = t+1; j < k; j++ ) {
+
+      Q[t][t] += r[j][t]*r[j][t];
+      Q[t][j] = -r[j][t]*r[t][j];
+    }
+  }
+
+  for ( int iter = 0; iter < max_iter; iter++ ) {
+
+    pQp = 0;
+
+    for ( t = 0; t < k; t++ ) {
+
+      Qp[t] = 0;
+
+      for ( j = 0; j < k; j++ ) {
+
+        Qp[t] += Q[t][j]*p[j];
+      }
+
+      pQp += p[t]*Qp[t];
+    }
+
+    double max_error = 0;
+
+    for ( t = 0; t < k; t++ ) {
+
+      double error = fabs( Qp[t] - pQp );
+
+      if ( error > max_error ) {
+
+        max_error = error;
+      }
+    }
+
+    if ( max_error < eps ) {
+
+      break;
+    }
+
+    for ( t = 0; t < k; t++ ) {
+
+      double diff = ( -Qp[t] + pQp )/Q[t][t];
+      p[t] += diff;
+      pQp = ( pQp + diff*( diff*Q[t][t] + 2*Qp[t] ) )/( 1 + diff )/( 1 + diff );
+
+      for ( j = 0; j < k; j++ ) {
+
+        Qp[j] = ( Qp[j] + diff*Q[t][j] )/( 1 + diff );
+        p[j] /= ( 1 + diff );
+      }
+    }
+  }
+}
+
+
+/*
+ * Parse a list of numbers separated by commas, semicolons or spaces.
+ * @return false if the list contains something that is not a number.
+ */
+static bool
+svmParseGrid( const std::string& str, std::vector<double>& values )
+{
+  values.clear();
+
+  const char *p = str.c_str();
+
+  while ( *p ) {
+
+    if ( *p == ',' || *p == ';' || *p == ' ' || *p == '\t' ) {
+
+      ++p;
+      continue;
+    }
+
+    char *end;
+
+    double value = strtod( p, &end );
+
+    if ( end == p ) {
+
+      return false;
+    }
+
+    values.push_back( value );
+
+    p = end;
+  }
+
+  return true;
+}
+
+
+/****************************************************************/
+/*********************** Cross-validation Task ******************/
+
+/*
+ * Trains a model with all folds except one and counts the correct
+ * predictions of the remaining fold. The problem is only read, so
+ * tasks of all folds and grid points can run at the same time.
+ */
+class SvmFoldTask : public ThreadPoolTask {
+
+public:
+
+  SvmFoldTask( const svm_problem *problem, const std::vector<int> *folds, int test_fold, const svm_parameter& param ) :
+    ThreadPoolTask(),
+    problem( problem ),
+    folds( folds ),
+    test_fold( test_fold ),
+    param( param ),
+    correct( 0 ),
+    total( 0 ),
+    feasible( false )
+  {}
+
+  void run( int )
+  {
+    // Training points share the nodes of the original problem
+    std::vector<double> y;
+    std::vector<svm_node*> x;
+
+    for ( int i = 0; i < problem->l; ++i ) {
+
+      if ( (*folds)[i] != test_fold ) {
+
+        y.push_back( problem->y[i] );
+        x.push_back( problem->x[i] );
+      }
+    }
+
+    if ( y.empty() ) {
+
+      return;
+    }
+
+    svm_problem training;
+    training.l = (int)y.size();
+    training.y = &y[0];
+    training.x = &x[0];
+
+    // Some values of nu may not be feasible
+    if ( svm_check_parameter( &training, &param ) ) {
+
+      return;
+    }
+
+    svm_model *model = svm_train( &training, &param );
+
+    for ( int i = 0; i < problem->l; ++i ) {
+
+      if ( (*folds)[i] == test_fold ) {
+
+        if ( svm_predict( model, problem->x[i] ) == problem->y[i] ) {
+
+          ++correct;
+        }
+
+        ++total;
+      }
+    }
+
+    svm_destroy_model( model );
+
+    feasible = true;
+  }
+
+  const svm_problem *problem;
+
+  const std::vector<int> *folds; // Fold of each point.
+
+  int test_fold;
+
+  svm_parameter param;
+
+  int correct;
+
+  int total;
+
+  bool feasible;
+};
+
+
 /*********************************************/
 /************** SVM algorithm ****************/
 
@@ -262,7 +566,15 @@ SvmAlgorithm::SvmAlgorithm() :
   _done( false ),
   _num_layers( 0 ),
   _svm_model( 0 ),
-  _presence_index( -1 )
+  _presence_index( -1 ),
+  _compiled( false ),
+  _num_sv( 0 ),
+  _sv(),
+  _sv_coef(),
+  _weights(),
+  _rho( 0.0 ),
+  _prob_a( 0.0 ),
+  _prob_b( 0.0 )
 {
   _normalizerPtr = new MeanVarianceNormalizer();
 
@@ -579,6 +891,210 @@ SvmAlgorithm::initialize()
     return 0;
   }
 
+  // Grid search (optional parameters)
+  int folds = 0;
+
+  if ( getParameter( FOLDS_ID, &folds ) && folds > 1 ) {
+
+    if ( _svm_parameter.svm_type == 2 ) {
+
+      Log::instance()->warn( SVM_LOG_PREFIX "Grid search is not available for one-class SVM. Ignoring parameter.\n" );
+      return 1;
+    }
+
+    std::vector<double> grids[3];
+    const char *grid_ids[3] = { CGRID_ID, GAMMAGRID_ID, NUGRID_ID };
+
+    for ( int g = 0; g < 3; ++g ) {
+
+      std::string grid_str;
+
+      if ( getParameter( grid_ids[g], &grid_str ) && ! svmParseGrid( grid_str, grids[g] ) ) {
+
+        Log::instance()->error( SVM_LOG_PREFIX "Parameter '%s' not set properly. It must be a list of numbers separated by commas.\n", grid_ids[g] );
+        return 0;
+      }
+    }
+
+    return _gridSearch( folds, grids[0], grids[1], grids[2] );
+  }
+
+  return 1;
+}
+
+/*******************/
+/*** grid Search ***/
+int
+SvmAlgorithm::_gridSearch( int folds, std::vector<double> c_grid, std::vector<double> gamma_grid, std::vector<double> nu_grid )
+{
+  // Parameters that are not used by the SVM type or kernel are not searched
+  if ( c_grid.empty() || _svm_parameter.svm_type != C_SVC ) {
+
+    c_grid.assign( 1, _svm_parameter.C );
+  }
+
+  if ( gamma_grid.empty() || _svm_parameter.kernel_type == LINEAR ) {
+
+    gamma_grid.assign( 1, _svm_parameter.gamma );
+  }
+
+  if ( nu_grid.empty() || _svm_parameter.svm_type != NU_SVC ) {
+
+    nu_grid.assign( 1, _svm_parameter.nu );
+  }
+
+  for ( unsigned int i = 0; i < gamma_grid.size(); ++i ) {
+
+    if ( gamma_grid[i] == 0 ) {
+
+      gamma_grid[i] = 1.0/_num_layers;
+    }
+  }
+
+  int num_points = _svm_problem.l;
+
+  if ( folds > num_points ) {
+
+    folds = num_points;
+  }
+
+  // Stratified folds: points of each class are shuffled and dealt
+  // to the folds in turn.
+  std::vector<int> point_folds( num_points, 0 );
+
+  Random rnd;
+
+  int next_fold = 0;
+
+  for ( int c = 0; c < 2; ++c ) {
+
+    double label = ( c == 0 ) ? -1 : +1;
+
+    std::vector<int> indices;
+
+    for ( int i = 0; i < num_points; ++i ) {
+
+      if ( _svm_problem.y[i] == label ) {
+
+        indices.push_back( i );
+      }
+    }
+
+    for ( int i = (int)indices.size() - 1; i > 0; --i ) {
+
+      std::swap( indices[i], indices[rnd.get( 0, i + 1 )] );
+    }
+
+    for ( unsigned int i = 0; i < indices.size(); ++i ) {
+
+      point_folds[indices[i]] = next_fold;
+      next_fold = ( next_fold + 1 ) % folds;
+    }
+  }
+
+  // One task for each fold of each grid point. Probabilities are not
+  // needed to measure accuracy.
+  svm_parameter param = _svm_parameter;
+  param.probability = 0;
+
+  std::vector<SvmFoldTask*> tasks;
+
+  for ( unsigned int ci = 0; ci < c_grid.size(); ++ci ) {
+
+    for ( unsigned int gi = 0; gi < gamma_grid.size(); ++gi ) {
+
+      for ( unsigned int ni = 0; ni < nu_grid.size(); ++ni ) {
+
+        param.C = c_grid[ci];
+        param.gamma = gamma_grid[gi];
+        param.nu = nu_grid[ni];
+
+        for ( int f = 0; f < folds; ++f ) {
+
+          tasks.push_back( new SvmFoldTask( &_svm_problem, &point_folds, f, param ) );
+        }
+      }
+    }
+  }
+
+  Log::instance()->info( SVM_LOG_PREFIX "Grid search with %d parameter combinations and %d folds.\n", (int)tasks.size()/folds, folds );
+
+  int num_threads = getNumThreads();
+
+  if ( num_threads < 1 ) {
+
+    num_threads = ThreadPool::numProcessors();
+  }
+
+  if ( num_threads > 1 && tasks.size() > 1 ) {
+
+    ThreadPool pool( num_threads );
+
+    for ( unsigned int t = 0; t < tasks.size(); ++t ) {
+
+      pool.submit( tasks[t] );
+    }
+
+    pool.waitAll();
+  }
+  else {
+
+    for ( unsigned int t = 0; t < tasks.size(); ++t ) {
+
+      tasks[t]->run( 0 );
+    }
+  }
+
+  // Choose the most accurate grid point (the first one in case of ties)
+  double best_accuracy = -1.0;
+
+  for ( unsigned int t = 0; t < tasks.size(); t += folds ) {
+
+    int correct = 0;
+    int total = 0;
+    bool feasible = true;
+
+    for ( int f = 0; f < folds; ++f ) {
+
+      correct += tasks[t+f]->correct;
+      total += tasks[t+f]->total;
+      feasible = feasible && tasks[t+f]->feasible;
+    }
+
+    const svm_parameter& p = tasks[t]->param;
+
+    if ( ! feasible || total == 0 ) {
+
+      Log::instance()->debug( SVM_LOG_PREFIX "C=%g gamma=%g nu=%g: not feasible\n", p.C, p.gamma, p.nu );
+      continue;
+    }
+
+    double accuracy = (double)correct / (double)total;
+
+    Log::instance()->debug( SVM_LOG_PREFIX "C=%g gamma=%g nu=%g: accuracy %.4f\n", p.C, p.gamma, p.nu, accuracy );
+
+    if ( accuracy > best_accuracy ) {
+
+      best_accuracy = accuracy;
+      _svm_parameter.C = p.C;
+      _svm_parameter.gamma = p.gamma;
+      _svm_parameter.nu = p.nu;
+    }
+  }
+
+  for ( unsigned int t = 0; t < tasks.size(); ++t ) {
+
+    delete tasks[t];
+  }
+
+  if ( best_accuracy < 0.0 ) {
+
+    Log::instance()->error( SVM_LOG_PREFIX "No parameter combination of the grid could be evaluated.\n" );
+    return 0;
+  }
+
+  Log::instance()->info( SVM_LOG_PREFIX "Chosen parameters: C=%g gamma=%g nu=%g (cross-validation accuracy %.4f)\n", _svm_parameter.C, _svm_parameter.gamma, _svm_parameter.nu, best_accuracy );
+
   return 1;
 }
 
@@ -604,6 +1120,11 @@ SvmAlgorithm::iterate()
 
   delete labels;
 
+  // Weights of a previous model must be calculated again
+  _weights.clear();
+
+  _compile( false );
+
   _done = true;
 
   // debug
@@ -626,6 +1147,16 @@ SvmAlgorithm::done() const
 Scalar
 SvmAlgorithm::getValue( const Sample& x ) const
 {
+  if ( _compiled ) {
+
+    // A single point is read in place (no allocation)
+    double dec;
+
+    _decisionValues( x.begin(), 1, (int)x.size(), &dec );
+
+    return _output( dec );
+  }
+
   svm_node * node = new svm_node[_num_layers+1];
 
   _getNode( node, x );
@@ -658,6 +1189,26 @@ SvmAlgorithm::getValue( const Sample& x ) const
   return prob;
 }
 
+/******************/
+/*** get Values ***/
+void
+SvmAlgorithm::getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const
+{
+  if ( ! _compiled ) {
+
+    AlgorithmImpl::getValues( samples, numSamples, dim, numCategorical, values );
+    return;
+  }
+
+  // Decision values are stored in the output array and then converted
+  _decisionValues( samples, numSamples, dim, values );
+
+  for ( int i = 0; i < numSamples; ++i ) {
+
+    values[i] = _output( values[i] );
+  }
+}
+
 /***********************/
 /*** get Convergence ***/
 int
@@ -682,6 +1233,277 @@ SvmAlgorithm::_getNode( svm_node * node, const Sample& sample ) const
   node[_num_layers].value = 0;  // end of array
 }
 
+/***************/
+/*** compile ***/
+void
+SvmAlgorithm::_compile( bool storedWeights )
+{
+  _compiled = false;
+
+  if ( ! _svm_model ) {
+
+    return;
+  }
+
+  int kernel = _svm_parameter.kernel_type;
+
+  if ( kernel != LINEAR && kernel != POLY && kernel != RBF && kernel != SIGMOID ) {
+
+    Log::instance()->warn( SVM_LOG_PREFIX "Kernel type %d will be evaluated by libsvm.\n", kernel );
+    return;
+  }
+
+  _num_sv = _svm_model->l;
+
+  if ( kernel == LINEAR ) {
+
+    // Linear models only need the weighted sum of support vectors
+    // (unless it was already loaded with the model)
+    _sv.clear();
+    _sv_coef.clear();
+
+    if ( ! storedWeights || (int)_weights.size() != _num_layers ) {
+
+      _weights.assign( _num_layers, 0.0 );
+
+      for ( int i = 0; i < _num_sv; ++i ) {
+
+        double coef = _svm_model->sv_coef[0][i];
+
+        const svm_node *p = _svm_model->SV[i];
+
+        for ( ; p->index != -1; ++p ) {
+
+          if ( p->index >= 1 && p->index <= _num_layers ) {
+
+            _weights[p->index - 1] += coef*p->value;
+          }
+        }
+      }
+    }
+  }
+  else {
+
+    _weights.clear();
+
+    // Nodes that are missing in sparse vectors are zeros
+    _sv.assign( _num_sv * _num_layers, 0.0 );
+    _sv_coef.resize( _num_sv );
+
+    for ( int i = 0; i < _num_sv; ++i ) {
+
+      _sv_coef[i] = _svm_model->sv_coef[0][i];
+
+      const svm_node *p = _svm_model->SV[i];
+
+      for ( ; p->index != -1; ++p ) {
+
+        if ( p->index >= 1 && p->index <= _num_layers ) {
+
+          _sv[i*_num_layers + p->index - 1] = p->value;
+        }
+      }
+    }
+  }
+
+  _rho = _svm_model->rho[0];
+
+  if ( _svm_model->probA && _svm_model->probB ) {
+
+    _prob_a = _svm_model->probA[0];
+    _prob_b = _svm_model->probB[0];
+  }
+
+  _compiled = true;
+}
+
+/***********************/
+/*** decision Values ***/
+void
+SvmAlgorithm::_decisionValues( const Scalar *samples, int numSamples, int dim, double *dec ) const
+{
+  // Points are transposed in blocks, so that the innermost loops run
+  // over contiguous values of many points (allowing the compiler to
+  // vectorize them), while the terms of each point are still added in
+  // the same order used by libsvm. A single point is read in place.
+  std::vector<double> block;
+
+  int stride = 1;
+
+  if ( numSamples > 1 ) {
+
+    block.resize( SVM_BLOCK_SIZE * _num_layers );
+    stride = SVM_BLOCK_SIZE;
+  }
+
+  double kvalue[SVM_BLOCK_SIZE];
+
+  int kernel = _svm_parameter.kernel_type;
+  double gamma = _svm_parameter.gamma;
+  double coef0 = _svm_parameter.coef0;
+  int degree = _svm_parameter.degree;
+
+  for ( int first = 0; first < numSamples; first += SVM_BLOCK_SIZE ) {
+
+    int n = ( numSamples - first < SVM_BLOCK_SIZE ) ? numSamples - first : SVM_BLOCK_SIZE;
+
+    const Scalar *x = samples + first*dim;
+
+    const double *cols = x;
+
+    if ( stride > 1 ) {
+
+      for ( int i = 0; i < n; ++i ) {
+
+        for ( int j = 0; j < _num_layers; ++j ) {
+
+          block[j*stride + i] = x[i*dim + j];
+        }
+      }
+
+      cols = &block[0];
+    }
+
+    double *d = dec + first;
+
+    for ( int i = 0; i < n; ++i ) {
+
+      d[i] = 0.0;
+    }
+
+    if ( ! _weights.empty() ) {
+
+      // Linear model: a single dot product per point
+      for ( int j = 0; j < _num_layers; ++j ) {
+
+        const double *col = cols + j*stride;
+        double w = _weights[j];
+
+        for ( int i = 0; i < n; ++i ) {
+
+          d[i] += col[i]*w;
+        }
+      }
+
+      for ( int i = 0; i < n; ++i ) {
+
+        d[i] -= _rho;
+      }
+
+      continue;
+    }
+
+    for ( int s = 0; s < _num_sv; ++s ) {
+
+      const double *sv = &_sv[s*_num_layers];
+
+      for ( int i = 0; i < n; ++i ) {
+
+        kvalue[i] = 0.0;
+      }
+
+      if ( kernel == RBF ) {
+
+        for ( int j = 0; j < _num_layers; ++j ) {
+
+          const double *col = cols + j*stride;
+          double v = sv[j];
+
+          for ( int i = 0; i < n; ++i ) {
+
+            double diff = col[i] - v;
+            kvalue[i] += diff*diff;
+          }
+        }
+
+        for ( int i = 0; i < n; ++i ) {
+
+          kvalue[i] = exp( -gamma*kvalue[i] );
+        }
+      }
+      else {
+
+        for ( int j = 0; j < _num_layers; ++j ) {
+
+          const double *col = cols + j*stride;
+          double v = sv[j];
+
+          for ( int i = 0; i < n; ++i ) {
+
+            kvalue[i] += col[i]*v;
+          }
+        }
+
+        if ( kernel == POLY ) {
+
+          for ( int i = 0; i < n; ++i ) {
+
+            kvalue[i] = svmPowi( gamma*kvalue[i] + coef0, degree );
+          }
+        }
+        else if ( kernel == SIGMOID ) {
+
+          for ( int i = 0; i < n; ++i ) {
+
+            kvalue[i] = tanh( gamma*kvalue[i] + coef0 );
+          }
+        }
+      }
+
+      double coef = _sv_coef[s];
+
+      for ( int i = 0; i < n; ++i ) {
+
+        d[i] += coef*kvalue[i];
+      }
+    }
+
+    for ( int i = 0; i < n; ++i ) {
+
+      d[i] -= _rho;
+    }
+  }
+}
+
+/**************/
+/*** output ***/
+Scalar
+SvmAlgorithm::_output( double dec ) const
+{
+  if ( _svm_parameter.svm_type == ONE_CLASS ) {
+
+    return ( dec > 0 ) ? 1 : 0;
+  }
+
+  if ( _svm_parameter.probability == 1 ) {
+
+    // Platt scaling (same as sigmoid_predict in libsvm)
+    double fApB = dec*_prob_a + _prob_b;
+
+    double r01 = ( fApB >= 0 ) ? exp( -fApB )/( 1.0 + exp( -fApB ) ) : 1.0/( 1 + exp( fApB ) );
+
+    const double min_prob = 1e-7;
+
+    if ( r01 < min_prob ) {
+
+      r01 = min_prob;
+    }
+    else if ( r01 > 1 - min_prob ) {
+
+      r01 = 1 - min_prob;
+    }
+
+    double estimates[2];
+
+    svmCoupleProbabilities( r01, estimates );
+
+    return estimates[_presence_index];
+  }
+
+  // Binary output: positive decision values mean the first label
+  return ( ( dec > 0 ) == ( _presence_index == 0 ) ) ? 1 : 0;
+}
+
 /****************************************************************/
 /****************** configuration *******************************/
 void
@@ -714,6 +1536,12 @@ SvmAlgorithm::_getConfiguration( ConfigurationPtr& config ) const
       model_config->addNameValue( "NrSv", _svm_model->nSV, 2 );
   }
 
+  if ( ! _weights.empty() ) {
+
+      // Support vectors are still serialized for compatibility
+      model_config->addNameValue( "Weights", &_weights[0], _num_layers );
+  }
+
   ConfigurationPtr vectors_config( new ConfigurationImpl("Vectors") );
   model_config->addSubsection( vectors_config );
 
@@ -879,5 +1707,22 @@ SvmAlgorithm::_setConfiguration( const ConstConfigurationPtr& config )
 
   _svm_model->free_sv = 1;
 
+  // Weights of linear models (not available in older models)
+  _weights.clear();
+
+  if ( _svm_parameter.kernel_type == LINEAR ) {
+
+    try {
+
+      _weights = model_config->getAttributeAsVecDouble( "Weights" );
+    }
+    catch ( AttributeNotFound& e ) {
+
+      UNUSED( e );
+    }
+  }
+
+  _compile( true );
+
   _done = true;
 }
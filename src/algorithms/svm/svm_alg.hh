@@ -31,6 +31,8 @@
 
 #include "svm.h"
 
+#include <vector>
+
 /**************************************************/
 /************* Support Vector Machines ************/
 
@@ -51,6 +53,8 @@ public:
   int done() const;
 
   Scalar getValue( const Sample& x ) const;
+  int supportsThreadedProjection() const { return 1; }
+  void getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const;
   int getConvergence( Scalar * const val ) const;
 
 protected:
@@ -61,6 +65,30 @@ protected:
 
   void _setConfiguration( const ConstConfigurationPtr& );
 
+  /** Choose C, gamma and nu among the values of a grid by k-fold
+   *  cross-validation over the SVM problem (see initialize).
+   * @param folds Number of folds.
+   * @param c_grid Values of C (only used by C-SVC).
+   * @param gamma_grid Values of gamma (not used by linear kernels).
+   * @param nu_grid Values of nu (only used by Nu-SVC).
+   * @return 0 if no grid point could be evaluated.
+   */
+  int _gridSearch( int folds, std::vector<double> c_grid, std::vector<double> gamma_grid, std::vector<double> nu_grid );
+
+  /** Copy the support vectors of the libsvm model into a dense matrix
+   *  used to calculate predictions without allocating memory. Linear
+   *  models are collapsed into a single weight vector instead.
+   * @param storedWeights Indicates if the weights were read from a
+   *  serialized model, in which case they are not calculated again.
+   */
+  void _compile( bool storedWeights );
+
+  /** Calculate the decision values of many points (see getValues). */
+  void _decisionValues( const Scalar *samples, int numSamples, int dim, double *dec ) const;
+
+  /** Convert a decision value into the algorithm's output. */
+  Scalar _output( double dec ) const;
+
   bool _done;
 
   int _num_layers;
@@ -74,6 +102,22 @@ protected:
   // Index of presence class in SVM arrays. No need to serialize it since it is
   // detected at run time. -1 means "to be determined".
   int _presence_index;
+
+  // Dense copy of the model (see _compile). No need to serialize it.
+  bool _compiled;
+
+  int _num_sv;
+
+  std::vector<double> _sv; // Row-major matrix with _num_sv vectors of _num_layers values.
+
+  std::vector<double> _sv_coef;
+
+  std::vector<double> _weights; // Primal weights of linear models (sum of coef*vector).
+
+  double _rho;
+
+  double _prob_a; // Platt scaling parameters (probabilistic output).
+  double _prob_b;
 };
 
 
@@ -48,6 +48,7 @@ public:
   int done() const;
 
   Scalar getValue( const Sample& x ) const;
+  int supportsThreadedProjection() const { return 1; }
   int    getConvergence( Scalar * const val ) const;
 
 protected:
@@ -42,6 +42,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 class Options
 {
@@ -51,6 +52,7 @@ class Options
 				std::string longName;
 				std::string description;
 				std::string optionArgs;
+				std::vector<std::string> allArgs;
 				bool isUsed;
 				bool takesArg;
 			};
@@ -70,6 +72,7 @@ class Options
 		int cycle();
 
 		std::string getArgs(int number);
+		std::vector<std::string> getAllArgs(int number);
 			
 		void showHelp(char *progName);
 
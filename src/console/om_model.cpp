@@ -45,6 +45,7 @@ int main( int argc, char **argv ) {
   opts.addOption( "" , "log-file"    , "Log file"                                    , true );
   opts.addOption( "" , "prog-file"   , "File to store model creation progress"       , true );
   opts.addOption( "c", "config-file" , "Configuration file for openModeller"         , true );
+  opts.addOption( "" , "threads"     , "Number of threads used by algorithms that support it (0 = one per processor)", true );
 
   std::string log_level("info");
   std::string request_file;
@@ -52,6 +53,7 @@ int main( int argc, char **argv ) {
   std::string log_file;
   std::string progress_file;
   std::string config_file;
+  std::string num_threads_string;
 
   if ( ! opts.parse( argc, argv ) ) {
 
@@ -92,6 +94,9 @@ int main( int argc, char **argv ) {
       case 6:
         config_file = opts.getArgs( option );
         break;
+      case 7:
+        num_threads_string = opts.getArgs( option );
+        break;
       default:
         break;
     }
@@ -163,6 +168,11 @@ int main( int argc, char **argv ) {
     ConfigurationPtr input = Configuration::readXml( request_file.c_str() );
     om.setModelConfiguration( input );
 
+    if ( ! num_threads_string.empty() ) {
+
+      om.setNumThreads( atoi( num_threads_string.c_str() ) );
+    }
+
     om.createModel();
 
     om.calculateModelStatistics( input );
@@ -20,6 +20,9 @@
 #include <openmodeller/om.hh>
 #include <openmodeller/Log.hh>
 #include <openmodeller/os_specific.hh>
+#include <openmodeller/Projector.hh>
+#include <openmodeller/CallbackWrapper.hh>
+#include <openmodeller/Exceptions.hh>
 
 #include "getopts/getopts.h"
 
@@ -28,8 +31,10 @@
 #include <fstream>   // file I/O for XML
 #include <sstream>   // ostringstream datatype
 #include <stdio.h>   // file I/O for log
+#include <stdlib.h>  // atoi
 #include <time.h>    // used to limit the number of times that the progress is written to a file
 #include <string>    // string library
+#include <vector>
 #include <stdexcept> // try/catch
 
 #ifdef MPI_FOUND
@@ -38,6 +43,8 @@
 
 using namespace std;
 
+ConfigurationPtr projectModels( const vector<string>& model_files, const vector<string>& map_files, const string& tmpl_file, const string& format, int num_threads, CallbackWrapper *callback );
+
 int main( int argc, char **argv ) {
 
   Options opts;
@@ -46,15 +53,17 @@ int main( int argc, char **argv ) {
   // command-line parameters (short name, long name, description, take args)
   opts.addOption( "v", "version"    , "Display version info"                        , false );
   opts.addOption( "r", "xml-req"    , "Projection request file in XML"              , true );
-  opts.addOption( "o", "model"      , "File with serialized model (native projection)", true );
+  opts.addOption( "o", "model"      , "File with serialized model (native projection, can be repeated)", true );
   opts.addOption( "t", "template"   , "Raster template for the distribution map (native projection)", true );
   opts.addOption( "f", "format"     , "File format for the distribution map (native projection)", true );
-  opts.addOption( "m", "dist-map"   , "File to store the generated model"           , true );
+  opts.addOption( "m", "dist-map"   , "File to store the generated model (one for each --model)", true );
   opts.addOption( "" , "log-level"  , "Set the log level (debug, warn, info, error)", true );
   opts.addOption( "" , "log-file"   , "Log file"                                    , true );
   opts.addOption( "" , "prog-file"  , "File to store projection progress"           , true );
   opts.addOption( "" , "stat-file"  , "File to store projection statistics"         , true );
   opts.addOption( "c", "config-file", "Configuration file for openModeller"         , true );
+  opts.addOption( "" , "threads"    , "Number of threads used in the projection (0 = one per processor)", true );
+  opts.addOption( "" , "checkpoint" , "Record completed parts of the map to resume interrupted projections (single model)", false );
 
   std::string log_level("info");
   std::string request_file;
@@ -66,6 +75,8 @@ int main( int argc, char **argv ) {
   std::string progress_file;
   std::string statistics_file;
   std::string config_file;
+  std::string num_threads_string;
+  bool checkpoint = false;
 
   if ( ! opts.parse( argc, argv ) ) {
 
@@ -118,11 +129,21 @@ int main( int argc, char **argv ) {
       case 10:
         config_file = opts.getArgs( option );
         break;
+      case 11:
+        num_threads_string = opts.getArgs( option );
+        break;
+      case 12:
+        checkpoint = true;
+        break;
       default:
         break;
     }
   }
 
+  // Several models can be projected in a single pass (native projection)
+  std::vector<std::string> model_files = opts.getAllArgs( 2 );
+  std::vector<std::string> map_files = opts.getAllArgs( 5 );
+
   // Log stuff
 
   Log::Level level_code = getLogLevel( log_level );
@@ -162,6 +183,18 @@ int main( int argc, char **argv ) {
     exit(-1);
   }
 
+  if ( request_file.empty() && model_files.size() > 1 && model_files.size() != map_files.size() ) {
+
+    printf( "Please specify one distribution map for each model\n");
+    exit(-1);
+  }
+
+  if ( request_file.empty() && model_files.size() > 1 && checkpoint ) {
+
+    printf( "Checkpoints are not supported when several models are projected\n");
+    exit(-1);
+  }
+
   // Initialize progress data if user wants to track progress
   progress_data prog_data;
 
@@ -195,26 +228,79 @@ int main( int argc, char **argv ) {
     // Load algorithms and instantiate controller class
     AlgorithmFactory::searchDefaultDirs();
 
+    // Callbacks used when several models are projected
+    CallbackWrapper callback;
+
     // If user wants to track progress
     if ( ! progress_file.empty() ) { 
 
       // Set callback to write to a file
       om.setMapCallback( progressFileCallback, &prog_data );
+      callback.setModelProjectionCallback( progressFileCallback, &prog_data );
     }
     else if ( ! statistics_file.empty() ) {
 
       // Default callback will display progress on screen when a statistics file was specified
       // (which means statistics won't be sent to stdout)
       om.setMapCallback( progressDisplayCallback );
+      callback.setModelProjectionCallback( progressDisplayCallback, 0 );
     }
 
+    ConfigurationPtr stats_cfg;
+
     std::ostringstream model_output;
 
     if ( ! request_file.empty() ) {
 
       ConfigurationPtr input = Configuration::readXml( request_file.c_str() );
       om.setProjectionConfiguration( input );
-      om.createMap( map_file.c_str() );
+
+      if ( ! num_threads_string.empty() ) {
+
+        om.setNumThreads( atoi( num_threads_string.c_str() ) );
+      }
+
+      if ( checkpoint ) {
+
+        om.setCheckpoint( true );
+      }
+
+      if ( om.numProjectionEnvironments() > 1 ) {
+
+        // One map per scenario (Environment element), in the same order
+        if ( map_files.size() != (unsigned int)om.numProjectionEnvironments() ) {
+
+          printf( "Please specify one distribution map for each scenario (%d)\n", om.numProjectionEnvironments() );
+          exit(-1);
+        }
+
+        om.createMaps( map_files );
+
+        stats_cfg = ConfigurationPtr( new ConfigurationImpl( "ProjectionStatistics" ) );
+
+        for ( unsigned int i = 0; i < map_files.size(); ++i ) {
+
+          AreaStats * stats = om.getScenarioAreaStats( i );
+
+          ConfigurationPtr cfg = stats->getConfiguration();
+
+          cfg->addNameValue( "MapFile", map_files[i] );
+
+          stats_cfg->addSubsection( cfg );
+
+          delete stats;
+        }
+      }
+      else {
+
+        om.createMap( map_file.c_str() );
+      }
+    }
+    else if ( model_files.size() > 1 ) {
+
+      int num_threads = num_threads_string.empty() ? 1 : atoi( num_threads_string.c_str() );
+
+      stats_cfg = projectModels( model_files, map_files, tmpl_file, format, num_threads, &callback );
     }
     else {
 
@@ -244,12 +330,27 @@ int main( int argc, char **argv ) {
         tmpl.setFormat( format );
       }
 
+      if ( ! num_threads_string.empty() ) {
+
+        om.setNumThreads( atoi( num_threads_string.c_str() ) );
+      }
+
+      if ( checkpoint ) {
+
+        om.setCheckpoint( true );
+      }
+
       om.createMap( env, map_file.c_str(), tmpl );
     }
 
-    AreaStats * stats = om.getActualAreaStats();
+    if ( ! stats_cfg ) {
+
+      AreaStats * stats = om.getActualAreaStats();
+
+      stats_cfg = stats->getConfiguration();
 
-    ConfigurationPtr stats_cfg = stats->getConfiguration();
+      delete stats;
+    }
 
     std::ostringstream statistics_output;
 
@@ -270,8 +371,6 @@ int main( int argc, char **argv ) {
       std::cout << statistics_output.str().c_str() << endl << flush;
     }
 
-    delete stats;
-
     // If user wants to track progress
     if ( ! progress_file.empty() ) { 
 
@@ -301,3 +400,149 @@ int main( int argc, char **argv ) {
   #endif
 
 }
+
+/**********************/
+/*** project Models ***/
+// Project several serialized models onto the environment of the first one,
+// reading the environment only once. Returns the statistics of all maps.
+ConfigurationPtr projectModels( const vector<string>& model_files, const vector<string>& map_files, const string& tmpl_file, const string& format, int num_threads, CallbackWrapper *callback )
+{
+  // Each controller keeps its algorithm (and model) alive
+  vector<OpenModeller *> oms;
+  vector<Model> models;
+  vector<Map *> maps;
+  vector<AreaStats *> stats;
+
+  ConfigurationPtr stats_cfg( new ConfigurationImpl( "ProjectionStatistics" ) );
+
+  try {
+
+    for ( unsigned int i = 0; i < model_files.size(); ++i ) {
+
+      OpenModeller *om = new OpenModeller();
+
+      oms.push_back( om );
+
+      om->setModelConfiguration( Configuration::readXml( model_files[i].c_str() ) );
+
+      models.push_back( om->getModel() );
+    }
+
+    EnvironmentPtr env = oms[0]->getEnvironment();
+
+    // Environmental values are read once for all models, so all of
+    // them must use the same layers, in the same order.
+    for ( unsigned int i = 1; i < oms.size(); ++i ) {
+
+      EnvironmentPtr other = oms[i]->getEnvironment();
+
+      if ( other->numLayers() != env->numLayers() ) {
+
+        throw InvalidParameterException( "Model " + model_files[i] + " uses a different number of layers" );
+      }
+
+      for ( unsigned int j = 0; j < env->numLayers(); ++j ) {
+
+        if ( other->getLayerPath( j ) != env->getLayerPath( j ) ||
+             other->isCategorical( j ) != env->isCategorical( j ) ) {
+
+          throw InvalidParameterException( "Model " + model_files[i] + " uses different layers" );
+        }
+      }
+    }
+
+    MapFormat tmpl;
+
+    if ( tmpl_file.empty() ) {
+
+      // Use first layer as reference
+      std::string first_layer = env->getLayerPath(0);
+
+      tmpl = MapFormat( first_layer.c_str() );
+    }
+    else {
+
+      tmpl = MapFormat( tmpl_file.c_str() );
+    }
+
+    if ( ! format.empty() ) {
+
+      tmpl.setFormat( format );
+    }
+
+    Map *mask = env->getMask();
+
+    // If mask is undefined, use first layer as a mask
+    if ( ! mask ) {
+
+      mask = env->getLayer(0);
+    }
+
+    tmpl.copyDefaults( *mask );
+
+    for ( unsigned int i = 0; i < map_files.size(); ++i ) {
+
+      MapFormat map_format( tmpl );
+
+      int pos = map_files[i].length() - 4;
+
+      if ( pos > 0 && map_files[i].compare( pos, 4, ".bmp" ) == 0 ) {
+
+        map_format.setFormat( MapFormat::GreyBMP );
+      }
+
+      maps.push_back( new Map( RasterFactory::instance().create( map_files[i], map_format ) ) );
+
+      stats.push_back( new AreaStats() );
+    }
+
+    Log::instance()->info( "Projecting %u models\n", (unsigned int)models.size() );
+
+    if ( Projector::createMaps( models, env, maps, stats, callback, num_threads ) ) {
+
+      Log::instance()->info( "Finished projecting models\n" );
+    }
+
+    for ( unsigned int i = 0; i < stats.size(); ++i ) {
+
+      ConfigurationPtr cfg = stats[i]->getConfiguration();
+
+      cfg->addNameValue( "MapFile", map_files[i] );
+
+      stats_cfg->addSubsection( cfg );
+    }
+  }
+  catch ( ... ) {
+
+    models.clear();
+
+    for ( unsigned int i = 0; i < maps.size(); ++i ) {
+
+      delete maps[i];
+      delete stats[i];
+    }
+
+    for ( unsigned int i = 0; i < oms.size(); ++i ) {
+
+      delete oms[i];
+    }
+
+    throw;
+  }
+
+  for ( unsigned int i = 0; i < maps.size(); ++i ) {
+
+    delete maps[i];
+    delete stats[i];
+  }
+
+  // Models must be released before their algorithms
+  models.clear();
+
+  for ( unsigned int i = 0; i < oms.size(); ++i ) {
+
+    delete oms[i];
+  }
+
+  return stats_cfg;
+}
@@ -324,6 +324,22 @@ RequestFile::_setProjection( OpenModeller *om, FileParser &fp )
     _outputFormat.setFormat( fileType );
   }
 
+  // Number of threads
+  std::string numThreads = fp.get( "Projection threads" );
+
+  if ( ! numThreads.empty() ) {
+
+    om->setNumThreads( atoi( numThreads.c_str() ) );
+  }
+
+  // Checkpoints
+  std::string checkpoint = fp.get( "Projection checkpoint" );
+
+  if ( ! checkpoint.empty() ) {
+
+    om->setCheckpoint( atoi( checkpoint.c_str() ) != 0 );
+  }
+
   // Overwrite output extent with values from mask
   const std::string maskFile = ( _nonNativeProjection ) ? _outputMask.c_str() : _inputMask.c_str();
 
@@ -44,6 +44,8 @@
 //needed for atoi function
 #include <stdlib.h>
 
+#include <algorithm>
+
 using std::string;
 
 #undef DEBUG_MEMORY
@@ -56,7 +58,8 @@ AlgorithmImpl::AlgorithmImpl( AlgMetadata const *metadata ) :
   _samp(),
   _normalizerPtr(0),
   _param(),
-  _metadata( metadata )
+  _metadata( metadata ),
+  _numThreads( 1 )
 {
 #if defined(DEBUG_MEMORY)
   Log::instance()->debug( "AlgorithmImpl::AlgorithmImpl() at %x\n", this );
@@ -266,6 +269,8 @@ AlgorithmImpl::getFreshCopy()
 
   copy->setParameters( _param );
 
+  copy->setNumThreads( _numThreads );
+
   return copy;
 }
 
@@ -358,6 +363,22 @@ AlgorithmImpl::setNormalization( const EnvironmentPtr& env) const
     env->normalize( _normalizerPtr );
 }
 
+/******************/
+/*** get Values ***/
+void
+AlgorithmImpl::getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const
+{
+  Sample x( dim );
+  x.setCategoricalThreshold( numCategorical );
+
+  for ( int i = 0; i < numSamples; ++i, samples += dim ) {
+
+    std::copy( samples, samples + dim, x.begin() );
+
+    values[i] = getValue( x );
+  }
+}
+
 Model
 AlgorithmImpl::createModel( const SamplerPtr& samp, CallbackWrapper *callbackWrapper ) {
 
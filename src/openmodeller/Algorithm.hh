@@ -111,6 +111,21 @@ public:
    *  all algorithms support that feature. 
    */
   virtual int supportsModelProjection() const { return 1; }
+
+  /** If algorithm returns 1 then getValue and getValues can be
+   *  called from several threads at the same time once the model
+   *  is created (they do not change any member). By default models
+   *  are projected sequentially.
+   */
+  virtual int supportsThreadedProjection() const { return 0; }
+
+  /** If algorithm returns 1 then iterate only uses the points taken
+   *  from the sampler by initialize (it never reads the environmental
+   *  layers), so an instance can be trained by one thread while other
+   *  instances are initialized or trained by other threads. By default
+   *  algorithms are trained one at a time.
+   */
+  virtual int supportsConcurrentTraining() const { return 0; }
   
   /*
    * Training Methods
@@ -121,6 +136,17 @@ public:
    *  the algorithm initialization or iteration.
    */
   void setSampler( const SamplerPtr& samp );
+
+  /** Sets the number of threads that can be used to create models.
+   *  Algorithms that support multi-threading must create the same
+   *  model regardless of the number of threads.
+   * @param numThreads Number of threads. 1 (default) creates the model
+   *  sequentially and 0 means one thread per processor.
+   */
+  void setNumThreads( int numThreads ) { _numThreads = numThreads; }
+
+  /** Returns the number of threads that can be used to create models. */
+  int getNumThreads() const { return _numThreads; }
   
   /** Initiate a new training.
    */
@@ -180,6 +206,22 @@ public:
    *
    */
   virtual Scalar getValue( const Sample& x ) const = 0;
+
+  /** Calculate the occurrence probability of many points at once.
+   * The default implementation calls getValue for each point.
+   * Algorithms can override it with faster implementations, but
+   * results must be the same as the ones returned by getValue.
+   *
+   * @param samples Row-major block with numSamples rows of dim
+   *  environmental values each.
+   * @param numSamples Number of points.
+   * @param dim Number of environmental values of each point.
+   * @param numCategorical Number of categorical values at the beginning
+   *  of each point (see Sample::setCategoricalThreshold).
+   * @param values Array with numSamples positions to receive the
+   *  occurrence probabilities.
+   */
+  virtual void getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const;
   
   /*
    * Extract the Model from the Algorithm
@@ -252,6 +294,8 @@ private:
 
   AlgMetadata const *_metadata;
 
+  int _numThreads;
+
 private:
   
   typedef ParamSetType::value_type ParamSetValueType;
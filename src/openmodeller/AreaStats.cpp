@@ -71,6 +71,15 @@ void AreaStats::addNonPrediction()
 }
 
 
+void AreaStats::merge(const AreaStats *areaStats)
+{
+  _areaTotal += areaStats->getTotalArea();
+  _areaPredPresent += areaStats->getAreaPredictedPresent();
+  _areaPredAbsent += areaStats->getAreaPredictedAbsent();
+  _areaNotPredicted += areaStats->getAreaNotPredicted();
+}
+
+
 ConfigurationPtr 
 AreaStats::getConfiguration() const
 {
@@ -75,6 +75,13 @@ public:
    * Count a cell where the prediction doesn't apply.
    */
   void addNonPrediction();
+
+  /** 
+   * Add the counters of another object, such as the partial 
+   * statistics collected for a region of the same map.
+   * @param areaStats Pointer to the AreaStats object to be added.
+   */
+  void merge(const AreaStats *areaStats);
   
   /** 
    * Returns total number of cells counted.
@@ -33,10 +33,13 @@
 #include <openmodeller/env_io/Map.hh>
 #include <openmodeller/env_io/RasterFactory.hh>
 #include <openmodeller/env_io/GeoTransform.hh>
+#include <openmodeller/env_io/Header.hh>
 #include <openmodeller/Random.hh>
 #include <openmodeller/Configuration.hh>
 #include <openmodeller/Occurrence.hh>
 #include <openmodeller/Exceptions.hh>
+#include <openmodeller/Settings.hh>
+#include <openmodeller/ThreadPool.hh>
 
 #if defined (HAVE_VALUES_H) && !defined(WIN32)
 #include <values.h>
@@ -45,8 +48,76 @@
 #define MAXFLOAT FLT_MAX
 #endif
 
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+
 using std::string;
 using std::vector;
+using std::pair;
+
+// Maximum difference (as a fraction of cell size) accepted when 
+// checking if the cells of two grids coincide.
+#define GRID_TOLERANCE 1e-6
+
+/*****************/
+/*** grid Offset ***/
+// Check if the cells of grid 'hdr' coincide with the cells of grid 'ref'.
+// If so, return the column and row of 'ref' corresponding to the first
+// column and row of 'hdr'.
+static bool
+gridOffset( const Header& ref, const Header& hdr, int *col_offset, int *row_offset )
+{
+  // Rotations are not supported.
+  if ( ref.gt[2] != 0.0 || ref.gt[4] != 0.0 || hdr.gt[2] != 0.0 || hdr.gt[4] != 0.0 ) {
+
+    return false;
+  }
+
+  if ( ref.gt[1] == 0.0 || ref.gt[5] == 0.0 ) {
+
+    return false;
+  }
+
+  // Cell sizes must be the same, even after accumulating along the grid.
+  int dim = ( hdr.xdim > hdr.ydim ) ? hdr.xdim : hdr.ydim;
+
+  if ( dim < 1 ) {
+
+    dim = 1;
+  }
+
+  if ( fabs( hdr.gt[1] - ref.gt[1] ) * dim > GRID_TOLERANCE * fabs( ref.gt[1] ) ||
+       fabs( hdr.gt[5] - ref.gt[5] ) * dim > GRID_TOLERANCE * fabs( ref.gt[5] ) ) {
+
+    return false;
+  }
+
+  double col = ( hdr.gt[0] - ref.gt[0] ) / ref.gt[1];
+  double row = ( hdr.gt[3] - ref.gt[3] ) / ref.gt[5];
+
+  double int_col = floor( col + 0.5 );
+  double int_row = floor( row + 0.5 );
+
+  if ( fabs( col - int_col ) > GRID_TOLERANCE || fabs( row - int_row ) > GRID_TOLERANCE ) {
+
+    return false;
+  }
+
+  if ( ! GeoTransform::compareCoordSystemStrings( ref.proj.c_str(), hdr.proj.c_str() ) ) {
+
+    return false;
+  }
+
+  *col_offset = (int)int_col;
+  *row_offset = (int)int_row;
+
+  return true;
+}
+
+// Serializes the creation of layers by clone, which can be called by
+// several threads (raster drivers are shared singletons).
+static Mutex f_cloneMutex;
 
 /****************************************************************/
 /*********************** factory methods ************************/
@@ -54,13 +125,21 @@ EnvironmentPtr createEnvironment( const std::vector<std::string>& categs,
                                   const std::vector<std::string>& maps,
                                   const std::string& mask_file )
 {
-  return EnvironmentPtr( new EnvironmentImpl( categs, maps, mask_file ) );
+  EnvironmentPtr env( new EnvironmentImpl( categs, maps, mask_file ) );
+
+  env->setup();
+
+  return env;
 }
 
 EnvironmentPtr createEnvironment( const std::vector<std::string>& categs,
                                   const std::vector<std::string>& maps )
 {
-  return EnvironmentPtr( new EnvironmentImpl( categs, maps, "" ) );
+  EnvironmentPtr env( new EnvironmentImpl( categs, maps, "" ) );
+
+  env->setup();
+
+  return env;
 }
 
 EnvironmentPtr createEnvironment( const ConstConfigurationPtr& config )
@@ -69,6 +148,8 @@ EnvironmentPtr createEnvironment( const ConstConfigurationPtr& config )
 
   env->setConfiguration( config );
 
+  env->setup();
+
   return env;
 }
 
@@ -176,13 +257,42 @@ EnvironmentImpl::EnvironmentImpl() :
   _ymin(0),
   _xmax(0),
   _ymax(0),
-  _normalizerPtr(0)
+  _normalizerPtr(0),
+  _aligned(false),
+  _alignedDefaultCS(false),
+  _offsets(),
+  _maskOffset(0,0),
+  _cube(),
+  _cubeValid(),
+  _cubeXdim(0),
+  _cubeYdim(0),
+  _validIndexed(false),
+  _validRowRuns(),
+  _validRuns(),
+  _validRunCells(),
+  _numValidCells(0)
 {
 }
 
 EnvironmentImpl::EnvironmentImpl( const std::vector<std::string>& categs,
 				  const std::vector<std::string>& maps, 
-				  const std::string& mask )
+				  const std::string& mask ) :
+  _layers(),
+  _mask(),
+  _normalizerPtr(0),
+  _aligned(false),
+  _alignedDefaultCS(false),
+  _offsets(),
+  _maskOffset(0,0),
+  _cube(),
+  _cubeValid(),
+  _cubeXdim(0),
+  _cubeYdim(0),
+  _validIndexed(false),
+  _validRowRuns(),
+  _validRuns(),
+  _validRunCells(),
+  _numValidCells(0)
 {
   initialize( categs, maps, mask );
 }
@@ -224,6 +334,8 @@ EnvironmentImpl::clone() const
   std::vector<std::string> categs;
   std::vector<std::string> maps;
 
+  ScopedLock lock( f_cloneMutex );
+
   layers::const_iterator lay = _layers.begin();
   layers::const_iterator end = _layers.end();
 
@@ -599,7 +711,11 @@ EnvironmentImpl::normalize( Normalizer * normalizerPtr ) {
 
   if ( normalizerPtr ) {
 
+    Normalizer *previous = _normalizerPtr;
+
     _normalizerPtr = normalizerPtr->getCopy();
+
+    delete previous;
   }
   else {
 
@@ -626,6 +742,19 @@ EnvironmentImpl::resetNormalization() {
 void
 EnvironmentImpl::getUnnormalizedInternal( Sample *sample, Coord x, Coord y ) const
 {
+  // When the grid is aligned and uses the default coordinate system,
+  // find the cell only once instead of once for each layer.
+  if ( _alignedDefaultCS ) {
+
+    const Header& hdr = _layers[0].second->getHeader();
+
+    int col = (int)floor( (x - hdr.gt[0]) / hdr.gt[1] );
+    int row = (int)floor( (y - hdr.gt[3]) / hdr.gt[5] );
+
+    getCellInternal( sample, col, row );
+    return;
+  }
+
   // layers and the mask, if possible.
   if ( ! checkCoordinates( x, y ) ) {
     return;
@@ -653,6 +782,334 @@ EnvironmentImpl::getUnnormalizedInternal( Sample *sample, Coord x, Coord y ) con
   }
 }
 
+/*************************/
+/*** get Cell Internal ***/
+void
+EnvironmentImpl::getCellInternal( Sample *sample, int col, int row ) const
+{
+  if ( ! _cube.empty() ) {
+
+    const float *values = getPreloadedCell( col, row );
+
+    if ( values ) {
+
+      sample->resize( _layers.size() );
+
+      std::copy( values, values + _layers.size(), sample->begin() );
+    }
+
+    return;
+  }
+
+  if ( _mask.second ) {
+
+    Scalar val = 0;
+
+    if ( _mask.second->getCell( col + _maskOffset.first, row + _maskOffset.second, &val ) <= 0 ) {
+
+      return;
+    }
+  }
+
+  sample->resize( _layers.size() );
+
+  Sample::iterator s = sample->begin();
+
+  for ( unsigned int i = 0; i < _layers.size(); ++i, ++s ) {
+
+    if ( ! _layers[i].second->getCell( col + _offsets[i].first, row + _offsets[i].second, s ) ) {
+
+      sample->resize(0);
+      return;
+    }
+  }
+}
+
+/****************/
+/*** get Cell ***/
+Sample
+EnvironmentImpl::getCell( int col, int row ) const
+{
+  Sample sample;
+  getCellInternal( &sample, col, row );
+
+  if ( _normalizerPtr ) {
+
+    sample.setCategoricalThreshold( numCategoricalLayers() );
+
+    _normalizerPtr->normalize( &sample );
+  }
+
+  return sample;
+}
+
+/*****************************/
+/*** get Unnormalized Cell ***/
+Sample
+EnvironmentImpl::getUnnormalizedCell( int col, int row ) const
+{
+  Sample sample;
+  getCellInternal( &sample, col, row );
+  return sample;
+}
+
+/**************************/
+/*** get Preloaded Cell ***/
+const float *
+EnvironmentImpl::getPreloadedCell( int col, int row ) const
+{
+  if ( col < 0 || col >= _cubeXdim || row < 0 || row >= _cubeYdim || _cube.empty() ) {
+
+    return 0;
+  }
+
+  size_t cell = (size_t)row * _cubeXdim + col;
+
+  if ( ! _cubeValid[cell] ) {
+
+    return 0;
+  }
+
+  return &_cube[ cell * _layers.size() ];
+}
+
+/***************/
+/*** preload ***/
+bool
+EnvironmentImpl::preload( int maxMegabytes )
+{
+  if ( ! _cube.empty() ) {
+
+    return true;
+  }
+
+  if ( ! _aligned ) {
+
+    Log::instance()->warn( "Layers can only be preloaded when they are aligned\n" );
+    return false;
+  }
+
+  const Header& hdr = _layers[0].second->getHeader();
+
+  size_t ncells = (size_t)hdr.xdim * hdr.ydim;
+  size_t nvalues = ncells * _layers.size();
+  size_t bytes = nvalues * sizeof(float) + ncells;
+
+  if ( maxMegabytes > 0 && bytes > (size_t)maxMegabytes * 1024 * 1024 ) {
+
+    Log::instance()->info( "Layers need %lu MB and will not be preloaded\n", (unsigned long)(bytes / (1024 * 1024)) );
+    return false;
+  }
+
+  Log::instance()->info( "Preloading %u layers (%lu MB)\n", (unsigned int)_layers.size(), (unsigned long)(bytes / (1024 * 1024)) );
+
+  std::vector<float> cube( nvalues );
+  std::vector<unsigned char> valid( ncells, 0 );
+
+  Sample sample;
+
+  size_t cell = 0;
+
+  for ( int row = 0; row < hdr.ydim; ++row ) {
+
+    for ( int col = 0; col < hdr.xdim; ++col, ++cell ) {
+
+      sample.resize( 0 );
+
+      getCellInternal( &sample, col, row );
+
+      if ( sample.size() == 0 ) {
+
+        continue;
+      }
+
+      std::copy( sample.begin(), sample.end(), cube.begin() + cell * _layers.size() );
+
+      valid[cell] = 1;
+    }
+  }
+
+  _cube.swap( cube );
+  _cubeValid.swap( valid );
+  _cubeXdim = hdr.xdim;
+  _cubeYdim = hdr.ydim;
+
+  // Preloaded cells take all layers into account, so any index of valid
+  // cells is built again when needed.
+  _validIndexed = false;
+
+  return true;
+}
+
+/*************/
+/*** setup ***/
+void
+EnvironmentImpl::setup()
+{
+  if ( Settings::count( "PRELOAD_LAYERS" ) == 1 ) {
+
+    int megabytes = atoi( Settings::get( "PRELOAD_LAYERS" ).c_str() );
+
+    if ( megabytes > 0 ) {
+
+      preload( megabytes );
+    }
+  }
+}
+
+/**********************/
+/*** take Preloaded ***/
+void
+EnvironmentImpl::takePreloaded( EnvironmentImpl& source )
+{
+  _cube.swap( source._cube );
+  _cubeValid.swap( source._cubeValid );
+  _cubeXdim = source._cubeXdim;
+  _cubeYdim = source._cubeYdim;
+
+  _validRowRuns.swap( source._validRowRuns );
+  _validRuns.swap( source._validRuns );
+  _validRunCells.swap( source._validRunCells );
+  _numValidCells = source._numValidCells;
+  _validIndexed = source._validIndexed;
+
+  source.unload();
+  source._validIndexed = false;
+}
+
+/**************/
+/*** unload ***/
+void
+EnvironmentImpl::unload()
+{
+  std::vector<float>().swap( _cube );
+  std::vector<unsigned char>().swap( _cubeValid );
+  _cubeXdim = _cubeYdim = 0;
+}
+
+/*************************/
+/*** index Valid Cells ***/
+bool
+EnvironmentImpl::indexValidCells()
+{
+  if ( _validIndexed ) {
+
+    return true;
+  }
+
+  if ( ! _aligned ) {
+
+    return false;
+  }
+
+  const Header& hdr = _layers[0].second->getHeader();
+
+  std::vector<int> rowRuns;
+  std::vector< pair<int,int> > runs;
+  std::vector<size_t> runCells;
+  size_t numCells = 0;
+
+  rowRuns.reserve( hdr.ydim + 1 );
+
+  for ( int row = 0; row < hdr.ydim; ++row ) {
+
+    rowRuns.push_back( (int)runs.size() );
+
+    int start = -1;
+
+    for ( int col = 0; col <= hdr.xdim; ++col ) {
+
+      bool valid = false;
+
+      if ( col < hdr.xdim ) {
+
+        if ( ! _cube.empty() ) {
+
+          valid = ( _cubeValid[ (size_t)row * _cubeXdim + col ] != 0 );
+        }
+        else {
+
+          Scalar val = 0;
+
+          valid = ( ! _mask.second || _mask.second->getCell( col + _maskOffset.first, row + _maskOffset.second, &val ) > 0 ) &&
+                  _layers[0].second->getCell( col, row, &val ) > 0;
+        }
+      }
+
+      if ( valid && start < 0 ) {
+
+        start = col;
+      }
+      else if ( ! valid && start >= 0 ) {
+
+        runs.push_back( pair<int,int>( start, col ) );
+        runCells.push_back( numCells );
+        numCells += col - start;
+        start = -1;
+      }
+    }
+  }
+
+  rowRuns.push_back( (int)runs.size() );
+
+  _validRowRuns.swap( rowRuns );
+  _validRuns.swap( runs );
+  _validRunCells.swap( runCells );
+  _numValidCells = numCells;
+  _validIndexed = true;
+
+  Log::instance()->debug( "Indexed %lu valid cells of %lu in %lu runs\n", (unsigned long)numCells, (unsigned long)hdr.xdim * hdr.ydim, (unsigned long)_validRuns.size() );
+
+  return true;
+}
+
+/**********************/
+/*** get Valid Runs ***/
+int
+EnvironmentImpl::getValidRuns( int row, const std::pair<int,int> **runs ) const
+{
+  *runs = 0;
+
+  if ( ! _validIndexed || row < 0 || row + 1 >= (int)_validRowRuns.size() ) {
+
+    return 0;
+  }
+
+  int first = _validRowRuns[row];
+  int num = _validRowRuns[row+1] - first;
+
+  if ( num > 0 ) {
+
+    *runs = &_validRuns[first];
+  }
+
+  return num;
+}
+
+/***********************/
+/*** get Grid Offset ***/
+bool
+EnvironmentImpl::getGridOffset( const Header& hdr, int *col_offset, int *row_offset ) const
+{
+  if ( ! _aligned ) {
+
+    return false;
+  }
+
+  // Position of the first cell of the environment grid in the other grid
+  int col, row;
+
+  if ( ! gridOffset( hdr, _layers[0].second->getHeader(), &col, &row ) ) {
+
+    return false;
+  }
+
+  *col_offset = -col;
+  *row_offset = -row;
+
+  return true;
+}
+
 Sample
 EnvironmentImpl::getUnnormalized( Coord x, Coord y ) const
 {
@@ -702,12 +1159,40 @@ EnvironmentImpl::getRandom( Coord *xout, Coord *yout ) const
 
   int loop = 0;
 
+  // When cells are in the default coordinate system, draw them from the
+  // index of valid cells instead of drawing points from the whole region.
+  bool indexed = _validIndexed && _alignedDefaultCS && _numValidCells > 0;
+
   do {
 
-    x = myrand( _xmin, _xmax );
-    y = myrand( _ymin, _ymax );
+    if ( indexed ) {
+
+      long cell = myrand( (long)_numValidCells );
+
+      if ( cell >= (long)_numValidCells ) {
+
+        cell = (long)_numValidCells - 1;
+      }
+
+      int run = (int)( std::upper_bound( _validRunCells.begin(), _validRunCells.end(), (size_t)cell ) - _validRunCells.begin() ) - 1;
+      int row = (int)( std::upper_bound( _validRowRuns.begin(), _validRowRuns.end(), run ) - _validRowRuns.begin() ) - 1;
+      int col = _validRuns[run].first + (int)( cell - _validRunCells[run] );
+
+      // Random point inside the cell.
+      const Header& hdr = _layers[0].second->getHeader();
+
+      x = hdr.gt[0] + ( col + myrand() ) * hdr.gt[1];
+      y = hdr.gt[3] + ( row + myrand() ) * hdr.gt[5];
+
+      s = getCell( col, row );
+    }
+    else {
 
-    s = get( x, y );
+      x = myrand( _xmin, _xmax );
+      y = myrand( _ymin, _ymax );
+
+      s = get( x, y );
+    }
 
     loop++;
 
@@ -841,6 +1326,68 @@ EnvironmentImpl::calcRegion()
 #ifdef OMDEBUG
   Log::instance()->debug( "ENVIRONMENT Common region: xmin=%f, xmax=%f, ymin=%f, ymax=%f\n", _xmin, _xmax, _ymin, _ymax );
 #endif
+
+  calcAlignment();
+}
+
+
+/**********************/
+/*** calc Alignment ***/
+void
+EnvironmentImpl::calcAlignment()
+{
+  _aligned = false;
+  _alignedDefaultCS = false;
+  _offsets.clear();
+  _maskOffset = pair<int,int>( 0, 0 );
+
+  // Preloaded values and the index of valid cells are no longer valid.
+  unload();
+
+  _validIndexed = false;
+  std::vector<int>().swap( _validRowRuns );
+  std::vector< pair<int,int> >().swap( _validRuns );
+  std::vector<size_t>().swap( _validRunCells );
+  _numValidCells = 0;
+
+  if ( _layers.empty() ) {
+
+    return;
+  }
+
+  const Header& ref = _layers[0].second->getHeader();
+
+  for ( unsigned int i = 0; i < _layers.size(); ++i ) {
+
+    int col, row;
+
+    if ( ! gridOffset( _layers[i].second->getHeader(), ref, &col, &row ) ) {
+
+      _offsets.clear();
+      return;
+    }
+
+    _offsets.push_back( pair<int,int>( col, row ) );
+  }
+
+  if ( _mask.second ) {
+
+    int col, row;
+
+    if ( ! gridOffset( _mask.second->getHeader(), ref, &col, &row ) ) {
+
+      _offsets.clear();
+      return;
+    }
+
+    _maskOffset = pair<int,int>( col, row );
+  }
+
+  _aligned = true;
+
+  _alignedDefaultCS = GeoTransform::compareCoordSystemStrings( ref.proj.c_str(), GeoTransform::getDefaultCS() );
+
+  Log::instance()->debug( "Environment layers are aligned\n" );
 }
 
 
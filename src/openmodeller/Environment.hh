@@ -41,6 +41,7 @@
 #include <utility>
 
 class Map;
+class Header;
 class SampledData;
 
 class EnvironmentImpl;
@@ -127,6 +128,10 @@ public:
    */
   void resetNormalization();
 
+  /** Returns the current normalizer (0 if the environment is not normalized).
+   */
+  Normalizer * getNormalizer() const { return _normalizerPtr; }
+
   /** Read for vector 'sample' all values of environmental variables
    *  of coordinate (x,y).
    *  Returns a Sample of dim 0 if environment has a mask and point is
@@ -147,6 +152,96 @@ public:
    */
   Sample getRandom( Coord *x = 0, Coord *y = 0 ) const;
 
+  /** Returns true if all layers and the mask use the same coordinate
+   *  system and cell size, and their cells coincide (extents can be
+   *  different). In this case values are read by cell index instead 
+   *  of converting coordinates for each layer. 
+   */
+  bool isGridAligned() const { return _aligned; }
+
+  /** Check if the cells of a grid coincide with the cells of all
+   *  layers and the mask.
+   * @param hdr Header of the grid (such as the header of an output map).
+   * @param col_offset Receives the column of the environment grid 
+   *  corresponding to the first column of the grid.
+   * @param row_offset Receives the row of the environment grid 
+   *  corresponding to the first row of the grid.
+   * @return true if the grid is aligned with the environment.
+   */
+  bool getGridOffset( const Header& hdr, int *col_offset, int *row_offset ) const;
+
+  /** Same as get(), but receives a cell of the environment grid, which
+   *  is the grid of the first layer. Can only be used when the grid is 
+   *  aligned (see isGridAligned and getGridOffset).
+   */
+  Sample getCell( int col, int row ) const;
+  Sample getUnnormalizedCell( int col, int row ) const;
+
+  /** Read all layers and the mask into a single pixel-interleaved
+   *  array of single precision values covering the environment grid,
+   *  so that values can be retrieved without accessing the rasters.
+   *  Requires aligned layers (see isGridAligned). Any later change in
+   *  the layers or in the mask discards the preloaded values.
+   *  Preloading is automatically done by the createEnvironment functions
+   *  when the PRELOAD_LAYERS setting is defined.
+   * @param maxMegabytes Maximum amount of memory to be used (0 = no limit).
+   * @return true if layers were preloaded.
+   */
+  bool preload( int maxMegabytes = 0 );
+
+  /** Prepare the environment to be sampled or projected: preload the
+   *  layers when requested by the PRELOAD_LAYERS setting (maximum amount
+   *  of memory in megabytes). Called by the createEnvironment functions
+   *  that load layers.
+   */
+  void setup();
+
+  /** Take the preloaded values and the index of valid cells of another
+   *  environment with the same layers and mask, such as a clone that
+   *  was set up by another thread with its own raster handles.
+   */
+  void takePreloaded( EnvironmentImpl& source );
+
+  /** Indicates if layers were preloaded in memory. */
+  bool isPreloaded() const { return ! _cube.empty(); }
+
+  /** Release the memory used by preloaded values (see preload). */
+  void unload();
+
+  /** Returns a pointer to the numLayers() unnormalized values of a cell
+   *  of the environment grid, or 0 if the cell has no data or if the 
+   *  layers were not preloaded.
+   */
+  const float *getPreloadedCell( int col, int row ) const;
+
+  /** Build an index of the cells of the environment grid that can have
+   *  data (inside the mask and with data in the first layer), stored as
+   *  runs of consecutive cells of each row, so that projections and
+   *  random points can skip cells without data instead of sampling
+   *  them. Requires aligned layers (see isGridAligned). Any later change
+   *  in the layers or in the mask discards the index. The index is built
+   *  by the first projection that needs it, since it reads the whole
+   *  first layer; random points only use it when it is available.
+   * @return true if the index is available.
+   */
+  bool indexValidCells();
+
+  /** Indicates if the index of valid cells is available. */
+  bool hasValidCellIndex() const { return _validIndexed; }
+
+  /** Number of cells in the index of valid cells. */
+  size_t numValidCells() const { return _numValidCells; }
+
+  /** Returns the runs of valid cells of a row of the environment grid
+   *  (see indexValidCells). Each run is a pair with its first column and
+   *  the column after its last cell. Cells outside the runs have no data,
+   *  but cells inside them may still lack data in other layers.
+   * @param row Row of the environment grid.
+   * @param runs Receives a pointer to the first run of the row.
+   * @return Number of runs of the row.
+   */
+  int getValidRuns( int row, const std::pair<int,int> **runs ) const;
+
   /** Return 0 if (x,y) falls outside the mask. If there's no 
    *  mask, return != 0 always. */
   int checkCoordinates( Coord x, Coord y ) const;
@@ -191,6 +286,9 @@ private:
    */
   void getUnnormalizedInternal( Sample *, Coord x, Coord y ) const;
 
+  /* same as above, but for a cell of the environment grid */
+  void getCellInternal( Sample *, int col, int row ) const;
+
   /* utility to clear the mask information.  Deallocates memory.  Does not computeRegion() */
   void clearMask();
 
@@ -219,6 +317,9 @@ private:
   /** Calculate the widest region common to all layers. */
   void calcRegion();
 
+  /** Check if all layers and the mask are aligned (see isGridAligned). */
+  void calcAlignment();
+
   layers _layers; ///< Vector with all layers that describe the variables.
   layer _mask;   ///< Mask (can be 0).
 
@@ -228,6 +329,22 @@ private:
   Coord _ymax; ///< Intersection of all layers.
 
   Normalizer * _normalizerPtr; ///< Normalize the environment
+
+  bool _aligned; ///< Indicates if all layers and the mask are aligned.
+  bool _alignedDefaultCS; ///< Indicates if the aligned grid uses the default coordinate system.
+  std::vector< std::pair<int,int> > _offsets; ///< Column and row offsets of each layer in the grid of the first layer.
+  std::pair<int,int> _maskOffset; ///< Column and row offsets of the mask in the grid of the first layer.
+
+  std::vector<float> _cube; ///< Preloaded values (numLayers() values for each cell of the grid of the first layer).
+  std::vector<unsigned char> _cubeValid; ///< Indicates which preloaded cells have data.
+  int _cubeXdim; ///< Number of columns of the preloaded grid.
+  int _cubeYdim; ///< Number of rows of the preloaded grid.
+
+  bool _validIndexed; ///< Indicates if the index of valid cells is available.
+  std::vector<int> _validRowRuns; ///< Position in _validRuns of the first run of each row (plus one past the last row).
+  std::vector< std::pair<int,int> > _validRuns; ///< First column and end column of each run of valid cells.
+  std::vector<size_t> _validRunCells; ///< Number of valid cells before each run.
+  size_t _numValidCells; ///< Total number of valid cells.
 };
 
 
@@ -35,6 +35,8 @@
 #include <openmodeller/Environment.hh>
 #include <openmodeller/refcount.hh>
 
+#include <algorithm>
+
 class ModelImpl;
 
 typedef ReferenceCountedPointer<ModelImpl> Model;
@@ -56,12 +58,41 @@ public:
    * @param env Environment to normalize.
    */
   virtual void setNormalization( const EnvironmentPtr& env ) const = 0;
+
+  /** Indicates if getValue and getValues can be called from several
+   *  threads at the same time. Models that don't support it are
+   *  projected sequentially.
+   */
+  virtual int supportsThreadedProjection() const { return 0; }
   
   /** Compute a value in the Model
    * @param x Environment vector.
    */
   virtual Scalar getValue( const Sample& x ) const = 0;
 
+  /** Compute the values of many points in the Model.
+   * The default implementation calls getValue for each point.
+   * @param samples Row-major block with numSamples rows of dim
+   *  environmental values each.
+   * @param numSamples Number of points.
+   * @param dim Number of environmental values of each point.
+   * @param numCategorical Number of categorical values at the beginning
+   *  of each point (see Sample::setCategoricalThreshold).
+   * @param values Array with numSamples positions to receive the results.
+   */
+  virtual void getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const
+  {
+    Sample x( dim );
+    x.setCategoricalThreshold( numCategorical );
+
+    for ( int i = 0; i < numSamples; ++i, samples += dim ) {
+
+      std::copy( samples, samples + dim, x.begin() );
+
+      values[i] = getValue( x );
+    }
+  }
+
 };
 
 
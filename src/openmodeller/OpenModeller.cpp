@@ -41,6 +41,9 @@
 #include <openmodeller/Configuration.hh>
 #include <openmodeller/Model.hh>
 #include <openmodeller/CallbackWrapper.hh>
+#include <openmodeller/ProjectionJournal.hh>
+#include <openmodeller/ThreadPool.hh>
+#include <openmodeller/Settings.hh>
 
 #include <openmodeller/env_io/Map.hh>
 #include <openmodeller/env_io/RasterFactory.hh>
@@ -48,8 +51,84 @@
 #include <openmodeller/Exceptions.hh>
 
 #include <string>
+#include <sstream>
+#include <stdlib.h>
+#include <sys/stat.h>
 using std::string;
 
+// Default memory limit (in megabytes) for preloading layers when the
+// PRELOAD_LAYERS setting is not defined. createMaps only sets up the next
+// scenario in the background when the limit is positive.
+#define DEFAULT_SCENARIO_PRELOAD_SIZE 0
+
+/*****************************/
+/*** append File Signature ***/
+// Append a file name to a journal key, followed by the size and the
+// modification time of the file when it can be found on disk.
+static void
+appendFileSignature( std::ostream& key, const std::string& path )
+{
+  key << path;
+
+  struct stat status;
+
+  if ( ! path.empty() && stat( path.c_str(), &status ) == 0 ) {
+
+    key << ' ' << (unsigned long)status.st_size << ' ' << (unsigned long)status.st_mtime;
+  }
+
+  key << '\n';
+}
+
+/****************************************************************/
+/*********************** Scenario Prefetch **********************/
+
+/**
+ * Sets up the next projection scenario in the background (see
+ * EnvironmentImpl::setup). Layers of the scenario may be the same files
+ * used by the scenario being projected, so they are read through a clone
+ * created by the loader thread, whose raster handles are not shared with
+ * other threads (GDAL only shares datasets opened by the same thread).
+ */
+class ScenarioPrefetch : public ThreadPoolTask {
+
+public:
+
+  ScenarioPrefetch( const EnvironmentPtr& env ) :
+    ThreadPoolTask(),
+    _env( env.operator->() )
+  {}
+
+  void run( int )
+  {
+    // Layers that are not aligned are read cell by cell during projection.
+    if ( ! _env->isGridAligned() || _env->isPreloaded() ) {
+
+      return;
+    }
+
+    EnvironmentImpl *copy = _env->clone();
+
+    try {
+
+      copy->setup();
+      copy->indexValidCells();
+      _env->takePreloaded( *copy );
+    }
+    catch ( ... ) {
+
+      Log::instance()->warn( "Could not prefetch projection scenario\n" );
+    }
+
+    delete copy;
+  }
+
+private:
+
+  // Raw pointer: reference counting is not thread safe.
+  EnvironmentImpl *_env;
+};
+
 /*** Callback "setters" ***/
 
 void OpenModeller::setModelCallback( ModelCreationCallback func, void *param ) {
@@ -74,6 +153,8 @@ void OpenModeller::setAbortionCallback( AbortionCallback func, void *param ) {
 /*** constructors ***/
 
 OpenModeller::OpenModeller():
+  _numThreads( 1 ),
+  _checkpoint( false ),
   _confusion_matrix(),
   _roc_curve()
 {
@@ -91,6 +172,11 @@ OpenModeller::~OpenModeller()
 {
   delete _actualAreaStats;
   delete _estimatedAreaStats;
+
+  for ( unsigned int i = 0; i < _scenarioAreaStats.size(); ++i ) {
+
+    delete _scenarioAreaStats[i];
+  }
 }
 
 
@@ -249,6 +335,8 @@ OpenModeller::createModel()
     return 0;
   }
 
+  _alg->setNumThreads( _numThreads );
+
   _alg->createModel( _samp, &_callback_wrapper );
 
   // note: Leave the 2 spaces in the end of the message to cover the  
@@ -318,7 +406,41 @@ OpenModeller::createMap( const EnvironmentPtr & env, char const *output_file, Ma
   Map map( RasterFactory::instance().create( output_file, _format ) );
 #endif
 
-  bool finished = Projector::createMap( model, _projEnv, &map, _actualAreaStats, &_callback_wrapper );
+  ProjectionJournal *journal = 0;
+
+  if ( _checkpoint ) {
+
+    // Journals can only be reused with the same model and environment.
+    std::ostringstream key;
+
+    Configuration::writeXml( _alg->getConfiguration(), key );
+    Configuration::writeXml( _projEnv->getConfiguration(), key );
+
+    // Layers replaced by other files with the same names also
+    // invalidate the journal.
+    for ( unsigned int i = 0; i < _projEnv->numLayers(); ++i ) {
+
+      appendFileSignature( key, _projEnv->getLayerPath( i ) );
+    }
+
+    appendFileSignature( key, _projEnv->getMaskPath() );
+
+    journal = new ProjectionJournal( fname + ".journal", key.str() );
+  }
+
+  bool finished;
+
+  try {
+
+    finished = Projector::createMap( model, _projEnv, &map, _actualAreaStats, &_callback_wrapper, _numThreads, journal );
+  }
+  catch ( ... ) {
+
+    delete journal;
+    throw;
+  }
+
+  delete journal;
 
   if ( ! finished ) {
 
@@ -337,6 +459,146 @@ OpenModeller::createMap( const EnvironmentPtr & env, char const *output_file )
   return createMap( env, output_file, _format );
 }
 
+/*******************/
+/*** create Maps ***/
+int
+OpenModeller::createMaps( const std::vector<EnvironmentPtr>& envs, const std::vector<std::string>& output_files, MapFormat& format )
+{
+  for ( unsigned int i = 0; i < _scenarioAreaStats.size(); ++i ) {
+
+    delete _scenarioAreaStats[i];
+  }
+
+  _scenarioAreaStats.clear();
+
+  if ( envs.size() != output_files.size() ) {
+
+    Log::instance()->error( "Number of output maps (%u) differs from the number of scenarios (%u)\n", (unsigned int)output_files.size(), (unsigned int)envs.size() );
+    return 0;
+  }
+
+  for ( unsigned int k = 0; k < envs.size(); ++k ) {
+
+    if ( ! envs[k] ) {
+
+      Log::instance()->error( "Projection environment of scenario %u not specified\n", k + 1 );
+      return 0;
+    }
+  }
+
+  int maxMegabytes = DEFAULT_SCENARIO_PRELOAD_SIZE;
+
+  if ( Settings::count( "PRELOAD_LAYERS" ) == 1 ) {
+
+    maxMegabytes = atoi( Settings::get( "PRELOAD_LAYERS" ).c_str() );
+  }
+
+  std::vector<ScenarioPrefetch *> prefetch;
+
+  ThreadPool *loader = 0;
+
+  if ( maxMegabytes > 0 && envs.size() > 1 ) {
+
+    loader = new ThreadPool( 1 );
+
+    for ( unsigned int k = 0; k < envs.size(); ++k ) {
+
+      prefetch.push_back( new ScenarioPrefetch( envs[k] ) );
+    }
+
+    loader->submit( prefetch[0] );
+  }
+
+  int created = 0;
+
+  for ( unsigned int k = 0; k < envs.size(); ++k ) {
+
+    Log::instance()->info( "Projecting scenario %u of %u\n", k + 1, (unsigned int)envs.size() );
+
+    if ( loader ) {
+
+      // The loader must not touch the scenario that is being projected.
+      loader->waitFor( prefetch[k] );
+
+      if ( k + 1 < envs.size() ) {
+
+        loader->submit( prefetch[k+1] );
+      }
+    }
+    else {
+
+      // Same setup done when a single environment is created.
+      envs[k]->setup();
+    }
+
+    int ok = 0;
+
+    try {
+
+      ok = createMap( envs[k], output_files[k].c_str(), format );
+    }
+    catch ( ... ) {
+
+      if ( loader ) {
+
+        delete loader; // cancels pending preloads and waits for the running one
+
+        for ( unsigned int i = 0; i < prefetch.size(); ++i ) {
+
+          delete prefetch[i];
+        }
+      }
+
+      throw;
+    }
+
+    if ( ok ) {
+
+      ++created;
+    }
+
+    _scenarioAreaStats.push_back( new AreaStats( _actualAreaStats ) );
+
+    // Values of this scenario are no longer needed.
+    envs[k]->unload();
+  }
+
+  if ( loader ) {
+
+    delete loader;
+
+    for ( unsigned int i = 0; i < prefetch.size(); ++i ) {
+
+      delete prefetch[i];
+    }
+  }
+
+  return created;
+}
+
+/*******************/
+/*** create Maps ***/
+int
+OpenModeller::createMaps( const std::vector<std::string>& output_files )
+{
+  if ( _projEnvs.empty() ) {
+
+    if ( ! _projEnv ) {
+
+      _projEnv = _env;
+    }
+
+    std::vector<EnvironmentPtr> envs( 1, _projEnv );
+
+    return createMaps( envs, output_files, _format );
+  }
+
+  // Copy, since createMap replaces the current projection environment.
+  std::vector<EnvironmentPtr> envs( _projEnvs );
+
+  return createMaps( envs, output_files, _format );
+}
+
 /******************/
 /*** create Map ***/
 int
@@ -410,6 +672,20 @@ OpenModeller::getActualAreaStats()
 
 /***************************************/
 /******* get Estimated AreaStats *******/
+/******************************/
+/*** get Scenario AreaStats ***/
+AreaStats *
+OpenModeller::getScenarioAreaStats( int index )
+{
+  if ( index < 0 || index >= (int)_scenarioAreaStats.size() ) {
+
+    return 0;
+  }
+
+  return new AreaStats( _scenarioAreaStats[index] );
+}
+
+
 AreaStats * OpenModeller::getEstimatedAreaStats(double proportionAreaToSample)
 {
   return getEstimatedAreaStats( _env, proportionAreaToSample );
@@ -589,7 +865,38 @@ OpenModeller::setProjectionConfiguration( const ConstConfigurationPtr & config )
 
     _alg = AlgorithmFactory::newAlgorithm( config->getSubsection( "Algorithm" ) );
 
-    _projEnv = createEnvironment( config->getSubsection( "Environment" ) );
+    _projEnvs.clear();
+
+    // Each Environment element defines a scenario.
+    Configuration::subsection_list subs = config->getAllSubsections();
+
+    Configuration::subsection_list::const_iterator sub = subs.begin();
+
+    for ( ; sub != subs.end(); ++sub ) {
+
+      if ( (*sub)->getName() == "Environment" ) {
+
+        // Layers are preloaded by createMaps, one scenario at a time.
+        EnvironmentPtr env = createEnvironment();
+
+        env->setConfiguration( *sub );
+
+        _projEnvs.push_back( env );
+      }
+    }
+
+    if ( _projEnvs.size() > 1 ) {
+
+      Log::instance()->debug( "Projection configuration has %u scenarios\n", (unsigned int)_projEnvs.size() );
+
+      _projEnv = _projEnvs[0];
+    }
+    else {
+
+      _projEnvs.clear();
+
+      _projEnv = createEnvironment( config->getSubsection( "Environment" ) );
+    }
 
     ConstConfigurationPtr output_param_config = config->getSubsection( "OutputParameters" );
 
@@ -618,6 +925,12 @@ OpenModeller::setProjectionConfiguration( const ConstConfigurationPtr & config )
       UNUSED(e);
     }
 
+    // NumThreads attribute is optional
+    _numThreads = output_param_config->getAttributeAsInt( "NumThreads", _numThreads );
+
+    // Checkpoint attribute is optional
+    _checkpoint = output_param_config->getAttributeAsInt( "Checkpoint", _checkpoint ? 1 : 0 ) != 0;
+
     try {
 
       ConstConfigurationPtr stats_param_config = config->getSubsection( "Statistics" );
@@ -216,6 +216,29 @@ public:
    */
   void setMapCallback( ModelProjectionCallback func, void *param=0 );
 
+  /** Sets the number of threads used by the next projections and
+   *  model creations (by algorithms that support multi-threading).
+   * @param numThreads Number of threads. 1 (default) projects the
+   *  map sequentially and 0 means one thread per processor.
+   */
+  void setNumThreads( int numThreads ) { _numThreads = numThreads; }
+
+  /** Returns the number of threads used in projections and model creations. */
+  int getNumThreads() const { return _numThreads; }
+
+  /** Enable or disable projection checkpoints. When enabled, completed
+   *  bands of rows are recorded in a journal next to the output map
+   *  (same name plus ".journal"), so that an interrupted projection of
+   *  the same model and environment can be resumed. Journals are
+   *  discarded when any layer file changes (size or modification time).
+   *  The journal is removed when the projection finishes.
+   * @param checkpoint Indicates if checkpoints should be recorded.
+   */
+  void setCheckpoint( bool checkpoint ) { _checkpoint = checkpoint; }
+
+  /** Indicates if projection checkpoints are recorded. */
+  bool getCheckpoint() const { return _checkpoint; }
+
   /** Create and save distribution map to disk using the specified
    * projection environment and output format.
    * @param env Pointer to Environment object with the layers 
@@ -256,6 +279,36 @@ public:
    */
   int createMap( char const *output_file );
 
+  /** Project the current model onto several scenarios (environments),
+   * creating one map per scenario. Each scenario is set up like a single
+   * environment (see EnvironmentImpl::setup). When the PRELOAD_LAYERS
+   * setting is positive, layers of the next scenario are preloaded in
+   * the background (when they are aligned and fit in the limit) while
+   * the current one is being projected, and released as soon as its map
+   * is finished. Area statistics of each
+   * scenario are available through getScenarioAreaStats.
+   * @param envs Projection environments (scenarios).
+   * @param output_files Output file names (one per scenario).
+   * @param format Georeferenced map file which will define
+   *  cell size, extent, WKT projection, no data value, and file 
+   *  type for the output maps.
+   * @return Number of maps that were successfully created.
+   */
+  int createMaps( const std::vector<EnvironmentPtr>& envs, const std::vector<std::string>& output_files, MapFormat& format );
+
+  /** Project the current model onto the scenarios specified by the
+   * last projection configuration (see setProjectionConfiguration).
+   * Output format defaults to the configured format.
+   * @param output_files Output file names (one per scenario).
+   * @return Number of maps that were successfully created.
+   */
+  int createMaps( const std::vector<std::string>& output_files );
+
+  /** Number of projection environments (scenarios) specified by the
+   *  last projection configuration.
+   */
+  int numProjectionEnvironments() const { return (int)_projEnvs.size(); }
+
   /*****************************************************************************
    *
    * Model generation procedures
@@ -317,6 +370,15 @@ public:
    */
   AreaStats * getActualAreaStats();
 
+  /**
+   * Returns a copy of the AreaStats object of a scenario projected
+   * by the last call to createMaps, or 0 if the index is invalid.
+   * IMPORTANT: you should delete the pointer because it returns
+   * a copy of the internal object!
+   * @param index Scenario index.
+   */
+  AreaStats * getScenarioAreaStats( int index );
+
   /**
    * Returns a pointer to the model AreaStats object which 
    * contains statistics about areas on the map generated by OM.
@@ -387,10 +449,23 @@ private:
   // Environmental layers for projection
   EnvironmentPtr _projEnv;
 
+  // Environmental layers of each projection scenario (only when
+  // more than one was configured)
+  std::vector<EnvironmentPtr> _projEnvs;
+
+  // Number of threads used in projections and model creations
+  int _numThreads;
+
+  // Indicates if projection checkpoints are recorded
+  bool _checkpoint;
+
   // Model statistics: helper objects
   AreaStats * _actualAreaStats;
   AreaStats * _estimatedAreaStats;
 
+  // Statistics of each scenario projected by createMaps
+  std::vector<AreaStats *> _scenarioAreaStats;
+
   // Confusion matrix
   ConfusionMatrix _confusion_matrix;
 
@@ -0,0 +1,319 @@
+/**
+ * Definition of ProjectionJournal class.
+ *
+ * $Id$
+ *
+ * LICENSE INFORMATION
+ *
+ * Copyright(c) 2026 by CRIA -
+ * Centro de Referencia em Informacao Ambiental
+ *
+ * http://www.cria.org.br
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details:
+ *
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include <openmodeller/ProjectionJournal.hh>
+#include <openmodeller/Log.hh>
+
+#include <string.h>
+
+// Identifies journal files (and their layout version).
+static const char JOURNAL_MAGIC[8] = { 'O', 'M', 'P', 'J', 'R', 'N', 'L', '2' };
+
+// Size of the journal header in bytes.
+static const long JOURNAL_HEADER_SIZE = sizeof(JOURNAL_MAGIC) + sizeof(unsigned long long) + 3*sizeof(int) + 6*sizeof(Coord);
+
+/****************/
+/*** fnv Hash ***/
+// FNV-1a hash, used to detect incomplete records.
+static unsigned int
+fnvHash( const void *data, size_t size, unsigned int hash = 2166136261u )
+{
+  const unsigned char *p = (const unsigned char *)data;
+
+  for ( size_t i = 0; i < size; ++i ) {
+
+    hash ^= p[i];
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+/*******************/
+/*** fnv Hash 64 ***/
+// 64-bit FNV-1a hash, used to identify keys.
+static unsigned long long
+fnvHash64( const void *data, size_t size )
+{
+  const unsigned char *p = (const unsigned char *)data;
+
+  unsigned long long hash = 14695981039346656037ULL;
+
+  for ( size_t i = 0; i < size; ++i ) {
+
+    hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+/*******************/
+/*** constructor ***/
+ProjectionJournal::ProjectionJournal( const std::string& file, const std::string& key ) :
+  _file( file ),
+  _key( fnvHash64( key.data(), key.size() ) ),
+  _fp( 0 ),
+  _xdim( 0 ),
+  _ydim( 0 ),
+  _bandRows( 1 ),
+  _reading( false )
+{
+}
+
+/******************/
+/*** destructor ***/
+ProjectionJournal::~ProjectionJournal()
+{
+  if ( _fp ) {
+
+    fclose( _fp );
+  }
+}
+
+/************/
+/*** open ***/
+int
+ProjectionJournal::open( const Header& hdr, int bandRows )
+{
+  if ( _fp ) {
+
+    fclose( _fp );
+    _fp = 0;
+  }
+
+  _xdim = hdr.xdim;
+  _ydim = hdr.ydim;
+  _bandRows = ( bandRows > 0 ) ? bandRows : 1;
+  _reading = false;
+
+  int completed = 0;
+
+  _fp = fopen( _file.c_str(), "r+b" );
+
+  if ( _fp && readHeader( hdr, _bandRows ) ) {
+
+    // Count the complete records written by the previous run.
+    std::vector<Scalar> values;
+
+    _reading = true;
+
+    while ( bandCells( completed ) > 0 && readBand( completed*_bandRows, values ) ) {
+
+      ++completed;
+    }
+
+    // Completed bands will be read again by the caller.
+    if ( fseek( _fp, JOURNAL_HEADER_SIZE, SEEK_SET ) == 0 ) {
+
+      if ( completed > 0 ) {
+
+        Log::instance()->info( "Resuming projection from journal %s (%d bands completed)\n", _file.c_str(), completed );
+      }
+
+      return completed;
+    }
+  }
+
+  // Start a new journal.
+  _reading = false;
+
+  if ( _fp ) {
+
+    fclose( _fp );
+  }
+
+  _fp = fopen( _file.c_str(), "w+b" );
+
+  if ( ! _fp || ! writeHeader( hdr, _bandRows ) ) {
+
+    Log::instance()->warn( "Could not create projection journal %s\n", _file.c_str() );
+
+    if ( _fp ) {
+
+      fclose( _fp );
+      _fp = 0;
+    }
+  }
+
+  return 0;
+}
+
+/*****************/
+/*** read Band ***/
+bool
+ProjectionJournal::readBand( int firstRow, std::vector<Scalar>& values )
+{
+  if ( ! _fp || ! _reading ) {
+
+    return false;
+  }
+
+  int row = -1;
+  int ncells = -1;
+
+  if ( fread( &row, sizeof(int), 1, _fp ) != 1 || fread( &ncells, sizeof(int), 1, _fp ) != 1 ) {
+
+    return false;
+  }
+
+  if ( row != firstRow || ncells != bandCells( firstRow / _bandRows ) ) {
+
+    return false;
+  }
+
+  values.resize( ncells );
+
+  unsigned int checksum = 0;
+
+  if ( ( ncells > 0 && fread( &values[0], sizeof(Scalar), ncells, _fp ) != (size_t)ncells ) ||
+       fread( &checksum, sizeof(unsigned int), 1, _fp ) != 1 ) {
+
+    return false;
+  }
+
+  unsigned int hash = fnvHash( &row, sizeof(int) );
+
+  if ( ncells > 0 ) {
+
+    hash = fnvHash( &values[0], ncells*sizeof(Scalar), hash );
+  }
+
+  return checksum == hash;
+}
+
+/******************/
+/*** write Band ***/
+bool
+ProjectionJournal::writeBand( int firstRow, const std::vector<Scalar>& values )
+{
+  if ( ! _fp ) {
+
+    return false;
+  }
+
+  if ( _reading ) {
+
+    // Required by stdio when switching from reading to writing.
+    fseek( _fp, 0, SEEK_CUR );
+    _reading = false;
+  }
+
+  int ncells = (int)values.size();
+
+  unsigned int checksum = fnvHash( &firstRow, sizeof(int) );
+
+  if ( ncells > 0 ) {
+
+    checksum = fnvHash( &values[0], ncells*sizeof(Scalar), checksum );
+  }
+
+  bool ok = fwrite( &firstRow, sizeof(int), 1, _fp ) == 1 &&
+            fwrite( &ncells, sizeof(int), 1, _fp ) == 1 &&
+            ( ncells == 0 || fwrite( &values[0], sizeof(Scalar), ncells, _fp ) == (size_t)ncells ) &&
+            fwrite( &checksum, sizeof(unsigned int), 1, _fp ) == 1 &&
+            fflush( _fp ) == 0;
+
+  if ( ! ok ) {
+
+    Log::instance()->warn( "Could not write to projection journal %s\n", _file.c_str() );
+  }
+
+  return ok;
+}
+
+/**************/
+/*** remove ***/
+void
+ProjectionJournal::remove()
+{
+  if ( _fp ) {
+
+    fclose( _fp );
+    _fp = 0;
+  }
+
+  ::remove( _file.c_str() );
+}
+
+/*******************/
+/*** read Header ***/
+bool
+ProjectionJournal::readHeader( const Header& hdr, int bandRows )
+{
+  char magic[sizeof(JOURNAL_MAGIC)];
+  unsigned long long key = 0;
+  int dims[3];
+  Coord gt[6];
+
+  if ( fread( magic, sizeof(magic), 1, _fp ) != 1 ||
+       fread( &key, sizeof(unsigned long long), 1, _fp ) != 1 ||
+       fread( dims, sizeof(int), 3, _fp ) != 3 ||
+       fread( gt, sizeof(Coord), 6, _fp ) != 6 ) {
+
+    return false;
+  }
+
+  if ( memcmp( magic, JOURNAL_MAGIC, sizeof(magic) ) != 0 || key != _key ||
+       dims[0] != hdr.xdim || dims[1] != hdr.ydim || dims[2] != bandRows ||
+       memcmp( gt, hdr.gt, sizeof(gt) ) != 0 ) {
+
+    Log::instance()->debug( "Discarding projection journal %s (different projection)\n", _file.c_str() );
+    return false;
+  }
+
+  return true;
+}
+
+/********************/
+/*** write Header ***/
+bool
+ProjectionJournal::writeHeader( const Header& hdr, int bandRows )
+{
+  int dims[3] = { hdr.xdim, hdr.ydim, bandRows };
+
+  return fwrite( JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC), 1, _fp ) == 1 &&
+         fwrite( &_key, sizeof(unsigned long long), 1, _fp ) == 1 &&
+         fwrite( dims, sizeof(int), 3, _fp ) == 3 &&
+         fwrite( hdr.gt, sizeof(Coord), 6, _fp ) == 6 &&
+         fflush( _fp ) == 0;
+}
+
+/******************/
+/*** band Cells ***/
+int
+ProjectionJournal::bandCells( int band ) const
+{
+  int firstRow = band * _bandRows;
+
+  if ( band < 0 || firstRow >= _ydim ) {
+
+    return 0;
+  }
+
+  int numRows = ( firstRow + _bandRows > _ydim ) ? _ydim - firstRow : _bandRows;
+
+  return numRows * _xdim;
+}
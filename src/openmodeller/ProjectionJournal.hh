@@ -0,0 +1,108 @@
+/**
+ * Declaration of ProjectionJournal class.
+ *
+ * $Id$
+ *
+ * LICENSE INFORMATION
+ *
+ * Copyright(c) 2026 by CRIA -
+ * Centro de Referencia em Informacao Ambiental
+ *
+ * http://www.cria.org.br
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details:
+ *
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef _PROJECTION_JOURNAL_HH_
+#define _PROJECTION_JOURNAL_HH_
+
+#include <openmodeller/om_defs.hh>
+#include <openmodeller/env_io/Header.hh>
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/**
+ * Checkpoint file of a projection. The values of each band of rows
+ * are appended to the journal as soon as they are written to the map,
+ * so that a projection that was interrupted can be restarted without
+ * calculating the completed bands again. Since most output formats
+ * cannot be reopened for update, the map is recreated and the values
+ * of the completed bands (from which area statistics are recalculated)
+ * are copied from the journal.
+ */
+class dllexp ProjectionJournal {
+
+public:
+
+  /** Constructor.
+   * @param file Journal file name (usually next to the output map).
+   * @param key Identification of the model and environment, including
+   *  the size and modification time of the layers. Journals created
+   *  with a different key are discarded.
+   */
+  ProjectionJournal( const std::string& file, const std::string& key );
+
+  ~ProjectionJournal();
+
+  /** Open the journal for a projection split into bands.
+   * @param hdr Header of the output map.
+   * @param bandRows Number of rows of each band (the last one may be smaller).
+   * @return Number of bands completed by a previous run, which must
+   *  be read in order with readBand before new bands are written.
+   */
+  int open( const Header& hdr, int bandRows );
+
+  /** Read the values of the next completed band.
+   * @return false if the journal could not be read.
+   */
+  bool readBand( int firstRow, std::vector<Scalar>& values );
+
+  /** Append the values of a band (-1 means no data).
+   * @return false if the journal could not be written.
+   */
+  bool writeBand( int firstRow, const std::vector<Scalar>& values );
+
+  /** Close and delete the journal, usually when the projection is finished. */
+  void remove();
+
+  /** Journal file name. */
+  const std::string& getFileName() const { return _file; }
+
+private:
+
+  bool readHeader( const Header& hdr, int bandRows );
+  bool writeHeader( const Header& hdr, int bandRows );
+
+  // Number of cells of a band, or 0 if the band does not exist.
+  int bandCells( int band ) const;
+
+  std::string _file;
+
+  unsigned long long _key; // Hash of the identification key.
+
+  FILE *_fp;
+
+  int _xdim;
+  int _ydim;
+  int _bandRows;
+
+  bool _reading; // Indicates if completed bands are being read.
+
+  // Disable copying.
+  ProjectionJournal( const ProjectionJournal& );
+  ProjectionJournal& operator=( const ProjectionJournal& );
+};
+
+#endif
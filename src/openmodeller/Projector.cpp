@@ -40,10 +40,17 @@
 
 #include <openmodeller/Exceptions.hh>
 
+#ifndef MPI_FOUND
+#include <openmodeller/ThreadPool.hh>
+#include <openmodeller/ProjectionJournal.hh>
+#include <vector>
+#endif
+
 #ifdef MPI_FOUND
 #include "mpi.h"
 #endif
 
+#include <string.h>
 #include <utility>
 using std::pair;
 
@@ -53,6 +60,754 @@ using std::pair;
 #endif
 
 #ifndef MPI_FOUND
+
+// Approximate number of cells in each band of rows processed by a thread.
+#define PROJECTION_BAND_CELLS 65536
+
+/*******************/
+/*** valid Spans ***/
+// Columns of a map row (aligned with the environment) that can have
+// data according to the index of valid cells, as [first, end) spans.
+static void
+validSpans( const EnvironmentImpl& env, int y, int xdim, int colOffset, int rowOffset, std::vector< pair<int,int> >& spans )
+{
+  spans.clear();
+
+  const pair<int,int> *runs = 0;
+
+  int num = env.getValidRuns( y + rowOffset, &runs );
+
+  for ( int r = 0; r < num; ++r ) {
+
+    int first = runs[r].first - colOffset;
+    int end = runs[r].second - colOffset;
+
+    if ( first < 0 ) {
+
+      first = 0;
+    }
+
+    if ( end > xdim ) {
+
+      end = xdim;
+    }
+
+    if ( first < end ) {
+
+      spans.push_back( pair<int,int>( first, end ) );
+    }
+  }
+}
+
+/****************************************************************/
+/******************** Projection Band Context *******************/
+
+/*
+ * Resources shared by all bands of a multi-threaded projection. Layers
+ * and coordinate transformations are not thread safe, so each worker
+ * thread lazily creates its own copies, indexed by the worker number.
+ * Preloaded environments are only read from memory when grids are
+ * aligned, so in this case they are shared by all workers.
+ * Environmental values are read without normalization, once for all
+ * models, and then normalized with the normalizer of each model.
+ */
+class ProjectionBandContext {
+
+public:
+
+  ProjectionBandContext( const std::vector<Model>& models, const EnvironmentPtr& env, const Header& hdr, int numThreads ) :
+    models( models ),
+    env( env ),
+    hdr( hdr ),
+    normalizers(),
+    envs( numThreads, (EnvironmentImpl *)0 ),
+    gts( numThreads, (GeoTransform *)0 ),
+    workerNormalizers( numThreads ),
+    aligned( false ),
+    colOffset( 0 ),
+    rowOffset( 0 ),
+    indexed( false ),
+    shared( false ),
+    abort( false ),
+    mutex()
+  {
+    aligned = env->getGridOffset( hdr, &colOffset, &rowOffset );
+
+    // The index is only built when the map is aligned with the environment.
+    indexed = aligned && env->indexValidCells();
+
+    shared = aligned && env->isPreloaded();
+
+    // Keep a copy of the normalizer of each model, leaving the
+    // environment with its original normalization.
+    Normalizer *original = env->getNormalizer() ? env->getNormalizer()->getCopy() : 0;
+
+    for ( unsigned int m = 0; m < models.size(); ++m ) {
+
+      models[m]->setNormalization( env );
+
+      Normalizer *normalizer = env->getNormalizer();
+
+      normalizers.push_back( normalizer ? normalizer->getCopy() : 0 );
+    }
+
+    env->normalize( original );
+
+    delete original;
+  }
+
+  ~ProjectionBandContext()
+  {
+    for ( unsigned int i = 0; i < envs.size(); ++i ) {
+
+      if ( ! shared ) {
+
+        delete envs[i];
+      }
+
+      delete gts[i];
+
+      for ( unsigned int m = 0; m < workerNormalizers[i].size(); ++m ) {
+
+        delete workerNormalizers[i][m];
+      }
+    }
+
+    for ( unsigned int m = 0; m < normalizers.size(); ++m ) {
+
+      delete normalizers[m];
+    }
+  }
+
+  // Prepare the resources of a worker. Opening layers is serialized
+  // since raster drivers and coordinate systems are shared singletons.
+  void prepare( int worker )
+  {
+    if ( envs[worker] ) {
+
+      return;
+    }
+
+    ScopedLock lock( mutex );
+
+    gts[worker] = new GeoTransform( hdr.proj, GeoTransform::getDefaultCS() );
+    envs[worker] = shared ? env.operator->() : env->clone();
+
+    for ( unsigned int m = 0; m < normalizers.size(); ++m ) {
+
+      workerNormalizers[worker].push_back( normalizers[m] ? normalizers[m]->getCopy() : 0 );
+    }
+  }
+
+  const std::vector<Model>& models;
+  const EnvironmentPtr& env;
+  const Header& hdr;
+
+  std::vector<Normalizer *> normalizers;
+
+  std::vector<EnvironmentImpl *> envs;
+  std::vector<GeoTransform *> gts;
+  std::vector< std::vector<Normalizer *> > workerNormalizers;
+
+  // Indicates if map cells can be mapped directly to environment cells.
+  bool aligned;
+  int colOffset;
+  int rowOffset;
+
+  // Indicates if cells without data are known from the index of
+  // valid cells of the environment (only when aligned).
+  bool indexed;
+
+  // Indicates if the environment is shared by all workers.
+  bool shared;
+
+  volatile bool abort;
+
+  Mutex mutex;
+};
+
+/****************************************************************/
+/************************ Projection Band ***********************/
+
+/*
+ * Set of consecutive map rows whose predictions are calculated by
+ * a worker thread and later written to the maps by the main thread.
+ */
+class ProjectionBand : public ThreadPoolTask {
+
+public:
+
+  ProjectionBand( ProjectionBandContext *context, int firstRow, int numRows, const std::vector<Scalar>& thresholds ) :
+    ThreadPoolTask(),
+    context( context ),
+    firstRow( firstRow ),
+    numRows( numRows ),
+    lg(),
+    lt(),
+    val( thresholds.size() ),
+    stats(),
+    error()
+  {
+    for ( unsigned int m = 0; m < thresholds.size(); ++m ) {
+
+      stats.push_back( AreaStats( thresholds[m] ) );
+    }
+  }
+
+  // Exceptions would only be logged by the thread pool, so they are
+  // stored as band errors like the ones detected here.
+  void run( int worker )
+  {
+    try {
+
+      project( worker );
+    }
+    catch ( std::exception& e ) {
+
+      error = e.what();
+    }
+    catch ( ... ) {
+
+      error = "Unknown error while projecting the model";
+    }
+  }
+
+  void project( int worker )
+  {
+    if ( context->abort ) {
+
+      return;
+    }
+
+    context->prepare( worker );
+
+    EnvironmentImpl *env = context->envs[worker];
+    GeoTransform *gt = context->gts[worker];
+    const std::vector<Normalizer *>& normalizers = context->workerNormalizers[worker];
+
+    const Header& hdr = context->hdr;
+
+    int nmodels = (int)context->models.size();
+
+    int ncells = numRows * hdr.xdim;
+
+    // Coordinates are only needed when the grids are not aligned.
+    if ( ! context->aligned ) {
+
+      lg.resize( ncells );
+      lt.resize( ncells );
+    }
+
+    // Cells that are not read keep the noval indication.
+    for ( int m = 0; m < nmodels; ++m ) {
+
+      val[m].assign( ncells, -1 );
+    }
+
+    // Environmental values (for each model) and positions of the
+    // valid cells of a row, predicted in a single call.
+    std::vector< std::vector<Scalar> > samples( nmodels );
+    std::vector<int> cells;
+    std::vector<Scalar> predictions;
+
+    for ( int m = 0; m < nmodels; ++m ) {
+
+      samples[m].reserve( hdr.xdim * env->numLayers() );
+    }
+
+    cells.reserve( hdr.xdim );
+
+    int numCategorical = env->numCategoricalLayers();
+
+    // Columns of each row that are read (all of them, unless cells
+    // without data are known from the index of valid cells).
+    std::vector< pair<int,int> > spans( 1, pair<int,int>( 0, hdr.xdim ) );
+
+    for ( int y = firstRow; y < firstRow + numRows; ++y ) {
+
+      if ( context->abort ) {
+
+        return;
+      }
+
+      for ( int m = 0; m < nmodels; ++m ) {
+
+        samples[m].clear();
+      }
+
+      cells.clear();
+
+      if ( context->indexed ) {
+
+        validSpans( *context->env, y, hdr.xdim, context->colOffset, context->rowOffset, spans );
+      }
+
+      int dim = 0;
+
+      for ( unsigned int s = 0; s < spans.size(); ++s ) {
+
+        for ( int x = spans[s].first; x < spans[s].second; ++x ) {
+
+          int i = (y - firstRow) * hdr.xdim + x;
+
+          Sample amb;
+
+          if ( context->aligned ) {
+
+            amb = env->getUnnormalizedCell( x + context->colOffset, y + context->rowOffset );
+          }
+          else {
+
+            // Same coordinates as returned by MapIterator.
+            pair<Coord,Coord> lonlat = hdr.convertXY2LonLat( x, y );
+            gt->transfOut( &lonlat.first, &lonlat.second );
+
+            lg[i] = lonlat.first;
+            lt[i] = lonlat.second;
+
+            amb = env->getUnnormalized( lg[i], lt[i] );
+          }
+
+          if ( amb.size() == 0 ) {
+
+            // Keeps the noval indication.
+            continue;
+          }
+
+          dim = (int)amb.size();
+
+          amb.setCategoricalThreshold( numCategorical );
+
+          // The last model can normalize the original sample.
+          for ( int m = 0; m < nmodels; ++m ) {
+
+            if ( ! normalizers[m] ) {
+
+              samples[m].insert( samples[m].end(), amb.begin(), amb.end() );
+            }
+            else if ( m == nmodels - 1 ) {
+
+              normalizers[m]->normalize( &amb );
+              samples[m].insert( samples[m].end(), amb.begin(), amb.end() );
+            }
+            else {
+
+              Sample normalized( amb );
+              normalizers[m]->normalize( &normalized );
+              samples[m].insert( samples[m].end(), normalized.begin(), normalized.end() );
+            }
+          }
+
+          cells.push_back( i );
+        }
+      }
+
+      if ( cells.empty() ) {
+
+        continue;
+      }
+
+      predictions.resize( cells.size() );
+
+      for ( int m = 0; m < nmodels; ++m ) {
+
+        context->models[m]->getValues( &samples[m][0], (int)cells.size(), dim, numCategorical, &predictions[0] );
+
+        for ( unsigned int j = 0; j < cells.size(); ++j ) {
+
+          int cell = cells[j];
+
+          val[m][cell] = predictions[j];
+
+          if ( val[m][cell] < 0.0 || val[m][cell] > 1.0 ) {
+
+            pair<Coord,Coord> lonlat = hdr.convertXY2LonLat( cell % hdr.xdim, firstRow + cell / hdr.xdim );
+            gt->transfOut( &lonlat.first, &lonlat.second );
+
+            error = Log::format( "Suitability for point (%f, %f) is outside the range: %f", lonlat.first, lonlat.second, val[m][cell] );
+            return;
+          }
+
+          stats[m].addPrediction( val[m][cell] );
+        }
+      }
+    }
+  }
+
+  // Read the values of a band completed by a previous run (single model).
+  bool load( ProjectionJournal *journal, GeoTransform *gt )
+  {
+    if ( ! journal->readBand( firstRow, val[0] ) ) {
+
+      return false;
+    }
+
+    const Header& hdr = context->hdr;
+
+    if ( ! context->aligned ) {
+
+      lg.resize( val[0].size() );
+      lt.resize( val[0].size() );
+    }
+
+    for ( unsigned int i = 0; i < val[0].size(); ++i ) {
+
+      if ( ! context->aligned ) {
+
+        pair<Coord,Coord> lonlat = hdr.convertXY2LonLat( i % hdr.xdim, firstRow + i / hdr.xdim );
+        gt->transfOut( &lonlat.first, &lonlat.second );
+
+        lg[i] = lonlat.first;
+        lt[i] = lonlat.second;
+      }
+
+      if ( val[0][i] >= 0.0 ) {
+
+        stats[0].addPrediction( val[0][i] );
+      }
+    }
+
+    return true;
+  }
+
+  ProjectionBandContext *context;
+
+  int firstRow;
+  int numRows;
+
+  std::vector<Coord> lg;
+  std::vector<Coord> lt;
+
+  // Values of each model.
+  std::vector< std::vector<Scalar> > val;
+
+  std::vector<AreaStats> stats;
+
+  std::string error;
+};
+
+/***************************/
+/*** create Map Threaded ***/
+static bool
+createMapThreaded( const std::vector<Model>& models,
+                   const EnvironmentPtr& env,
+                   const std::vector<Map *>& maps,
+                   const Header& hdr,
+                   const std::vector<AreaStats *>& areaStats,
+                   CallbackWrapper *callbackWrapper,
+                   int numThreads,
+                   ProjectionJournal *journal )
+{
+  // Workers share the models, so all of them must allow concurrent calls.
+  for ( unsigned int m = 0; m < models.size() && numThreads > 1; ++m ) {
+
+    if ( ! models[m]->supportsThreadedProjection() ) {
+
+      Log::instance()->debug( "Model %d does not support threaded projection. Using a single thread.\n", m );
+      numThreads = 1;
+    }
+  }
+
+  ProjectionBandContext context( models, env, hdr, numThreads );
+
+  std::vector<Scalar> thresholds;
+
+  for ( unsigned int m = 0; m < models.size(); ++m ) {
+
+    thresholds.push_back( areaStats[m] ? areaStats[m]->getPredictionThreshold() : 0.5 );
+  }
+
+  int bandRows = PROJECTION_BAND_CELLS / ( hdr.xdim > 0 ? hdr.xdim : 1 );
+
+  if ( bandRows < 1 ) {
+
+    bandRows = 1;
+  }
+
+  int numBands = ( hdr.ydim + bandRows - 1 ) / bandRows;
+
+  // Bands completed by a previous run are read from the journal.
+  int completed = journal ? journal->open( hdr, bandRows ) : 0;
+
+  GeoTransform gt( hdr.proj, GeoTransform::getDefaultCS() );
+
+  // Limit the number of bands kept in memory.
+  int maxInFlight = 2*numThreads;
+
+  std::vector<ProjectionBand *> bands( numBands, (ProjectionBand *)0 );
+
+  int pixels = 0;
+  int pixelcount = hdr.ydim * hdr.xdim;
+
+  bool abort = false;
+  std::string error;
+
+  Log::instance()->debug( "Projecting %d bands of %d rows with %d threads\n", numBands, bandRows, numThreads );
+
+  {
+    // Workers must be stopped before bands and context are released.
+    ThreadPool pool( numThreads );
+
+    int next = completed;
+
+    for ( ; next < numBands && next < completed + maxInFlight; ++next ) {
+
+      int numRows = ( next == numBands - 1 ) ? hdr.ydim - next*bandRows : bandRows;
+      bands[next] = new ProjectionBand( &context, next*bandRows, numRows, thresholds );
+      pool.submit( bands[next] );
+    }
+
+    for ( int b = 0; b < numBands; ++b ) {
+
+      ProjectionBand *band = bands[b];
+
+      if ( b < completed ) {
+
+        int numRows = ( b == numBands - 1 ) ? hdr.ydim - b*bandRows : bandRows;
+        band = bands[b] = new ProjectionBand( &context, b*bandRows, numRows, thresholds );
+
+        if ( ! band->load( journal, &gt ) ) {
+
+          error = "Could not read projection journal " + journal->getFileName();
+          break;
+        }
+      }
+      else {
+
+        pool.waitFor( band );
+
+        if ( ! band->error.empty() ) {
+
+          error = band->error;
+          break;
+        }
+
+        // Stop recording if the journal cannot be written.
+        if ( journal && ! journal->writeBand( band->firstRow, band->val[0] ) ) {
+
+          journal = 0;
+        }
+      }
+
+      // Write values on the maps in the same order as a single thread.
+      for ( unsigned int m = 0; m < maps.size(); ++m ) {
+
+        Map *map = maps[m];
+
+        const std::vector<Scalar>& val = band->val[m];
+
+        if ( context.aligned ) {
+
+          // Consecutive cells without data are written at once.
+          for ( unsigned int i = 0; i < val.size(); ) {
+
+            int x = i % hdr.xdim;
+            int y = band->firstRow + i / hdr.xdim;
+
+            if ( val[i] < 0.0 ) {
+
+              int num = 1;
+
+              while ( x + num < hdr.xdim && val[i+num] < 0.0 ) {
+
+                ++num;
+              }
+
+              map->putCells( x, y, num );
+
+              i += num;
+            }
+            else {
+
+              map->putCell( x, y, val[i] );
+
+              ++i;
+            }
+          }
+        }
+        else {
+
+          for ( unsigned int i = 0; i < val.size(); ++i ) {
+
+            if ( val[i] < 0.0 ) {
+
+              map->put( band->lg[i], band->lt[i] );
+            }
+            else {
+
+              map->put( band->lg[i], band->lt[i], val[i] );
+            }
+          }
+        }
+
+        if ( areaStats[m] ) {
+
+          areaStats[m]->merge( &band->stats[m] );
+        }
+      }
+
+      pixels += hdr.xdim * band->numRows;
+
+      delete band;
+      bands[b] = 0;
+
+      if ( next < numBands && b >= completed ) {
+
+        int numRows = ( next == numBands - 1 ) ? hdr.ydim - next*bandRows : bandRows;
+        bands[next] = new ProjectionBand( &context, next*bandRows, numRows, thresholds );
+        pool.submit( bands[next] );
+        ++next;
+      }
+
+      if ( callbackWrapper ) {
+
+        try {
+
+          abort = callbackWrapper->abortionRequested();
+        }
+        catch( ... ) {}
+
+        if ( abort ) {
+
+          break;
+        }
+
+        float progress = pixels/(float)pixelcount;
+
+        if ( progress > 1.0 ) {
+
+          progress = 1.0;
+        }
+
+        try {
+
+          callbackWrapper->notifyModelProjectionProgress( progress );
+        }
+        catch( ... ) {}
+      }
+    }
+
+    context.abort = true;
+    pool.cancelPending();
+    pool.waitAll();
+  }
+
+  for ( unsigned int i = 0; i < bands.size(); ++i ) {
+
+    delete bands[i];
+  }
+
+  if ( ! error.empty() ) {
+
+    throw AlgorithmException( error.c_str() );
+  }
+
+  if ( abort ) {
+
+    Log::instance()->info( "Projection aborted." );
+
+    for ( unsigned int m = 0; m < maps.size(); ++m ) {
+
+      if ( ! maps[m]->deleteRaster() ) {
+
+        Log::instance()->warn( "Could not delete map file." );
+      }
+    }
+
+    if ( journal ) {
+
+      journal->remove();
+    }
+
+    return false;
+  }
+
+  // Call the callback function if it is set.
+  if ( callbackWrapper ) {
+
+    try  {
+
+      callbackWrapper->notifyModelProjectionProgress( 1.0 );
+    }
+    catch ( ... ) {}
+  }
+
+  for ( unsigned int m = 0; m < maps.size(); ++m ) {
+
+    maps[m]->finish();
+  }
+
+  if ( journal ) {
+
+    journal->remove();
+  }
+
+  return true;
+}
+
+/*******************/
+/*** create Maps ***/
+bool
+Projector::createMaps( const std::vector<Model>& models,
+                       const EnvironmentPtr& env,
+                       const std::vector<Map *>& maps,
+                       const std::vector<AreaStats *>& areaStats,
+                       CallbackWrapper *callbackWrapper,
+                       int numThreads )
+{
+  if ( models.empty() || models.size() != maps.size() ) {
+
+    throw InvalidParameterException( "Number of models and maps must be the same" );
+  }
+
+  if ( ! areaStats.empty() && areaStats.size() != maps.size() ) {
+
+    throw InvalidParameterException( "Number of area statistics and maps must be the same" );
+  }
+
+  // Retrieve possible adjustments and/or additions made
+  // on the effective header.
+  Header hdr = maps[0]->getHeader();
+
+#ifndef GEO_TRANSFORMATIONS_OFF
+  if ( ! hdr.hasProj() ) {
+
+    throw;
+  }
+#endif
+
+  // All maps must share the same grid.
+  for ( unsigned int m = 1; m < maps.size(); ++m ) {
+
+    Header other = maps[m]->getHeader();
+
+    if ( other.xdim != hdr.xdim || other.ydim != hdr.ydim || other.proj != hdr.proj ||
+         memcmp( other.gt, hdr.gt, sizeof(hdr.gt) ) != 0 ) {
+
+      throw InvalidParameterException( "All maps must have the same extent, cell size and projection" );
+    }
+  }
+
+  std::vector<AreaStats *> stats( areaStats );
+
+  stats.resize( maps.size(), (AreaStats *)0 );
+
+  for ( unsigned int m = 0; m < stats.size(); ++m ) {
+
+    if ( stats[m] ) {
+
+      stats[m]->reset( stats[m]->getPredictionThreshold() );
+    }
+  }
+
+  if ( numThreads < 1 ) {
+
+    numThreads = ThreadPool::numProcessors();
+  }
+
+  return createMapThreaded( models, env, maps, hdr, stats, callbackWrapper, numThreads, 0 );
+}
+
 /******************/
 /*** create Map ***/
 bool
@@ -60,7 +815,9 @@ Projector::createMap( const Model& model,
 		      const EnvironmentPtr& env,
 		      Map *map,
 		      AreaStats *areaStats,
-		      CallbackWrapper *callbackWrapper )
+		      CallbackWrapper *callbackWrapper,
+		      int numThreads,
+		      ProjectionJournal *journal )
 {
   // Retrieve possible adjustments and/or additions made
   // on the effective header.
@@ -81,6 +838,24 @@ Projector::createMap( const Model& model,
     areaStats->reset( areaStats->getPredictionThreshold() );
   }
 
+  if ( numThreads < 1 ) {
+
+    numThreads = ThreadPool::numProcessors();
+  }
+
+  if ( numThreads > 1 && ! model->supportsThreadedProjection() ) {
+
+    Log::instance()->debug( "Model does not support threaded projection. Projecting sequentially.\n" );
+    numThreads = 1;
+  }
+
+  // Checkpoints are recorded for each band of rows.
+  if ( numThreads > 1 || journal ) {
+
+    return createMapThreaded( std::vector<Model>( 1, model ), env, std::vector<Map *>( 1, map ), hdr,
+                              std::vector<AreaStats *>( 1, areaStats ), callbackWrapper, numThreads, journal );
+  }
+
   MapIterator fin;
   MapIterator it = map->begin();
 
@@ -93,6 +868,24 @@ Projector::createMap( const Model& model,
   Coord lt;
   Scalar val;
 
+  // When the map grid is aligned with the environment, cells are
+  // accessed directly, without any coordinate transformation.
+  int colOffset = 0;
+  int rowOffset = 0;
+  bool aligned = env->getGridOffset( hdr, &colOffset, &rowOffset );
+
+  if ( aligned ) {
+
+    Log::instance()->debug( "Map is aligned with the environment\n" );
+  }
+
+  // Cells without data are known from the index of valid cells, built
+  // on first use.
+  bool indexed = aligned && env->indexValidCells();
+
+  std::vector< pair<int,int> > spans;
+  unsigned int span = 0;
+
   while ( it != fin ) {
 
     // Call the abort callback function if it is set.
@@ -117,21 +910,55 @@ Projector::createMap( const Model& model,
       catch( ... ) {}
     }
     
-    pair<Coord,Coord> lonlat = *it;
+    int x = pixels % hdr.xdim;
+    int y = pixels / hdr.xdim;
 
-    pixels++;
-    ++it;
+    Sample amb;
 
-    lg = lonlat.first;
-    lt = lonlat.second;
+    if ( indexed ) {
+
+      if ( x == 0 ) {
+
+        validSpans( *env, y, hdr.xdim, colOffset, rowOffset, spans );
+        span = 0;
+      }
 
-    Sample const &amb = env->get( lg, lt );
+      while ( span < spans.size() && x >= spans[span].second ) {
+
+        ++span;
+      }
+
+      if ( span < spans.size() && x >= spans[span].first ) {
+
+        amb = env->getCell( x + colOffset, y + rowOffset );
+      }
+    }
+    else if ( aligned ) {
+
+      amb = env->getCell( x + colOffset, y + rowOffset );
+    }
+    else {
+
+      pair<Coord,Coord> lonlat = *it;
+
+      lg = lonlat.first;
+      lt = lonlat.second;
+
+      amb = env->get( lg, lt );
+    }
 
     // Read environmental values and find the output value.
     if ( amb.size() == 0 ) {
 
       // Write noval on the map.
-      map->put( lg, lt );
+      if ( aligned ) {
+
+        map->putCell( x, y );
+      }
+      else {
+
+        map->put( lg, lt );
+      }
 
       val = -1; // could be used in a log
     }
@@ -141,7 +968,9 @@ Projector::createMap( const Model& model,
 
       if ( val < 0.0 || val > 1.0 ) {
 
-        std::string msg = Log::format( "Suitability for point (%f, %f) is outside the range: %f", lg, lt, val );
+        pair<Coord,Coord> lonlat = *it;
+
+        std::string msg = Log::format( "Suitability for point (%f, %f) is outside the range: %f", lonlat.first, lonlat.second, val );
         throw AlgorithmException( msg.c_str() );
       }
 
@@ -151,9 +980,19 @@ Projector::createMap( const Model& model,
       }
 
       // Write value on map.
-      map->put( lg, lt, val );
+      if ( aligned ) {
+
+        map->putCell( x, y, val );
+      }
+      else {
+
+        map->put( lg, lt, val );
+      }
     }
 
+    pixels++;
+    ++it;
+
     // Call the callback function if it is set.
     if ( callbackWrapper && pixels%pixelstep == 0 ) {
 
@@ -195,7 +1034,9 @@ Projector::createMap( const Model& model,
                       const EnvironmentPtr& env,
                       Map *map,
                       AreaStats *areaStats,
-                      CallbackWrapper *callbackWrapper )
+                      CallbackWrapper *callbackWrapper,
+                      int numThreads,
+                      ProjectionJournal *journal )
 {
 
   /*********************struct buff *************************************/
@@ -395,5 +1236,34 @@ while (init_pixel<(total_pixels)) {
 
   return true;
 }
+
+/*******************/
+/*** create Maps ***/
+// The parallel version projects one model at a time.
+bool
+Projector::createMaps( const std::vector<Model>& models,
+                       const EnvironmentPtr& env,
+                       const std::vector<Map *>& maps,
+                       const std::vector<AreaStats *>& areaStats,
+                       CallbackWrapper *callbackWrapper,
+                       int numThreads )
+{
+  if ( models.empty() || models.size() != maps.size() ) {
+
+    throw InvalidParameterException( "Number of models and maps must be the same" );
+  }
+
+  for ( unsigned int m = 0; m < models.size(); ++m ) {
+
+    AreaStats *stats = ( m < areaStats.size() ) ? areaStats[m] : 0;
+
+    if ( ! createMap( models[m], env, maps[m], stats, callbackWrapper, numThreads ) ) {
+
+      return false;
+    }
+  }
+
+  return true;
+}
 #endif
 
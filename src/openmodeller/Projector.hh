@@ -36,21 +36,55 @@
 #include <openmodeller/env_io/Header.hh>
 
 #include <string>
+#include <vector>
 
 class RasterFile;
 class AreaStats;
+class ProjectionJournal;
 
 class dllexp Projector {
 
 public:
 
   /** Create and save distribution map to disk.
+   * @param numThreads Number of threads used to calculate the predictions.
+   *  When greater than one, the map is split into bands of rows that are
+   *  processed in parallel, each thread with its own copy of the
+   *  environment layers. Values are still written in the same order, so
+   *  the resulting map is identical to the one produced by a single thread.
+   *  Zero means one thread per available processor. Models that don't
+   *  support threaded projection (see ModelImpl::supportsThreadedProjection)
+   *  always use a single thread.
+   * @param journal Optional checkpoint journal. Completed bands are
+   *  recorded in the journal, and bands completed by a previous run
+   *  with the same journal are not calculated again. The journal is
+   *  removed when the projection finishes or is aborted.
    */
   static bool createMap( const Model& model,
 			 const EnvironmentPtr& env,
 			 Map *map,
 			 AreaStats *areaStats = 0,
-			 CallbackWrapper *callbackWrapper = 0 );
+			 CallbackWrapper *callbackWrapper = 0,
+			 int numThreads = 1,
+			 ProjectionJournal *journal = 0 );
+
+  /** Create and save the distribution maps of several models on the
+   *  same environment. Environmental values are read only once for
+   *  each cell and then used by all models.
+   * @param models Models to be projected.
+   * @param env Environment shared by all models.
+   * @param maps Output map of each model. All maps must have the same
+   *  extent, cell size and projection.
+   * @param areaStats Optional area statistics of each map (entries can be 0).
+   * @param callbackWrapper Optional callbacks for progress and abortion.
+   * @param numThreads Number of threads (see createMap).
+   */
+  static bool createMaps( const std::vector<Model>& models,
+			  const EnvironmentPtr& env,
+			  const std::vector<Map *>& maps,
+			  const std::vector<AreaStats *>& areaStats = std::vector<AreaStats *>(),
+			  CallbackWrapper *callbackWrapper = 0,
+			  int numThreads = 1 );
 
 private:
 		   // Don't allow construction.
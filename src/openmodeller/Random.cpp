@@ -37,16 +37,30 @@
 
 int Random::_initialized = 0;
 
+// Constants of the "minimal standard" generator (Park & Miller, 1988)
+// used by independent streams, with Schrage's factorization to avoid
+// overflows in 32 bits.
+#define MINSTD_M 2147483647L
+#define MINSTD_A 16807L
+#define MINSTD_Q 127773L
+#define MINSTD_R 2836L
+
 
 /*******************/
 /*** Constructor ***/
 
-Random::Random()
+Random::Random() :
+  _state( 0 )
 {
   if ( ! _initialized )
     _initialized = initRandom();
 }
 
+Random::Random( unsigned int seed ) :
+  _state( (long)( seed % (unsigned int)(MINSTD_M - 1) ) + 1 )
+{
+}
+
 
 /********************/
 /*** get (double) ***/
@@ -154,7 +168,19 @@ Random::discrete( float range, float dim_interv )
 double
 Random::random()
 {
-  return ::rand() / (RAND_MAX + 1.0);
+  if ( ! _state )
+    return ::rand() / (RAND_MAX + 1.0);
+
+  long hi = _state / MINSTD_Q;
+  long lo = _state % MINSTD_Q;
+
+  _state = MINSTD_A * lo - MINSTD_R * hi;
+
+  if ( _state <= 0 )
+    _state += MINSTD_M;
+
+  // _state is between 1 and MINSTD_M - 1
+  return ( _state - 1 ) / (double)( MINSTD_M - 1 );
 }
 
 
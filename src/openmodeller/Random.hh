@@ -44,8 +44,16 @@
 class dllexp Random
 {
 public:
+  /** Uses the global generator (see initRandom()).*/
   Random();
 
+  /** Creates an independent stream of numbers, which does not use
+   *  nor change the state of the global generator. Streams created
+   *  with the same seed generate the same sequence of numbers, even
+   *  when used by different threads.
+   */
+  Random( unsigned int seed );
+
   /** Return real numbers between [min, max).*/
   double get( double min, double max );
   /** Return real numbers between [0, max).*/
@@ -86,6 +94,9 @@ private:
   double random();
 
   static int _initialized;
+
+  /** State of independent streams (0 means global generator).*/
+  long _state;
 };
 
 
@@ -0,0 +1,407 @@
+/**
+ * Definition of ThreadPool class and related synchronization helpers.
+ *
+ * $Id$
+ *
+ * LICENSE INFORMATION
+ *
+ * Copyright(c) 2026 by CRIA -
+ * Centro de Referencia em Informacao Ambiental
+ *
+ * http://www.cria.org.br
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details:
+ *
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#include <openmodeller/ThreadPool.hh>
+#include <openmodeller/Log.hh>
+
+#include <stdexcept>
+
+#ifdef WIN32
+// windows threading (condition variables require Vista or later)
+#include <windows.h>
+#include <process.h>
+#else
+// posix threading (linux/unix/cygwin)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/****************************************************************/
+/***************************** Mutex ****************************/
+
+Mutex::Mutex()
+{
+#ifdef WIN32
+  CRITICAL_SECTION *cs = new CRITICAL_SECTION;
+  InitializeCriticalSection( cs );
+  _handle = cs;
+#else
+  pthread_mutex_t *mutex = new pthread_mutex_t;
+  pthread_mutex_init( mutex, NULL );
+  _handle = mutex;
+#endif
+}
+
+Mutex::~Mutex()
+{
+#ifdef WIN32
+  CRITICAL_SECTION *cs = (CRITICAL_SECTION *)_handle;
+  DeleteCriticalSection( cs );
+  delete cs;
+#else
+  pthread_mutex_t *mutex = (pthread_mutex_t *)_handle;
+  pthread_mutex_destroy( mutex );
+  delete mutex;
+#endif
+}
+
+void
+Mutex::lock()
+{
+#ifdef WIN32
+  EnterCriticalSection( (CRITICAL_SECTION *)_handle );
+#else
+  pthread_mutex_lock( (pthread_mutex_t *)_handle );
+#endif
+}
+
+void
+Mutex::unlock()
+{
+#ifdef WIN32
+  LeaveCriticalSection( (CRITICAL_SECTION *)_handle );
+#else
+  pthread_mutex_unlock( (pthread_mutex_t *)_handle );
+#endif
+}
+
+
+/****************************************************************/
+/************************** Thread Pool *************************/
+
+/*******************/
+/*** constructor ***/
+
+ThreadPool::ThreadPool( int numThreads ) :
+  _mutex(),
+  _condition( 0 ),
+  _queue(),
+  _threads(),
+  _workers(),
+  _running( 0 ),
+  _stop( false )
+{
+  if ( numThreads < 1 ) {
+
+    numThreads = numProcessors();
+  }
+
+#ifdef WIN32
+  CONDITION_VARIABLE *cond = new CONDITION_VARIABLE;
+  InitializeConditionVariable( cond );
+  _condition = cond;
+#else
+  pthread_cond_t *cond = new pthread_cond_t;
+  pthread_cond_init( cond, NULL );
+  _condition = cond;
+#endif
+
+  // Workers must not be reallocated after the threads start
+  _workers.resize( numThreads );
+
+  for ( int i = 0; i < numThreads; ++i ) {
+
+    _workers[i].pool = this;
+    _workers[i].index = i;
+
+#ifdef WIN32
+    HANDLE thread = (HANDLE)_beginthreadex( NULL, 0, _win32WorkerEntry, &_workers[i], 0, NULL );
+
+    if ( thread == 0 ) {
+
+      Log::instance()->error( "Could not start worker thread %d\n", i );
+      break;
+    }
+
+    _threads.push_back( thread );
+#else
+    pthread_t *thread = new pthread_t;
+
+    if ( pthread_create( thread, NULL, _workerEntry, &_workers[i] ) != 0 ) {
+
+      Log::instance()->error( "Could not start worker thread %d\n", i );
+      delete thread;
+      break;
+    }
+
+    _threads.push_back( thread );
+#endif
+  }
+
+  if ( _threads.empty() ) {
+
+    throw std::runtime_error( "Could not start any worker thread" );
+  }
+}
+
+/******************/
+/*** destructor ***/
+
+ThreadPool::~ThreadPool()
+{
+  cancelPending();
+
+  _mutex.lock();
+  _stop = true;
+  _broadcast();
+  _mutex.unlock();
+
+  for ( unsigned int i = 0; i < _threads.size(); ++i ) {
+
+#ifdef WIN32
+    HANDLE thread = (HANDLE)_threads[i];
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+#else
+    pthread_t *thread = (pthread_t *)_threads[i];
+    pthread_join( *thread, NULL );
+    delete thread;
+#endif
+  }
+
+#ifdef WIN32
+  delete (CONDITION_VARIABLE *)_condition;
+#else
+  pthread_cond_t *cond = (pthread_cond_t *)_condition;
+  pthread_cond_destroy( cond );
+  delete cond;
+#endif
+}
+
+/**************/
+/*** submit ***/
+void
+ThreadPool::submit( ThreadPoolTask *task )
+{
+  ScopedLock lock( _mutex );
+
+  task->_done = false;
+  task->_cancelled = false;
+
+  _queue.push_back( task );
+
+  _broadcast();
+}
+
+/****************/
+/*** wait For ***/
+void
+ThreadPool::waitFor( ThreadPoolTask *task )
+{
+  ScopedLock lock( _mutex );
+
+  while ( ! task->_done ) {
+
+    _wait();
+  }
+}
+
+/********************/
+/*** wait For Any ***/
+int
+ThreadPool::waitForAny( const std::vector<ThreadPoolTask*>& tasks )
+{
+  if ( tasks.empty() ) {
+
+    return -1;
+  }
+
+  ScopedLock lock( _mutex );
+
+  while ( true ) {
+
+    for ( unsigned int i = 0; i < tasks.size(); ++i ) {
+
+      if ( tasks[i]->_done ) {
+
+        return (int)i;
+      }
+    }
+
+    _wait();
+  }
+}
+
+/****************/
+/*** wait All ***/
+void
+ThreadPool::waitAll()
+{
+  ScopedLock lock( _mutex );
+
+  while ( ! _queue.empty() || _running > 0 ) {
+
+    _wait();
+  }
+}
+
+/**********************/
+/*** cancel Pending ***/
+int
+ThreadPool::cancelPending()
+{
+  ScopedLock lock( _mutex );
+
+  int num = (int)_queue.size();
+
+  std::deque<ThreadPoolTask*>::iterator it = _queue.begin();
+
+  for ( ; it != _queue.end(); ++it ) {
+
+    (*it)->_cancelled = true;
+    (*it)->_done = true;
+  }
+
+  _queue.clear();
+
+  _broadcast();
+
+  return num;
+}
+
+/*******************/
+/*** num Pending ***/
+int
+ThreadPool::numPending()
+{
+  ScopedLock lock( _mutex );
+
+  return (int)_queue.size() + _running;
+}
+
+/**********************/
+/*** num Processors ***/
+int
+ThreadPool::numProcessors()
+{
+  int num = 1;
+
+#ifdef WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo( &info );
+  num = (int)info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+  num = (int)sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+
+  return ( num > 0 ) ? num : 1;
+}
+
+/********************/
+/*** worker Entry ***/
+void *
+ThreadPool::_workerEntry( void *arg )
+{
+  Worker *worker = (Worker *)arg;
+
+  worker->pool->_workerLoop( worker->index );
+
+  return NULL;
+}
+
+#ifdef WIN32
+unsigned __stdcall
+ThreadPool::_win32WorkerEntry( void *arg )
+{
+  _workerEntry( arg );
+
+  return 0;
+}
+#endif
+
+/*******************/
+/*** worker Loop ***/
+void
+ThreadPool::_workerLoop( int index )
+{
+  _mutex.lock();
+
+  while ( true ) {
+
+    while ( _queue.empty() && ! _stop ) {
+
+      _wait();
+    }
+
+    if ( _queue.empty() ) {
+
+      // Stop was requested and there is nothing else to do
+      break;
+    }
+
+    ThreadPoolTask *task = _queue.front();
+    _queue.pop_front();
+    ++_running;
+
+    _mutex.unlock();
+
+    try {
+
+      task->run( index );
+    }
+    catch ( std::exception& e ) {
+
+      Log::instance()->error( "Unhandled exception in worker thread %d: %s\n", index, e.what() );
+    }
+    catch ( ... ) {
+
+      Log::instance()->error( "Unhandled exception in worker thread %d\n", index );
+    }
+
+    _mutex.lock();
+
+    // Note: the task may be deleted by its owner as soon as it is done
+    task->_done = true;
+    --_running;
+
+    _broadcast();
+  }
+
+  _mutex.unlock();
+}
+
+/************/
+/*** wait ***/
+void
+ThreadPool::_wait()
+{
+#ifdef WIN32
+  SleepConditionVariableCS( (CONDITION_VARIABLE *)_condition, (CRITICAL_SECTION *)_mutex._handle, INFINITE );
+#else
+  pthread_cond_wait( (pthread_cond_t *)_condition, (pthread_mutex_t *)_mutex._handle );
+#endif
+}
+
+/*****************/
+/*** broadcast ***/
+void
+ThreadPool::_broadcast()
+{
+#ifdef WIN32
+  WakeAllConditionVariable( (CONDITION_VARIABLE *)_condition );
+#else
+  pthread_cond_broadcast( (pthread_cond_t *)_condition );
+#endif
+}
@@ -0,0 +1,208 @@
+/**
+ * Declaration of ThreadPool class and related synchronization helpers.
+ *
+ * $Id$
+ *
+ * LICENSE INFORMATION
+ *
+ * Copyright(c) 2026 by CRIA -
+ * Centro de Referencia em Informacao Ambiental
+ *
+ * http://www.cria.org.br
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details:
+ *
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+#ifndef _THREAD_POOL_HH_
+#define _THREAD_POOL_HH_
+
+#include <openmodeller/os_specific.hh>
+
+#include <deque>
+#include <vector>
+
+/****************************************************************/
+/***************************** Mutex ****************************/
+
+/**
+ * Thin wrapper around the native mutex (pthread or win32).
+ */
+class dllexp Mutex {
+
+  friend class ThreadPool;
+
+public:
+
+  Mutex();
+  ~Mutex();
+
+  void lock();
+  void unlock();
+
+private:
+
+  void *_handle;
+
+  // Disable copying.
+  Mutex( const Mutex& );
+  Mutex& operator=( const Mutex& );
+};
+
+/**
+ * Locks a mutex during the lifetime of the object.
+ */
+class dllexp ScopedLock {
+
+public:
+
+  ScopedLock( Mutex& mutex ) : _mutex( mutex ) { _mutex.lock(); }
+  ~ScopedLock() { _mutex.unlock(); }
+
+private:
+
+  Mutex& _mutex;
+
+  // Disable copying.
+  ScopedLock( const ScopedLock& );
+  ScopedLock& operator=( const ScopedLock& );
+};
+
+
+/****************************************************************/
+/************************ Thread Pool Task **********************/
+
+/**
+ * Unit of work executed by a ThreadPool. Tasks are owned by the caller,
+ * which must keep them alive until they finish (see ThreadPool::waitFor
+ * and ThreadPool::waitAll).
+ */
+class dllexp ThreadPoolTask {
+
+  friend class ThreadPool;
+
+public:
+
+  ThreadPoolTask() : _done( false ), _cancelled( false ) {}
+
+  virtual ~ThreadPoolTask() {}
+
+  /** Task body.
+   * @param worker Index of the worker thread running the task, between 0
+   *  and ThreadPool::numThreads()-1. It can be used to index per thread
+   *  resources that are not thread safe (such as GDAL datasets).
+   */
+  virtual void run( int worker ) = 0;
+
+  /** Indicates if the task was cancelled before being run. */
+  bool cancelled() const { return _cancelled; }
+
+private:
+
+  bool _done;
+  bool _cancelled;
+};
+
+
+/****************************************************************/
+/************************** Thread Pool *************************/
+
+/**
+ * Fixed size pool of worker threads consuming tasks from a FIFO queue.
+ * Tasks are started in the same order they were submitted. Exceptions
+ * thrown by tasks are caught and logged, so tasks that need to report
+ * errors should store them and let the submitter check them.
+ */
+class dllexp ThreadPool {
+
+public:
+
+  /** Constructor.
+   * @param numThreads Number of worker threads. Values lower than 1
+   *  mean one thread per available processor.
+   */
+  ThreadPool( int numThreads );
+
+  /** Destructor. Cancels pending tasks and waits for running ones. */
+  ~ThreadPool();
+
+  /** Number of worker threads. */
+  int numThreads() const { return (int)_threads.size(); }
+
+  /** Queue a task to be run by the next available worker.
+   * @param task Task to be run. Must not be deleted before it finishes.
+   */
+  void submit( ThreadPoolTask *task );
+
+  /** Block until the specified task is finished or cancelled. */
+  void waitFor( ThreadPoolTask *task );
+
+  /** Block until at least one of the specified tasks is finished or cancelled.
+   * @return Index of the first of these tasks (in the given order) that is
+   *  finished or cancelled, or -1 if no tasks were specified.
+   */
+  int waitForAny( const std::vector<ThreadPoolTask*>& tasks );
+
+  /** Block until all submitted tasks are finished or cancelled. */
+  void waitAll();
+
+  /** Remove all queued tasks that were not started yet, flagging them
+   *  as cancelled. Running tasks are not interrupted.
+   * @return Number of cancelled tasks.
+   */
+  int cancelPending();
+
+  /** Number of tasks that were submitted and are not finished yet. */
+  int numPending();
+
+  /** Number of processors available in the machine. */
+  static int numProcessors();
+
+private:
+
+  struct Worker {
+    ThreadPool *pool;
+    int index;
+  };
+
+  static void *_workerEntry( void *arg );
+
+#ifdef WIN32
+  static unsigned __stdcall _win32WorkerEntry( void *arg );
+#endif
+
+  void _workerLoop( int index );
+
+  // Condition helpers (implemented natively in ThreadPool.cpp).
+  void _wait();
+  void _broadcast();
+
+  Mutex _mutex;
+
+  void *_condition;
+
+  std::deque<ThreadPoolTask*> _queue;
+
+  std::vector<void*> _threads;
+
+  std::vector<Worker> _workers;
+
+  int _running;
+
+  bool _stop;
+
+  // Disable copying.
+  ThreadPool( const ThreadPool& );
+  ThreadPool& operator=( const ThreadPool& );
+};
+
+#endif
@@ -34,6 +34,8 @@
 #include <openmodeller/Log.hh>
 #include <openmodeller/Exceptions.hh>
 #include <openmodeller/MapFormat.hh>
+#include <openmodeller/Settings.hh>
+#include <openmodeller/ThreadPool.hh>
 
 #include <gdal_version.h>
 #include <gdal.h>
@@ -42,11 +44,13 @@
 #include <gdalwarper.h>
 
 #include <string.h>
+#include <stdlib.h>
 
 using std::string;
 using std::vector;
 
 #include <utility>
+#include <algorithm>
 using std::pair;
 
 #ifdef MPI_FOUND
@@ -102,10 +106,70 @@ GDAL_Format Formats[8] =
 
 static const GDALDataType f_type = (sizeof(Scalar) == 4) ? GDT_Float32 : GDT_Float64;
 
+// Default size of the memory shared by all block caches (in megabytes).
+#define DEFAULT_RASTER_CACHE_SIZE 256
+
+// Memory currently used by all block caches and its limit (in bytes).
+static size_t f_cacheBytes = 0;
+static size_t f_cacheBudget = 0;
+static Mutex f_cacheMutex;
+
+// Maximum number of blocks waiting to be written by the writer thread.
+#define MAX_PENDING_WRITES 4
+
 #ifdef MPI_FOUND
  int rank = 0;
 #endif
 
+/****************************************************************/
+/********************** Gdal Raster Write Task ******************/
+
+/*
+ * Block of rows written to the file by the writer thread of a raster,
+ * so that encoding and compression overlap with the computation of the
+ * next rows. The task owns the block data, which is also accounted in
+ * the memory used by the block caches until the task is deleted.
+ */
+class GdalRaster::WriteTask : public ThreadPoolTask {
+
+public:
+
+  WriteTask( GdalRaster *raster, Scalar *data, int first_row, int num_rows ) :
+    ThreadPoolTask(),
+    raster( raster ),
+    data( data ),
+    first_row( first_row ),
+    num_rows( num_rows ),
+    error()
+  {}
+
+  ~WriteTask()
+  {
+    delete[] data;
+
+    ScopedLock lock( f_cacheMutex );
+    f_cacheBytes -= sizeof(Scalar) * (size_t)raster->f_size * num_rows * raster->f_hdr.nband;
+  }
+
+  void run( int worker )
+  {
+    try {
+
+      raster->write( data, first_row, num_rows );
+    }
+    catch ( FileIOException& e ) {
+
+      error = e.what();
+    }
+  }
+
+  GdalRaster *raster;
+  Scalar *data;
+  int first_row;
+  int num_rows;
+  std::string error;
+};
+
 /****************************************************************/
 /************************** Raster Gdal *************************/
 
@@ -283,15 +347,39 @@ GdalRaster::~GdalRaster()
 #ifdef MPI_FOUND
   if (((rank != 0) && (strcmp (f_file.c_str(), f_output_file.c_str()) != 0)) || (rank == 0)){
 #endif
-    // Save the last line read, if needed.
-    saveRow();
+    // Save the blocks that have changed, if needed. Errors can only be
+    // logged here, so callers that need them should call flush first.
+    try {
 
-    if ( f_data ) {
+      saveBlocks();
+    }
+    catch ( FileIOException& e ) {
 
-      delete[] f_data;
+      Log::instance()->error( "%s\n", e.what() );
     }
 
-    GDALClose( f_ds );
+    try {
+
+      waitWrites();
+    }
+    catch ( FileIOException& e ) {
+
+      Log::instance()->error( "%s\n", e.what() );
+    }
+
+    delete f_writer;
+
+    releaseBlocks();
+
+    if ( f_hits + f_misses > 0 ) {
+
+      Log::instance()->debug( "Block cache of %s: %ld hits, %ld misses\n", f_file.c_str(), f_hits, f_misses );
+    }
+
+    if ( f_ds ) {
+
+      GDALClose( f_ds );
+    }
 
     if ( f_warped_ds ) {
 
@@ -324,7 +412,7 @@ GdalRaster::read( Scalar *buf, int frow, int nrow )
     if ( ret == CE_Failure ) {
 
       // Fill 'buf' with nodata
-      for ( int j = 0 ; j < f_size; j++ ) {
+      for ( int j = 0 ; j < size; j++ ) {
 
         buf[j] = f_hdr.noval;
       }
@@ -607,6 +695,9 @@ GdalRaster::create( int format )
   }
   #ifdef MPI_FOUND
   }
+  #else
+  // Blocks are written by a separate thread.
+  f_writeBehind = true;
   #endif
   // Initialize the Buffer
   initBuffer();
@@ -617,18 +708,64 @@ GdalRaster::create( int format )
 void
 GdalRaster::initBuffer()
 {
+  releaseBlocks();
+
   // Initialize the buffer.
   f_size = f_hdr.xdim;
 
-  if ( f_data ) {
+  // Use the native block height of the file, so that each block
+  // is read with a single access to the underlying storage.
+  int xblock = 0;
+  int yblock = 1;
+
+  if ( f_ds ) {
 
-    delete[] f_data;
+    f_ds->GetRasterBand( 1 )->GetBlockSize( &xblock, &yblock );
   }
 
-  f_data = new Scalar[ f_size * f_hdr.nband ];
+  f_blockRows = ( yblock > 0 ) ? yblock : 1;
+
+  // But keep blocks small compared to the cache budget.
+  size_t rowBytes = sizeof(Scalar) * f_size * ( f_hdr.nband > 0 ? f_hdr.nband : 1 );
+  size_t maxRows = ( rowBytes > 0 ) ? cacheBudget() / ( 8 * rowBytes ) : 1;
+
+  if ( (size_t)f_blockRows > maxRows ) {
+
+    f_blockRows = ( maxRows > 0 ) ? (int)maxRows : 1;
+  }
+
+  int nblocks = ( f_hdr.ydim + f_blockRows - 1 ) / f_blockRows;
+
+  f_index.assign( nblocks, f_blocks.end() );
+  f_flushed.assign( nblocks, 0 );
+}
+
+/********************/
+/*** cache Budget ***/
+size_t
+GdalRaster::cacheBudget()
+{
+  ScopedLock lock( f_cacheMutex );
+
+  if ( f_cacheBudget == 0 ) {
+
+    int megabytes = DEFAULT_RASTER_CACHE_SIZE;
+
+    if ( Settings::count( "RASTER_CACHE_SIZE" ) == 1 ) {
 
-  f_changed = 0;
-  f_currentRow = -1;
+      megabytes = atoi( Settings::get( "RASTER_CACHE_SIZE" ).c_str() );
+
+      if ( megabytes <= 0 ) {
+
+        Log::instance()->warn( "Invalid RASTER_CACHE_SIZE. Using %d MB.\n", DEFAULT_RASTER_CACHE_SIZE );
+        megabytes = DEFAULT_RASTER_CACHE_SIZE;
+      }
+    }
+
+    f_cacheBudget = (size_t)megabytes * 1024 * 1024;
+  }
+
+  return f_cacheBudget;
 }
 
 /*****************/
@@ -650,14 +787,14 @@ GdalRaster::initGdal()
 int
 GdalRaster::iput( int x, int y, Scalar val )
 {
-  // Be sure that 'y' line is in the buffer 'f_data'.
-  loadRow( y, true );
+  // Be sure that 'y' line is in the cache.
+  Block *block = loadBlock( y, true );
 
   // Put values in the first band of (x,y) position.
-  f_data[x] = val;
+  block->data[ (y - block->first_row) * f_size + x ] = val;
 
-  // Indicates the line 'f_currentRow' has changed.
-  f_changed = 1;
+  // Indicates the block has changed.
+  block->changed = true;
 
   return 1;
 }
@@ -667,15 +804,17 @@ GdalRaster::iput( int x, int y, Scalar val )
 int
 GdalRaster::iget( int x, int y, Scalar *val )
 {
-  // Be sure that 'y' line is in the buffer 'f_data'.
-  loadRow( y );
+  // Be sure that 'y' line is in the cache.
+  Block *block = loadBlock( y );
 
   // Get all band's values.
   Scalar *pv = val;
+  Scalar *data = block->data + (y - block->first_row) * f_size + x;
+  int stride = block->num_rows * f_size;
   int nband = f_hdr.nband;
-  for ( int i = 0; i < nband; i++, x += f_size ) {
+  for ( int i = 0; i < nband; i++, data += stride ) {
 
-    if ( (*pv++ = f_data[x]) == f_hdr.noval ) {
+    if ( (*pv++ = *data) == f_hdr.noval ) {
 
       return 0;
     }
@@ -749,6 +888,82 @@ GdalRaster::put( Coord px, Coord py )
   return iput( x, y, val );
 }
 
+/****************/
+/*** get Cell ***/
+int
+GdalRaster::getCell( int col, int row, Scalar *val )
+{
+  if ( col < 0 || col >= f_hdr.xdim || row < 0 || row >= f_hdr.ydim ) {
+
+    Scalar *pv = val;
+    for ( int i = 0; i < f_hdr.nband; i++ ) {
+
+      *pv++ = f_hdr.noval;
+    }
+
+    return 0;
+  }
+
+  return iget( col, row, val );
+}
+
+/****************/
+/*** put Cell ***/
+int
+GdalRaster::putCell( int col, int row, Scalar val )
+{
+  if ( col < 0 || col >= f_hdr.xdim || row < 0 || row >= f_hdr.ydim ) {
+
+    Log::instance()->warn( "Cell (%d, %d) is outside the raster boundaries. It will be ignored.\n", col, row ); 
+    return 0;
+  }
+
+  return iput( col, row, f_scalefactor*val );
+}
+
+/****************/
+/*** put Cell ***/
+int
+GdalRaster::putCell( int col, int row )
+{
+  if ( col < 0 || col >= f_hdr.xdim || row < 0 || row >= f_hdr.ydim ) {
+
+    Log::instance()->warn( "Cell (%d, %d) is outside the raster boundaries. It will be ignored.\n", col, row ); 
+    return 0;
+  }
+
+  return iput( col, row, f_hdr.noval );
+}
+
+/*****************/
+/*** put Cells ***/
+int
+GdalRaster::putCells( int col, int row, int numCells )
+{
+  if ( numCells <= 0 ) {
+
+    return 1;
+  }
+
+  if ( col < 0 || col + numCells > f_hdr.xdim || row < 0 || row >= f_hdr.ydim ) {
+
+    Log::instance()->warn( "Cells (%d to %d, %d) are outside the raster boundaries. They will be ignored.\n", col, col + numCells - 1, row ); 
+    return 0;
+  }
+
+  // Be sure that 'row' line is in the cache.
+  Block *block = loadBlock( row, true );
+
+  Scalar *data = block->data + (row - block->first_row) * f_size + col;
+
+  std::fill( data, data + numCells, (Scalar)f_hdr.noval );
+
+  // Indicates the block has changed.
+  block->changed = true;
+
+  return 1;
+}
+
 /*******************/
 /*** get Min Max ***/
 int
@@ -826,52 +1041,297 @@ GdalRaster::calcMinMax( int band )
   return 1;
 }
 
-/****************/
-/*** load Row ***/
+/******************/
+/*** load Block ***/
+GdalRaster::Block *
+GdalRaster::loadBlock( int row, bool writeOperation )
+{
+  int nb = row / f_blockRows;
+
+  BlockList::iterator it = f_index[nb];
+
+  if ( it != f_blocks.end() ) {
+
+    ++f_hits;
+
+    // Move to the front of the list (most recently used).
+    if ( it != f_blocks.begin() ) {
+
+      f_blocks.splice( f_blocks.begin(), f_blocks, it );
+    }
+
+    return &(*it);
+  }
+
+  ++f_misses;
+
+  // Rows are usually written in sequence, so the previous block is
+  // probably complete and can be written in the background.
+  if ( writeOperation && f_writeBehind && nb > 0 && f_index[nb-1] != f_blocks.end() ) {
+
+    BlockList::iterator prev = f_index[nb-1];
+
+    if ( prev->changed ) {
+
+      saveBlock( &(*prev) );
+
+      f_blocks.erase( prev );
+
+      f_index[nb-1] = f_blocks.end();
+    }
+  }
+
+  int first_row = nb * f_blockRows;
+  int num_rows = f_blockRows;
+
+  if ( first_row + num_rows > f_hdr.ydim ) {
+
+    num_rows = f_hdr.ydim - first_row;
+  }
+
+  size_t values = (size_t)f_size * num_rows * f_hdr.nband;
+  size_t bytes = sizeof(Scalar) * values;
+
+  Scalar *data = 0;
+
+  // Reuse the least recently used block if the memory budget was reached.
+  if ( ! f_blocks.empty() ) {
+
+    bool full;
+    {
+      ScopedLock lock( f_cacheMutex );
+      full = ( f_cacheBytes + bytes > f_cacheBudget );
+    }
+
+    if ( full ) {
+
+      Block& old = f_blocks.back();
+
+      saveBlock( &old );
+
+      f_index[ old.first_row / f_blockRows ] = f_blocks.end();
+
+      // Blocks handed to the writer thread are released by it.
+      if ( old.data ) {
+
+        size_t old_bytes = sizeof(Scalar) * (size_t)f_size * old.num_rows * f_hdr.nband;
+
+        if ( old_bytes == bytes ) {
+
+          data = old.data;
+        }
+        else {
+
+          delete[] old.data;
+        }
+
+        ScopedLock lock( f_cacheMutex );
+        f_cacheBytes -= old_bytes;
+      }
+
+      f_blocks.pop_back();
+    }
+  }
+
+  if ( ! data ) {
+
+    data = new Scalar[ values ];
+  }
+
+  {
+    ScopedLock lock( f_cacheMutex );
+    f_cacheBytes += bytes;
+  }
+
+  if ( writeOperation && ! f_flushed[nb] ) {
+
+    // Just reset the block with nodata
+    for ( size_t i = 0 ; i < values; i++ ) {
+
+      data[i] = f_hdr.noval;
+    }
+  }
+  else {
+
+    // The dataset cannot be read while the writer thread uses it.
+    waitWrites();
+
+    // Read from file
+    read( data, first_row, num_rows );
+  }
+
+  Block block;
+  block.first_row = first_row;
+  block.num_rows = num_rows;
+  block.data = data;
+  block.changed = false;
+
+  f_blocks.push_front( block );
+
+  f_index[nb] = f_blocks.begin();
+
+  return &f_blocks.front();
+}
+
+
+/******************/
+/*** save Block ***/
 void
-GdalRaster::loadRow( int row, bool writeOperation )
+GdalRaster::saveBlock( Block *block )
 {
-  // If the line is already read, return.
-  if ( row == f_currentRow ) {
+  if ( ! block->changed ) {
 
     return;
   }
 
-  saveRow();
+  if ( f_writeBehind ) {
+
+    if ( ! f_writer ) {
+
+      f_writer = new ThreadPool( 1 );
+    }
 
-  // Update f_data
-  if ( writeOperation ) {
+    // Keep the number of pending blocks bounded.
+    while ( f_writes.size() >= MAX_PENDING_WRITES ) {
 
-    // Just reset f_data with nodata
-    for ( int i = 0 ; i < f_size; i++ ) {
+      WriteTask *task = f_writes.front();
 
-      f_data[i] = f_hdr.noval;
+      f_writer->waitFor( task );
+
+      f_writes.pop_front();
+
+      std::string error = task->error;
+
+      delete task;
+
+      if ( ! error.empty() ) {
+
+        throw FileIOException( error, f_file );
+      }
     }
+
+    WriteTask *task = new WriteTask( this, block->data, block->first_row, block->num_rows );
+
+    f_writes.push_back( task );
+
+    f_writer->submit( task );
+
+    block->data = 0;
   }
   else {
 
-    // Read from file
-    read( f_data, row, 1 );
+    write( block->data, block->first_row, block->num_rows );
   }
 
-  f_currentRow = row;
-  f_changed = 0;
+  f_flushed[ block->first_row / f_blockRows ] = 1;
+
+  block->changed = false;
 }
 
+/*******************/
+/*** wait Writes ***/
+void
+GdalRaster::waitWrites()
+{
+  std::string error;
 
-/****************/
-/*** save Row ***/
+  while ( ! f_writes.empty() ) {
+
+    WriteTask *task = f_writes.front();
+
+    f_writer->waitFor( task );
+
+    f_writes.pop_front();
+
+    if ( error.empty() ) {
+
+      error = task->error;
+    }
+
+    delete task;
+  }
+
+  if ( ! error.empty() ) {
+
+    throw FileIOException( error, f_file );
+  }
+}
+
+/*********************/
+/*** cancel Writes ***/
 void
-GdalRaster::saveRow()
+GdalRaster::cancelWrites()
 {
-  if ( ! f_changed || f_currentRow < 0 ) {
+  if ( ! f_writer ) {
 
     return;
   }
 
-  write( f_data, f_currentRow, 1 );
+  f_writer->cancelPending();
+
+  f_writer->waitAll();
+
+  while ( ! f_writes.empty() ) {
+
+    delete f_writes.front();
+
+    f_writes.pop_front();
+  }
+}
+
+/*******************/
+/*** save Blocks ***/
+void
+GdalRaster::saveBlocks()
+{
+  BlockList::iterator it = f_blocks.begin();
+
+  for ( ; it != f_blocks.end(); ++it ) {
+
+    saveBlock( &(*it) );
+  }
+}
+
+/**********************/
+/*** release Blocks ***/
+void
+GdalRaster::releaseBlocks()
+{
+  size_t bytes = 0;
+
+  BlockList::iterator it = f_blocks.begin();
+
+  for ( ; it != f_blocks.end(); ++it ) {
+
+    // Blocks handed to the writer thread have no data.
+    if ( it->data ) {
+
+      bytes += sizeof(Scalar) * (size_t)f_size * it->num_rows * f_hdr.nband;
+
+      delete[] it->data;
+    }
+  }
+
+  f_blocks.clear();
+
+  f_index.assign( f_index.size(), f_blocks.end() );
 
-  f_changed = 0;
+  ScopedLock lock( f_cacheMutex );
+  f_cacheBytes -= bytes;
+}
+
+/*************/
+/*** flush ***/
+void
+GdalRaster::flush()
+{
+  saveBlocks();
+
+  waitWrites();
+
+  // Blocks handed to the writer thread have no data, so the cache is
+  // released like in finish. Blocks are read again when needed.
+  releaseBlocks();
 }
 
 /**************/
@@ -879,8 +1339,13 @@ GdalRaster::saveRow()
 void 
 GdalRaster::finish()
 {
-  // Save the last line read, if needed.
-  saveRow();
+  // Save the blocks that have changed, if needed.
+  saveBlocks();
+
+  // Wait for the writer thread.
+  waitWrites();
+
+  releaseBlocks();
 
   if ( f_format == MapFormat::ByteASC || f_format == MapFormat::FloatingASC )
   {
@@ -937,6 +1402,9 @@ GdalRaster::finish()
 int
 GdalRaster::deleteRaster()
 {
+  // Pending blocks must not be written to the deleted file.
+  cancelWrites();
+
   GDALDriver * driver = f_ds->GetDriver();
 
   int ret = driver->Delete( f_file.c_str() );
@@ -946,6 +1414,9 @@ GdalRaster::deleteRaster()
     return 0;
   }
 
+  // Pending changes must not be written to the deleted file.
+  releaseBlocks();
+
   f_ds = 0;
 
   return 1;
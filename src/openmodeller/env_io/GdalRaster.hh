@@ -34,11 +34,14 @@
 #include <openmodeller/env_io/Header.hh>
 #include <openmodeller/env_io/Raster.hh>
 
+#include <deque>
+#include <list>
 #include <string>
 #include <vector>
 
 class GDALDataset;
 class MapFormat;
+class ThreadPool;
 
 /****************************************************************/
 /************************** Raster Gdal *************************/
@@ -53,7 +56,7 @@ class dllexp GdalRaster : public Raster
 public:
 
   // Empty constructor
-  GdalRaster(): f_data(0), f_size(0), f_format(-1), f_currentRow(-1), f_changed(0), f_warped_ds(0) {};
+  GdalRaster(): f_ds(0), f_size(0), f_format(-1), f_blockRows(1), f_blocks(), f_index(), f_flushed(), f_hits(0), f_misses(0), f_writeBehind(false), f_writer(0), f_writes(), f_warped_ds(0) {};
 
   /**
   * Open an existing file -- read only.
@@ -106,6 +109,31 @@ public:
   */
   int put( Coord x, Coord y );
 
+  /**
+  * Fills '*val' with the values of cell (col,row) without any
+  * coordinate conversion.
+  * Returns zero if (col,row) is out of range or has no data.
+  */
+  int getCell( int col, int row, Scalar *val );
+
+  /**
+  * Put '*val' in cell (col,row) without any coordinate conversion.
+  * Returns 0 if (col,row) is out of range.
+  */
+  int putCell( int col, int row, Scalar val );
+
+  /**
+  * Put 'no data val' in cell (col,row).
+  * Returns 0 if (col,row) is out of range.
+  */
+  int putCell( int col, int row );
+
+  /**
+  * Put 'no data val' in numCells consecutive cells of a row, starting
+  * at (col,row). Returns 0 if any cell is out of range.
+  */
+  int putCells( int col, int row, int numCells );
+
   /** Finds the minimum and maximum values in the first band.
    * @param min Pointer to minimum value
    * @param max Pointer to maximum value
@@ -116,6 +144,12 @@ public:
   /** Find the minimum and maximum values in 'band'. */
   int calcMinMax( int band=0 );
 
+  /**
+   * Write all blocks that have changed to the file, throwing a
+   * FileIOException on failure. The block cache is released.
+   */
+  void flush();
+
   /**
    * Event that must be called to indicate when the projection is finished.
    */
@@ -147,8 +181,38 @@ public:
    */
   int getExtentInStandardCs( Coord *xmin, Coord *ymin, Coord *xmax, Coord *ymax );
 
+  /** Number of cell accesses answered by the block cache. */
+  long cacheHits() const { return f_hits; }
+
+  /** Number of cell accesses that required reading a block from the file. */
+  long cacheMisses() const { return f_misses; }
+
+  /** Maximum amount of memory (in bytes) shared by the block caches of all
+   *  rasters. Defined by the RASTER_CACHE_SIZE setting (in megabytes).
+   *  Each raster always keeps at least one block in memory.
+   */
+  static size_t cacheBudget();
+
 private:
 
+  /**
+   * Set of consecutive rows (all bands) kept in memory.
+   */
+  struct Block {
+    int first_row; // First row of the block.
+    int num_rows;  // Number of rows in the block.
+    Scalar *data;  // Band-major values (num_rows * f_size for each band).
+    bool changed;  // Indicates if the block needs to be written.
+  };
+
+  typedef std::list<Block> BlockList;
+
+  /**
+   * Block being written by the writer thread.
+   */
+  class WriteTask;
+  friend class WriteTask;
+
   /** Open a raster file. **/
   void open( char mode );
 
@@ -172,19 +236,53 @@ private:
   */
   void write( Scalar *buf, int first_row, int num_rows );
 
-  void loadRow( int row, bool writeOperation=false );
+  /**
+  * Return the block containing 'row', loading it if necessary.
+  * Blocks loaded for write operations that were never written
+  * before are filled with nodata instead of being read.
+  */
+  Block *loadBlock( int row, bool writeOperation=false );
 
-  void saveRow(); // Save the current row.
+  /**
+   * Save a block, if it has changed. With write-behind the block data
+   * is handed to the writer thread and the block is left without data.
+   */
+  void saveBlock( Block *block );
+
+  void saveBlocks(); // Save all blocks that have changed.
+
+  void releaseBlocks(); // Release the memory of all blocks.
+
+  /**
+   * Wait until all blocks handed to the writer thread are written.
+   * Throws FileIOException if any of them could not be written.
+   */
+  void waitWrites();
+
+  void cancelWrites(); // Discard blocks not written yet.
 
   GDALDataset *f_ds;
 
-  Scalar *f_data; // One line data for all bands.
   int     f_size; // Size of one line.
 
   int     f_format; // File format used to create the raster (MapFormat::getFormat())
 
-  int f_currentRow;
-  int f_changed;
+  int f_blockRows; // Number of rows in each cached block.
+
+  BlockList f_blocks; // Cached blocks, most recently used first.
+
+  std::vector<BlockList::iterator> f_index; // Cached block of each block number (or f_blocks.end()).
+
+  std::vector<char> f_flushed; // Indicates if each block was already written to the file.
+
+  long f_hits;
+  long f_misses;
+
+  bool f_writeBehind; // Indicates if changed blocks are written by a separate thread.
+
+  ThreadPool *f_writer; // Writer thread (created when needed).
+
+  std::deque<WriteTask*> f_writes; // Blocks handed to the writer thread, in order.
 
   // Disable copying.
   GdalRaster( const GdalRaster& );
@@ -148,6 +148,14 @@ Map::getRowColumn( Coord x, Coord y, int *row, int *col )
   return result;
 }
 
+/*************/
+/*** flush ***/
+void
+Map::flush()
+{
+  _rst->flush();
+}
+
 /**************/
 /*** finish ***/
 void 
@@ -124,6 +124,36 @@ public:
   */
   int put( Coord x, Coord y );
 
+  /**
+  * Fills 'val' with the map bands values of cell (col,row),
+  * without any coordinate transformation.
+  * Returns zero if the cell is not defined in the map.
+  */
+  int getCell( int col, int row, Scalar *val ) const { return _rst->getCell( col, row, val ); }
+
+  /**
+  * Put 'val' in the first band of cell (col,row), without any
+  * coordinate transformation.
+  * @return Return zero if the cell is not defined in the map or the
+  * map is read only.
+  */
+  int putCell( int col, int row, Scalar val ) { return _rst->putCell( col, row, val ); }
+
+  /**
+  * Put the value for noval in the first band of cell (col,row).
+  * @return Return zero if the cell is not defined in the map or the
+  * map is read only.
+  */
+  int putCell( int col, int row ) { return _rst->putCell( col, row ); }
+
+  /**
+  * Put the value for noval in the first band of numCells consecutive
+  * cells of a row, starting at (col,row).
+  * @return Return zero if any cell is not defined in the map or the
+  * map is read only.
+  */
+  int putCells( int col, int row, int numCells ) { return _rst->putCells( col, row, numCells ); }
+
   GeoTransform *getGT() const { return _gt; }
 
   /** 
@@ -132,6 +162,12 @@ public:
   */
   int getRowColumn( Coord x, Coord y, int *row, int *col );
 
+  /** 
+  * Write pending changes of the raster to its file. Throws on write
+  * errors, which would only be logged when the map is destroyed.
+  */
+  void flush();
+
   /** 
   * Event that must be called to indicate when the projection is finished.
   */
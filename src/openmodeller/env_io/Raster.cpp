@@ -55,6 +55,54 @@ using std::string;
 Raster::~Raster()
 {}
 
+/****************/
+/*** get Cell ***/
+int
+Raster::getCell( int col, int row, Scalar *val )
+{
+  pair<Coord,Coord> lonlat = f_hdr.convertXY2LonLat( col, row );
+
+  return get( lonlat.first, lonlat.second, val );
+}
+
+/****************/
+/*** put Cell ***/
+int
+Raster::putCell( int col, int row, Scalar val )
+{
+  pair<Coord,Coord> lonlat = f_hdr.convertXY2LonLat( col, row );
+
+  return put( lonlat.first, lonlat.second, val );
+}
+
+/****************/
+/*** put Cell ***/
+int
+Raster::putCell( int col, int row )
+{
+  pair<Coord,Coord> lonlat = f_hdr.convertXY2LonLat( col, row );
+
+  return put( lonlat.first, lonlat.second );
+}
+
+/*****************/
+/*** put Cells ***/
+int
+Raster::putCells( int col, int row, int numCells )
+{
+  int ret = 1;
+
+  for ( int i = 0; i < numCells; ++i ) {
+
+    if ( ! putCell( col + i, row ) ) {
+
+      ret = 0;
+    }
+  }
+
+  return ret;
+}
+
 /*******************/
 /*** set Min Max ***/
 void
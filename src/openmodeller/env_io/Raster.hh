@@ -132,6 +132,42 @@ public:
      */
     virtual int put( Coord px, Coord py ) = 0;
 
+    /** Fills '*val' with the map value of a cell. The default
+     * implementation calls get with the coordinates of the cell center.
+     * @param col Column of the cell
+     * @param row Row of the cell
+     * @param val Value
+     * @return zero if (col,row) is out of range or has no data.
+     */
+    virtual int getCell( int col, int row, Scalar *val );
+
+    /** Put 'val' in a cell. Supports only single band output files.
+     * The default implementation calls put with the coordinates of the
+     * cell center.
+     * @param col Column of the cell
+     * @param row Row of the cell
+     * @param val Value
+     * @return 0 if (col,row) is out of range or the map is read only.
+     */
+    virtual int putCell( int col, int row, Scalar val );
+
+    /** Put 'no data val' in a cell. Supports only single band files.
+     * @param col Column of the cell
+     * @param row Row of the cell
+     * @return 0 if (col,row) is out of range or the map is read only.
+     */
+    virtual int putCell( int col, int row );
+
+    /** Put 'no data val' in consecutive cells of a row. Supports only
+     * single band files. The default implementation calls putCell for
+     * each cell.
+     * @param col Column of the first cell
+     * @param row Row of the cells
+     * @param numCells Number of cells
+     * @return 0 if any cell is out of range or the map is read only.
+     */
+    virtual int putCells( int col, int row, int numCells );
+
     /** Finds the minimum and maximum values in the first band. 
      * @param min Pointer to minimum value
      * @param max Pointer to maximum value
@@ -148,6 +184,12 @@ public:
      */
     void setMinMax( Scalar min, Scalar max );
 
+    /** 
+     * Write pending changes to the file. Errors are reported with
+     * exceptions, which the destructor can only log.
+     */
+    virtual void flush() {};
+
     /** 
      * Event that must be called to indicate when the projection is finished.
      */
@@ -35,3 +35,15 @@ AlgoAdapterModelImpl::getValue( const Sample& x ) const
 {
   return _algo->getValue( x );
 }
+
+void
+AlgoAdapterModelImpl::getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const
+{
+  _algo->getValues( samples, numSamples, dim, numCategorical, values );
+}
+
+int
+AlgoAdapterModelImpl::supportsThreadedProjection() const
+{
+  return _algo->supportsThreadedProjection();
+}
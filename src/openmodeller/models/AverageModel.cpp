@@ -50,6 +50,50 @@ AverageModelImpl::getValue( const Sample& x ) const
 
 }
 
+void
+AverageModelImpl::getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const
+{
+  std::fill( values, values + numSamples, Scalar(0.0) );
+
+  if ( _size == Scalar(0.0) || numSamples <= 0 )
+    return;
+
+  vector<Scalar> partial( numSamples );
+
+  vector<Model>::const_iterator amodel;
+
+  for ( amodel = _models.begin();
+	amodel != _models.end();
+	++amodel ) {
+
+    (*amodel)->getValues( samples, numSamples, dim, numCategorical, &partial[0] );
+
+    for ( int i = 0; i < numSamples; ++i ) {
+      values[i] += partial[i];
+    }
+  }
+
+  for ( int i = 0; i < numSamples; ++i ) {
+    values[i] /= _size;
+  }
+}
+
+int
+AverageModelImpl::supportsThreadedProjection() const
+{
+  vector<Model>::const_iterator amodel;
+
+  for ( amodel = _models.begin();
+	amodel != _models.end();
+	++amodel ) {
+
+    if ( ! (*amodel)->supportsThreadedProjection() )
+      return 0;
+  }
+
+  return 1;
+}
+
 void
 AverageModelImpl::addModel( Model model )
 {
@@ -30,6 +30,10 @@ public:
   virtual void setNormalization( const EnvironmentPtr& env ) const;
 
   virtual Scalar getValue( const Sample& x ) const;
+
+  virtual void getValues( const Scalar *samples, int numSamples, int dim, int numCategorical, Scalar *values ) const;
+
+  virtual int supportsThreadedProjection() const;
   
   virtual void addModel( Model model );
   
@@ -75,5 +75,11 @@ public:
  void runTest() { suite_test_AreaStats.testGetConfiguration(); }
 } testDescription_suite_test_AreaStats_testGetConfiguration;
 
+static class TestDescription_suite_test_AreaStats_testMerge : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_test_AreaStats_testMerge() : CxxTest::RealTestDescription( Tests_test_AreaStats, suiteDescription_test_AreaStats, 177, "testMerge" ) {}
+ void runTest() { suite_test_AreaStats.testMerge(); }
+} testDescription_suite_test_AreaStats_testMerge;
+
 #include <cxxtest/Root.cpp>
 const char* CxxTest::RealWorldDescription::_worldName = "cxxtest";
@@ -170,6 +170,24 @@ class test_AreaStats : public CxxTest :: TestSuite
       //TS_ASSERT(C->getAttributeAsInt("PredictionThreshold",-1)==1.00);
     }
 
+/**
+ *Test for merge(const AreaStats *areaStats).
+ */
+
+    void testMerge (){
+      std::cout << std::endl;
+      std::cout << "Testing merge(const AreaStats *areaStats) ..." << std::endl;
+      A->addPrediction(Scalar(1.00));
+      B->addPrediction(Scalar(0.50));
+      B->addNonPrediction();
+      A->merge(B);
+      TS_ASSERT_EQUALS(A->getTotalArea(),3);
+      TS_ASSERT_EQUALS(A->getAreaPredictedPresent(),1);
+      TS_ASSERT_EQUALS(A->getAreaPredictedAbsent(),1);
+      TS_ASSERT_EQUALS(A->getAreaNotPredicted(),1);
+      TS_ASSERT_EQUALS(A->getPredictionThreshold(),Scalar(1.00));
+    }
+
   private:
     AreaStats *A;
     AreaStats *B;
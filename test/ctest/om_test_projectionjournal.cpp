@@ -0,0 +1,55 @@
+/* Generated file, do not edit */
+
+#ifndef CXXTEST_RUNNING
+#define CXXTEST_RUNNING
+#endif
+
+#define _CXXTEST_HAVE_STD
+#include <cxxtest/TestListener.h>
+#include <cxxtest/TestTracker.h>
+#include <cxxtest/TestRunner.h>
+#include <cxxtest/RealDescriptions.h>
+#include <cxxtest/TestMain.h>
+#include <cxxtest/ErrorPrinter.h>
+
+int main( int argc, char *argv[] ) {
+ int status;
+    CxxTest::ErrorPrinter tmp;
+    CxxTest::RealWorldDescription::_worldName = "test_projectionjournal";
+    status = CxxTest::Main< CxxTest::ErrorPrinter >( tmp, argc, argv );
+    return status;
+}
+bool suite_test_ProjectionJournal_init = false;
+#include "om_test_projectionjournal.h"
+
+static test_ProjectionJournal suite_test_ProjectionJournal;
+
+static CxxTest::List Tests_test_ProjectionJournal = { 0, 0 };
+CxxTest::StaticSuiteDescription suiteDescription_test_ProjectionJournal( "om_test_projectionjournal.h", 41, "test_ProjectionJournal", suite_test_ProjectionJournal, Tests_test_ProjectionJournal );
+
+static class TestDescription_suite_test_ProjectionJournal_testResume : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_test_ProjectionJournal_testResume() : CxxTest::RealTestDescription( Tests_test_ProjectionJournal, suiteDescription_test_ProjectionJournal, 66, "testResume" ) {}
+ void runTest() { suite_test_ProjectionJournal.testResume(); }
+} testDescription_suite_test_ProjectionJournal_testResume;
+
+static class TestDescription_suite_test_ProjectionJournal_testDifferentKey : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_test_ProjectionJournal_testDifferentKey() : CxxTest::RealTestDescription( Tests_test_ProjectionJournal, suiteDescription_test_ProjectionJournal, 87, "testDifferentKey" ) {}
+ void runTest() { suite_test_ProjectionJournal.testDifferentKey(); }
+} testDescription_suite_test_ProjectionJournal_testDifferentKey;
+
+static class TestDescription_suite_test_ProjectionJournal_testIncompleteRecord : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_test_ProjectionJournal_testIncompleteRecord() : CxxTest::RealTestDescription( Tests_test_ProjectionJournal, suiteDescription_test_ProjectionJournal, 105, "testIncompleteRecord" ) {}
+ void runTest() { suite_test_ProjectionJournal.testIncompleteRecord(); }
+} testDescription_suite_test_ProjectionJournal_testIncompleteRecord;
+
+static class TestDescription_suite_test_ProjectionJournal_testRemove : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_test_ProjectionJournal_testRemove() : CxxTest::RealTestDescription( Tests_test_ProjectionJournal, suiteDescription_test_ProjectionJournal, 125, "testRemove" ) {}
+ void runTest() { suite_test_ProjectionJournal.testRemove(); }
+} testDescription_suite_test_ProjectionJournal_testRemove;
+
+#include <cxxtest/Root.cpp>
+const char* CxxTest::RealWorldDescription::_worldName = "cxxtest";
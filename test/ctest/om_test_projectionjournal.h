@@ -0,0 +1,140 @@
+/**
+ * Test class for ProjectionJournal
+ * 
+ * $Id$
+ *
+ * LICENSE INFORMATION
+ * 
+ * Copyright(c) 2026 by CRIA -
+ * Centro de Referencia em Informacao Ambiental
+ *
+ * http://www.cria.org.br
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details:
+ * 
+ * http://www.gnu.org/copyleft/gpl.html
+ */
+
+/** \ingroup test
+* \brief Test for ProjectionJournal Class
+*/
+
+#ifndef TEST_PROJECTIONJOURNAL_HH
+#define TEST_PROJECTIONJOURNAL_HH
+
+#include "cxxtest/TestSuite.h"
+#include "ProjectionJournal.hh"
+#include "env_io/Header.hh"
+#include <stdio.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+class test_ProjectionJournal : public CxxTest :: TestSuite 
+{
+  public:
+    void setUp (){
+      // 4 columns, 5 rows, bands of 2 rows
+      H = new Header( 4, 5, 0.0, 0.0, 4.0, 5.0, -1.0 );
+      F = "om_test_projection.journal";
+    }
+
+    void tearDown (){
+      remove( F.c_str() );
+      delete H;
+    }
+
+    std::vector<Scalar> band( int firstRow, int numRows ){
+      std::vector<Scalar> v( numRows * 4 );
+      for ( unsigned int i = 0; i < v.size(); ++i ) {
+        v[i] = ( i % 3 == 0 ) ? -1.0 : ( firstRow * 4 + i ) / 20.0;
+      }
+      return v;
+    }
+
+/**
+ * A new journal has no completed bands and completed bands are found by a new run.
+ */
+    void testResume(){
+      std::cout << std::endl << "Testing resume..." << std::endl;
+      {
+        ProjectionJournal j( F, "model" );
+        TS_ASSERT_EQUALS( j.open( *H, 2 ), 0 );
+        TS_ASSERT( j.writeBand( 0, band( 0, 2 ) ) );
+        TS_ASSERT( j.writeBand( 2, band( 2, 2 ) ) );
+      }
+      ProjectionJournal j( F, "model" );
+      TS_ASSERT_EQUALS( j.open( *H, 2 ), 2 );
+      std::vector<Scalar> v;
+      TS_ASSERT( j.readBand( 0, v ) );
+      TS_ASSERT( v == band( 0, 2 ) );
+      TS_ASSERT( j.readBand( 2, v ) );
+      TS_ASSERT( v == band( 2, 2 ) );
+      TS_ASSERT( j.writeBand( 4, band( 4, 1 ) ) );
+    }
+
+/**
+ * Journals of a different model or grid are discarded.
+ */
+    void testDifferentKey(){
+      std::cout << std::endl << "Testing different key..." << std::endl;
+      {
+        ProjectionJournal j( F, "model" );
+        j.open( *H, 2 );
+        j.writeBand( 0, band( 0, 2 ) );
+      }
+      {
+        ProjectionJournal j( F, "another model" );
+        TS_ASSERT_EQUALS( j.open( *H, 2 ), 0 );
+      }
+      ProjectionJournal j( F, "another model" );
+      TS_ASSERT_EQUALS( j.open( *H, 1 ), 0 );
+    }
+
+/**
+ * Incomplete records are ignored.
+ */
+    void testIncompleteRecord(){
+      std::cout << std::endl << "Testing incomplete record..." << std::endl;
+      {
+        ProjectionJournal j( F, "model" );
+        j.open( *H, 2 );
+        j.writeBand( 0, band( 0, 2 ) );
+      }
+      // Append part of a record
+      FILE *fp = fopen( F.c_str(), "ab" );
+      int row = 2;
+      fwrite( &row, sizeof(int), 1, fp );
+      fclose( fp );
+
+      ProjectionJournal j( F, "model" );
+      TS_ASSERT_EQUALS( j.open( *H, 2 ), 1 );
+    }
+
+/**
+ * Journals are deleted by remove.
+ */
+    void testRemove(){
+      std::cout << std::endl << "Testing remove..." << std::endl;
+      ProjectionJournal j( F, "model" );
+      j.open( *H, 2 );
+      j.remove();
+      FILE *fp = fopen( F.c_str(), "rb" );
+      TS_ASSERT( fp == 0 );
+      if ( fp ) fclose( fp );
+    }
+
+  private:
+    Header *H;
+    std::string F;
+};
+
+#endif
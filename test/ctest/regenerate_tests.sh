@@ -6,6 +6,7 @@ cxxtestgen --error-printer -w "test_exceptions" -o om_test_exceptions.cpp om_tes
 cxxtestgen --error-printer -w "test_icstring" -o om_test_icstring.cpp om_test_icstring.h
 cxxtestgen --error-printer -w "test_mapformat" -o om_test_mapformat.cpp om_test_mapformat.h
 cxxtestgen --error-printer -w "test_occurrence" -o om_test_occurrence.cpp om_test_occurrence.h
+cxxtestgen --error-printer -w "test_projectionjournal" -o om_test_projectionjournal.cpp om_test_projectionjournal.h
 cxxtestgen --error-printer -w "test_random" -o om_test_random.cpp om_test_random.h
 cxxtestgen --error-printer -w "test_refcount" -o om_test_refcount.cpp om_test_refcount.h
 cxxtestgen --error-printer -w "test_sampleexpr" -o om_test_sampleexpr.cpp om_test_sampleexpr.h